@@ -0,0 +1,249 @@
+﻿#include "Simulation.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 调度算法基准测试: 固定场景、固定种子, 输出机器可读的指标
+//   ElevatorBenchmark [--format json|csv] [--floors 20,50,200] [--cars 2,4,8,16,32,64]
+//                     [--profiles up-peak,inter-floor] [--modes collective,destination]
+//                     [--zoning none,banks,sky-lobby] [--banks 3]
+//                     [--lookahead-ms 0,1000] [--lookahead-iterations 2000] [--batch-ms 0]
+//                     [--minutes 60] [--rate-per-floor 0.5] [--seed 1]
+//                     [--capacity 13] [--transfer-ms 1000]
+//                     [--speed 2.5 --acceleration 1.0 --jerk 1.5 --floor-height 3.5]
+//                     [--checkpoint file --checkpoint-minute 30] [--resume file]
+// --lookahead-ms为前瞻优化重新分配外呼的周期, 0为不优化
+// --batch-ms为联合派梯的窗口, 窗口内的外呼按指派问题一起求解, 0为逐个派梯
+// --capacity为额定载客人数(0为不限), --transfer-ms为每位乘客上下梯的时间
+// --speed为额定速度(m/s), 给出时按S形速度曲线查表计算运行时间, 否则每层固定600ms
+// 楼层数为2~1000, 电梯数为1~256(SimulationConfig::MaxFloorCount/MaxElevatorCount)
+// --checkpoint在单个场景运行到指定分钟时保存检查点, --resume从检查点继续运行, 结果与不中断运行相同
+
+namespace {
+    template <typename T, typename Predicate>
+    bool AllOf(const std::vector<T>& values, Predicate predicate)
+    {
+        for (const T& value : values)
+            if (!predicate(value)) return false;
+        return true;
+    }
+
+    std::vector<int> ParseIntList(const char* text)
+    {
+        std::vector<int> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty()) values.push_back(std::atoi(item.c_str()));
+        return values;
+    }
+
+    std::vector<TrafficProfile> ParseProfileList(const char* text)
+    {
+        std::vector<TrafficProfile> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            TrafficProfile profile;
+            if (TrafficGenerator::ParseProfile(item, profile))
+                values.push_back(profile);
+            else
+                std::fprintf(stderr, "unknown profile: %s\n", item.c_str());
+        }
+        return values;
+    }
+
+    std::vector<DispatchMode> ParseModeList(const char* text)
+    {
+        std::vector<DispatchMode> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            DispatchMode mode;
+            if (ElevatorGroup::ParseMode(item, mode))
+                values.push_back(mode);
+            else
+                std::fprintf(stderr, "unknown mode: %s\n", item.c_str());
+        }
+        return values;
+    }
+
+    std::vector<ZoningMode> ParseZoningList(const char* text)
+    {
+        std::vector<ZoningMode> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            ZoningMode zoning;
+            if (ZonePlan::ParseMode(item, zoning))
+                values.push_back(zoning);
+            else
+                std::fprintf(stderr, "unknown zoning: %s\n", item.c_str());
+        }
+        return values;
+    }
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: ElevatorBenchmark [--format json|csv] [--floors 20,50,200 (2-1000)] [--cars 2,4,8,16,32,64 (1-256)]\n"
+            "                         [--profiles up-peak,down-peak,lunch,inter-floor]\n"
+            "                         [--modes collective,destination] [--zoning none,banks,sky-lobby]\n"
+            "                         [--banks 3] [--lookahead-ms 0,1000] [--lookahead-iterations 2000]\n"
+            "                         [--batch-ms 0]\n"
+            "                         [--minutes 60]\n"
+            "                         [--rate-per-floor 0.5] [--seed 1]\n"
+            "                         [--capacity 13] [--transfer-ms 1000]\n"
+            "                         [--speed 2.5 --acceleration 1.0 --jerk 1.5 --floor-height 3.5]\n"
+            "                         [--checkpoint file --checkpoint-minute 30] [--resume file]\n");
+    }
+
+    void PrintReport(const std::string& format, const SimulationConfig& config, const KpiReport& report)
+    {
+        const char* profile = TrafficGenerator::ProfileName(config.profile);
+        const char* mode = ElevatorGroup::ModeName(config.dispatch_mode);
+        const char* zoning = ZonePlan::ModeName(config.zoning);
+        int banks = config.zoning == ZoningMode::Banks ? config.banks : 1;
+        unsigned long long seed = config.seed;
+        if (format == "csv") {
+            std::printf("%d,%d,%s,%s,%s,%d,%d,%.2f,%llu,%s\n", config.floor_count, config.elevator_count,
+                profile, mode, zoning, banks, config.lookahead_ms, config.passengers_per_minute, seed, report.ToCsv().c_str());
+        }
+        else {
+            std::printf("{\"floors\":%d,\"cars\":%d,\"profile\":\"%s\",\"mode\":\"%s\",\"zoning\":\"%s\",\"banks\":%d,\"lookahead_ms\":%d,\"passengers_per_minute\":%.2f,\"seed\":%llu,%s}\n",
+                config.floor_count, config.elevator_count, profile, mode, zoning, banks, config.lookahead_ms,
+                config.passengers_per_minute, seed, report.ToJsonFields().c_str());
+        }
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string format = "json";
+    std::vector<int> floors = { 20, 50, 200 };
+    std::vector<int> cars = { 2, 4, 8, 16, 32, 64 };
+    std::vector<TrafficProfile> profiles = { TrafficProfile::UpPeak, TrafficProfile::InterFloor };
+    std::vector<DispatchMode> modes = { DispatchMode::Collective };
+    std::vector<ZoningMode> zonings = { ZoningMode::None };
+    int banks = 3;
+    std::vector<int> lookaheads = { 0 };
+    int lookahead_iterations = 2000;
+    int batch_ms = 0;
+    double minutes = 60.0;
+    double rate_per_floor = 0.5; // 每层每分钟到达人数
+    unsigned long long seed = 1;
+    CarTiming timing;
+    std::string checkpoint_path;
+    double checkpoint_minute = -1.0;
+    std::string resume_path;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            PrintUsage();
+            return 1;
+        }
+        if (std::strcmp(arg, "--format") == 0) format = value;
+        else if (std::strcmp(arg, "--floors") == 0) floors = ParseIntList(value);
+        else if (std::strcmp(arg, "--cars") == 0) cars = ParseIntList(value);
+        else if (std::strcmp(arg, "--profiles") == 0) profiles = ParseProfileList(value);
+        else if (std::strcmp(arg, "--modes") == 0) modes = ParseModeList(value);
+        else if (std::strcmp(arg, "--zoning") == 0) zonings = ParseZoningList(value);
+        else if (std::strcmp(arg, "--banks") == 0) banks = std::atoi(value);
+        else if (std::strcmp(arg, "--lookahead-ms") == 0) lookaheads = ParseIntList(value);
+        else if (std::strcmp(arg, "--lookahead-iterations") == 0) lookahead_iterations = std::atoi(value);
+        else if (std::strcmp(arg, "--batch-ms") == 0) batch_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--minutes") == 0) minutes = std::atof(value);
+        else if (std::strcmp(arg, "--rate-per-floor") == 0) rate_per_floor = std::atof(value);
+        else if (std::strcmp(arg, "--seed") == 0) seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--capacity") == 0) timing.capacity = std::atoi(value);
+        else if (std::strcmp(arg, "--transfer-ms") == 0) timing.transfer_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--speed") == 0) timing.rated_speed = std::atof(value);
+        else if (std::strcmp(arg, "--acceleration") == 0) timing.acceleration = std::atof(value);
+        else if (std::strcmp(arg, "--jerk") == 0) timing.jerk = std::atof(value);
+        else if (std::strcmp(arg, "--floor-height") == 0) timing.floor_height = std::atof(value);
+        else if (std::strcmp(arg, "--checkpoint") == 0) checkpoint_path = value;
+        else if (std::strcmp(arg, "--checkpoint-minute") == 0) checkpoint_minute = std::atof(value);
+        else if (std::strcmp(arg, "--resume") == 0) resume_path = value;
+        else {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+    // 楼层少于2层或没有电梯时乘客全部被丢弃, 输出看似正常的全零结果; 负数会使容器尺寸溢出
+    if ((format != "json" && format != "csv") || checkpoint_path.empty() != (checkpoint_minute < 0) || banks < 1 || batch_ms < 0 ||
+        !AllOf(floors, [](int floor_count) { return floor_count >= 2 && floor_count <= SimulationConfig::MaxFloorCount; }) ||
+        !AllOf(cars, [](int elevator_count) { return elevator_count >= 1 && elevator_count <= SimulationConfig::MaxElevatorCount; }) ||
+        !AllOf(lookaheads, [](int lookahead) { return lookahead >= 0; }) || minutes < 0 || rate_per_floor < 0 ||
+        timing.capacity < 0 || timing.transfer_ms < 0 || timing.rated_speed < 0 ||
+        timing.acceleration <= 0 || timing.jerk <= 0 || timing.floor_height <= 0) {
+        PrintUsage();
+        return 1;
+    }
+    if (!checkpoint_path.empty() && floors.size() * cars.size() * profiles.size() * modes.size() * zonings.size() * lookaheads.size() != 1) {
+        std::fprintf(stderr, "--checkpoint只能用于单个场景\n");
+        return 1;
+    }
+
+    if (format == "csv")
+        std::printf("floors,cars,profile,mode,zoning,banks,lookahead_ms,passengers_per_minute,seed,%s\n", KpiReport::CsvHeader().c_str());
+
+    if (!resume_path.empty()) {
+        SimulationConfig config;
+        if (!Simulation::ReadCheckpointConfig(resume_path, config)) {
+            std::fprintf(stderr, "cannot read checkpoint: %s\n", resume_path.c_str());
+            return 1;
+        }
+        Simulation simulation(config);
+        if (!simulation.LoadCheckpoint(resume_path)) {
+            std::fprintf(stderr, "cannot restore checkpoint: %s\n", resume_path.c_str());
+            return 1;
+        }
+        PrintReport(format, config, simulation.Run());
+        return 0;
+    }
+
+    for (int floor_count : floors) {
+        for (int elevator_count : cars) {
+            for (TrafficProfile profile : profiles) {
+                for (DispatchMode mode : modes) {
+                    for (ZoningMode zoning : zonings) {
+                        for (int lookahead : lookaheads) {
+                            SimulationConfig config;
+                            config.floor_count = floor_count;
+                            config.elevator_count = elevator_count;
+                            config.profile = profile;
+                            config.dispatch_mode = mode;
+                            config.zoning = zoning;
+                            config.banks = banks;
+                            config.lookahead_ms = lookahead;
+                            config.lookahead_iterations = lookahead_iterations;
+                            config.batch_window_ms = batch_ms;
+                            config.passengers_per_minute = rate_per_floor * floor_count;
+                            config.duration_ms = static_cast<TimerService::Time>(minutes * 60 * 1000);
+                            config.seed = seed;
+                            config.timing = timing;
+
+                            Simulation simulation(config);
+                            if (!checkpoint_path.empty()) {
+                                simulation.RunUntil(static_cast<TimerService::Time>(checkpoint_minute * 60 * 1000));
+                                if (!simulation.SaveCheckpoint(checkpoint_path)) {
+                                    std::fprintf(stderr, "cannot write checkpoint: %s\n", checkpoint_path.c_str());
+                                    return 1;
+                                }
+                            }
+                            PrintReport(format, config, simulation.Run());
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
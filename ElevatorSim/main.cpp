@@ -0,0 +1,162 @@
+﻿#include "Simulation.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+// 无界面模拟命令行: 按给定的楼宇和交通参数运行一个场景, 输出KPI; 不依赖Qt, 可在Linux计算节点上运行
+//   elevator-sim [--floors 20] [--cars 5] [--profile up-peak] [--rate 10] [--minutes 60] [--seed 1]
+//                [--mode collective|destination] [--zoning none|banks|sky-lobby] [--banks 3]
+//                [--lookahead-ms 0] [--lookahead-iterations 2000] [--batch-ms 0]
+//                [--move-ms 600] [--open-ms 1000] [--stay-open-ms 2000] [--close-ms 1000]
+//                [--capacity 13] [--transfer-ms 1000]
+//                [--speed 0] [--acceleration 1.0] [--jerk 1.5] [--floor-height 3.5] [--lobby-height 0]
+//                [--format text|json|csv] [--checkpoint file --checkpoint-minute 30] [--resume file]
+//                [--flight-recorder file]
+// --rate为整栋楼每分钟到达的乘客数, --minutes为乘客到达的时间段, 之后运行到全部送达
+// --flight-recorder开启飞行记录, 电梯报警时立即导出到该文件, 用FlightDecoder查看
+// 楼层数为2~1000, 电梯数为1~256(SimulationConfig::MaxFloorCount/MaxElevatorCount)
+// 参数含义与ElevatorBenchmark相同, 区别是只运行一个场景; 批量扫描用ElevatorBenchmark或ElevatorSweep
+
+namespace {
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: elevator-sim [--floors 20 (2-1000)] [--cars 5 (1-256)] [--profile up-peak|down-peak|lunch|inter-floor]\n"
+            "                    [--rate 10] [--minutes 60] [--seed 1]\n"
+            "                    [--mode collective|destination] [--zoning none|banks|sky-lobby] [--banks 3]\n"
+            "                    [--lookahead-ms 0] [--lookahead-iterations 2000] [--batch-ms 0]\n"
+            "                    [--move-ms 600] [--open-ms 1000] [--stay-open-ms 2000] [--close-ms 1000]\n"
+            "                    [--capacity 13] [--transfer-ms 1000]\n"
+            "                    [--speed 0] [--acceleration 1.0] [--jerk 1.5] [--floor-height 3.5] [--lobby-height 0]\n"
+            "                    [--format text|json|csv] [--checkpoint file --checkpoint-minute 30] [--resume file]\n"
+            "                    [--flight-recorder file]\n");
+    }
+
+    void PrintReport(const std::string& format, const SimulationConfig& config, const KpiReport& report)
+    {
+        const char* profile = TrafficGenerator::ProfileName(config.profile);
+        const char* mode = ElevatorGroup::ModeName(config.dispatch_mode);
+        const char* zoning = ZonePlan::ModeName(config.zoning);
+        unsigned long long seed = config.seed;
+        if (format == "csv") {
+            std::printf("floors,cars,profile,mode,zoning,passengers_per_minute,seed,%s\n", KpiReport::CsvHeader().c_str());
+            std::printf("%d,%d,%s,%s,%s,%.2f,%llu,%s\n", config.floor_count, config.elevator_count,
+                profile, mode, zoning, config.passengers_per_minute, seed, report.ToCsv().c_str());
+        }
+        else if (format == "json") {
+            std::printf("{\"floors\":%d,\"cars\":%d,\"profile\":\"%s\",\"mode\":\"%s\",\"zoning\":\"%s\",\"passengers_per_minute\":%.2f,\"seed\":%llu,%s}\n",
+                config.floor_count, config.elevator_count, profile, mode, zoning, config.passengers_per_minute, seed,
+                report.ToJsonFields().c_str());
+        }
+        else {
+            // 每行一个指标, 名称与CSV列名相同
+            std::printf("%d floors, %d cars, %s, %s, zoning %s, %.2f passengers/min, seed %llu\n", config.floor_count,
+                config.elevator_count, profile, mode, zoning, config.passengers_per_minute, seed);
+            std::stringstream names(KpiReport::CsvHeader());
+            std::stringstream values(report.ToCsv());
+            std::string name, value;
+            while (std::getline(names, name, ',') && std::getline(values, value, ','))
+                std::printf("  %-24s %s\n", name.c_str(), value.c_str());
+        }
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string format = "text";
+    SimulationConfig config;
+    double minutes = 60.0;
+    std::string checkpoint_path;
+    double checkpoint_minute = -1.0;
+    std::string resume_path;
+    std::string recorder_path;
+    bool valid = true;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            PrintUsage();
+            return 1;
+        }
+        if (std::strcmp(arg, "--format") == 0) format = value;
+        else if (std::strcmp(arg, "--floors") == 0) config.floor_count = std::atoi(value);
+        else if (std::strcmp(arg, "--cars") == 0) config.elevator_count = std::atoi(value);
+        else if (std::strcmp(arg, "--profile") == 0) valid = TrafficGenerator::ParseProfile(value, config.profile) && valid;
+        else if (std::strcmp(arg, "--rate") == 0) config.passengers_per_minute = std::atof(value);
+        else if (std::strcmp(arg, "--minutes") == 0) minutes = std::atof(value);
+        else if (std::strcmp(arg, "--seed") == 0) config.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--mode") == 0) valid = ElevatorGroup::ParseMode(value, config.dispatch_mode) && valid;
+        else if (std::strcmp(arg, "--zoning") == 0) valid = ZonePlan::ParseMode(value, config.zoning) && valid;
+        else if (std::strcmp(arg, "--banks") == 0) config.banks = std::atoi(value);
+        else if (std::strcmp(arg, "--lookahead-ms") == 0) config.lookahead_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--lookahead-iterations") == 0) config.lookahead_iterations = std::atoi(value);
+        else if (std::strcmp(arg, "--batch-ms") == 0) config.batch_window_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--move-ms") == 0) config.timing.move_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--open-ms") == 0) config.timing.open_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--stay-open-ms") == 0) config.timing.stay_open_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--close-ms") == 0) config.timing.close_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--capacity") == 0) config.timing.capacity = std::atoi(value);
+        else if (std::strcmp(arg, "--transfer-ms") == 0) config.timing.transfer_ms = std::atoi(value);
+        else if (std::strcmp(arg, "--speed") == 0) config.timing.rated_speed = std::atof(value);
+        else if (std::strcmp(arg, "--acceleration") == 0) config.timing.acceleration = std::atof(value);
+        else if (std::strcmp(arg, "--jerk") == 0) config.timing.jerk = std::atof(value);
+        else if (std::strcmp(arg, "--floor-height") == 0) config.timing.floor_height = std::atof(value);
+        else if (std::strcmp(arg, "--lobby-height") == 0) config.timing.lobby_height = std::atof(value);
+        else if (std::strcmp(arg, "--checkpoint") == 0) checkpoint_path = value;
+        else if (std::strcmp(arg, "--checkpoint-minute") == 0) checkpoint_minute = std::atof(value);
+        else if (std::strcmp(arg, "--resume") == 0) resume_path = value;
+        else if (std::strcmp(arg, "--flight-recorder") == 0) recorder_path = value;
+        else {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+    const CarTiming& timing = config.timing;
+    if (!valid || (format != "text" && format != "json" && format != "csv") ||
+        checkpoint_path.empty() != (checkpoint_minute < 0) ||
+        config.floor_count < 2 || config.floor_count > SimulationConfig::MaxFloorCount ||
+        config.elevator_count < 1 || config.elevator_count > SimulationConfig::MaxElevatorCount ||
+        config.passengers_per_minute < 0 || minutes < 0 || config.banks < 1 || config.lookahead_ms < 0 ||
+        config.batch_window_ms < 0 || timing.move_ms <= 0 || timing.open_ms < 0 || timing.stay_open_ms < 0 ||
+        timing.close_ms < 0 || timing.capacity < 0 || timing.transfer_ms < 0 || timing.rated_speed < 0 ||
+        timing.acceleration <= 0 || timing.jerk <= 0 || timing.floor_height <= 0 || timing.lobby_height < 0) {
+        PrintUsage();
+        return 1;
+    }
+    config.duration_ms = static_cast<TimerService::Time>(minutes * 60 * 1000);
+
+    if (!resume_path.empty()) {
+        // 场景参数以检查点为准
+        if (!Simulation::ReadCheckpointConfig(resume_path, config)) {
+            std::fprintf(stderr, "cannot read checkpoint: %s\n", resume_path.c_str());
+            return 1;
+        }
+        Simulation simulation(config);
+        if (!simulation.LoadCheckpoint(resume_path)) {
+            std::fprintf(stderr, "cannot restore checkpoint: %s\n", resume_path.c_str());
+            return 1;
+        }
+        if (!recorder_path.empty())
+            simulation.EnableFlightRecorder(recorder_path);
+        PrintReport(format, config, simulation.Run());
+        return 0;
+    }
+
+    Simulation simulation(config);
+    if (!recorder_path.empty())
+        simulation.EnableFlightRecorder(recorder_path);
+    if (!checkpoint_path.empty()) {
+        simulation.RunUntil(static_cast<TimerService::Time>(checkpoint_minute * 60 * 1000));
+        if (!simulation.SaveCheckpoint(checkpoint_path)) {
+            std::fprintf(stderr, "cannot write checkpoint: %s\n", checkpoint_path.c_str());
+            return 1;
+        }
+    }
+    PrintReport(format, config, simulation.Run());
+    return 0;
+}
@@ -0,0 +1,144 @@
+﻿#include "Sweep.h"
+#include "ThreadPool.h"
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 容量规划参数扫描: 对网格中的每个组合运行多次不同种子的模拟, 输出指标均值和95%置信区间
+//   ElevatorSweep [--format json|csv] [--floors 20,30] [--cars 4,6,8] [--move-ms 600,400]
+//                 [--stay-open-ms 2000,1500] [--rates 10,20,40] [--profiles up-peak]
+//                 [--modes collective] [--replications 10] [--minutes 60] [--seed 1] [--threads 0]
+// 楼层数为2~1000, 电梯数为1~256(SimulationConfig::MaxFloorCount/MaxElevatorCount)
+
+namespace {
+    // 无法解析的项记为invalid, 由调用方打印用法后退出
+    template <typename T, typename Parse>
+    std::vector<T> ParseList(const char* text, Parse parse, bool& valid)
+    {
+        std::vector<T> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            T value;
+            if (!item.empty() && parse(item, value))
+                values.push_back(value);
+            else if (!item.empty()) {
+                std::fprintf(stderr, "invalid value: %s\n", item.c_str());
+                valid = false;
+            }
+        }
+        return values;
+    }
+
+    // 整个字符串都是数字才算成功, 拒绝"abc"、"12x"这类输入
+    bool ParseInt(const std::string& text, int& value)
+    {
+        char* end = nullptr;
+        errno = 0;
+        long parsed = std::strtol(text.c_str(), &end, 10);
+        if (end == text.c_str() || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX)
+            return false;
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    bool ParseDouble(const std::string& text, double& value)
+    {
+        char* end = nullptr;
+        errno = 0;
+        value = std::strtod(text.c_str(), &end);
+        return end != text.c_str() && *end == '\0' && errno != ERANGE;
+    }
+
+    template <typename T, typename Predicate>
+    bool AllOf(const std::vector<T>& values, Predicate predicate)
+    {
+        for (const T& value : values)
+            if (!predicate(value)) return false;
+        return true;
+    }
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: ElevatorSweep [--format json|csv] [--floors 20,30] [--cars 4,6,8] [--move-ms 600,400]\n"
+            "                     [--stay-open-ms 2000,1500] [--rates 10,20,40]\n"
+            "                     [--profiles up-peak,down-peak,lunch,inter-floor]\n"
+            "                     [--modes collective,destination] [--replications 10] [--minutes 60]\n"
+            "                     [--seed 1] [--threads 0]\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string format = "json";
+    SweepGrid grid;
+    double minutes = 60.0;
+    int threads = 0;
+    bool valid = true;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            PrintUsage();
+            return 1;
+        }
+        if (std::strcmp(arg, "--format") == 0) format = value;
+        else if (std::strcmp(arg, "--floors") == 0) grid.floor_counts = ParseList<int>(value, ParseInt, valid);
+        else if (std::strcmp(arg, "--cars") == 0) grid.elevator_counts = ParseList<int>(value, ParseInt, valid);
+        else if (std::strcmp(arg, "--move-ms") == 0) grid.move_ms = ParseList<int>(value, ParseInt, valid);
+        else if (std::strcmp(arg, "--stay-open-ms") == 0) grid.stay_open_ms = ParseList<int>(value, ParseInt, valid);
+        else if (std::strcmp(arg, "--rates") == 0) grid.passengers_per_minute = ParseList<double>(value, ParseDouble, valid);
+        else if (std::strcmp(arg, "--profiles") == 0) grid.profiles = ParseList<TrafficProfile>(value, TrafficGenerator::ParseProfile, valid);
+        else if (std::strcmp(arg, "--modes") == 0) grid.modes = ParseList<DispatchMode>(value, ElevatorGroup::ParseMode, valid);
+        else if (std::strcmp(arg, "--replications") == 0) valid = ParseInt(value, grid.replications) && valid;
+        else if (std::strcmp(arg, "--minutes") == 0) valid = ParseDouble(value, minutes) && valid;
+        else if (std::strcmp(arg, "--seed") == 0) grid.base_seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--threads") == 0) valid = ParseInt(value, threads) && valid;
+        else {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+    // 楼层少于2层或没有电梯时乘客全部被丢弃, 输出看似正常的全零结果; 负数会使容器尺寸溢出
+    if (!valid || (format != "json" && format != "csv") ||
+        !AllOf(grid.floor_counts, [](int floors) { return floors >= 2 && floors <= SimulationConfig::MaxFloorCount; }) ||
+        !AllOf(grid.elevator_counts, [](int cars) { return cars >= 1 && cars <= SimulationConfig::MaxElevatorCount; }) ||
+        !AllOf(grid.move_ms, [](int move_ms) { return move_ms > 0; }) ||
+        !AllOf(grid.stay_open_ms, [](int stay_open_ms) { return stay_open_ms >= 0; }) ||
+        !AllOf(grid.passengers_per_minute, [](double rate) { return rate >= 0; }) ||
+        minutes < 0 || grid.replications < 0 || threads < 0) {
+        PrintUsage();
+        return 1;
+    }
+    grid.duration_ms = static_cast<TimerService::Time>(minutes * 60 * 1000);
+
+    ThreadPool pool(static_cast<unsigned>(threads));
+    SweepRunner runner(pool);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SweepResult> results = runner.Run(grid);
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (format == "csv")
+        std::printf("%s\n", SweepResult::CsvHeader().c_str());
+    double busy_ms = 0;
+    for (const SweepResult& result : results) {
+        std::printf("%s\n", format == "csv" ? result.ToCsv().c_str() : result.ToJson().c_str());
+        busy_ms += result.wall_ms;
+    }
+
+    // 并行效率 = 各次模拟耗时之和 / (线程数 × 总耗时)
+    double efficiency = wall_s > 0 ? busy_ms / 1000.0 / (pool.GetThreadCount() * wall_s) : 0.0;
+    std::fprintf(stderr, "%llu simulations on %u threads in %.2f s, efficiency %.0f%%, %llu steals\n",
+        static_cast<unsigned long long>(runner.GetSimulationCount()), pool.GetThreadCount(), wall_s,
+        efficiency * 100, static_cast<unsigned long long>(pool.GetStealCount()));
+    return 0;
+}
@@ -0,0 +1,60 @@
+﻿#include "Checkpoint.h"
+#include <cstdio>
+
+namespace {
+    const char FileMagic[4] = { 'E', 'L', 'C', 'K' };
+}
+
+void CheckpointWriter::PutMask(const FloorMask& mask)
+{
+    Put<std::int32_t>(mask.Size());
+    for (int w = 0; w < mask.WordCount(); ++w)
+        Put(mask.Word(w));
+}
+
+bool CheckpointWriter::SaveToFile(const std::string& path) const
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(FileMagic, 1, sizeof(FileMagic), file) == sizeof(FileMagic)
+        && std::fwrite(&CheckpointVersion, sizeof(CheckpointVersion), 1, file) == 1
+        && (data.empty() || std::fwrite(data.data(), 1, data.size(), file) == data.size());
+    return std::fclose(file) == 0 && ok;
+}
+
+bool CheckpointReader::GetMask(FloorMask& mask)
+{
+    if (Get<std::int32_t>() != mask.Size()) return Fail();
+    FloorMask loaded(mask.Size());
+    for (int w = 0; w < loaded.WordCount(); ++w) {
+        std::uint64_t word = Get<std::uint64_t>();
+        for (int bit = 0; word; ++bit, word >>= 1)
+            if (word & 1) loaded.Set(w * 64 + bit);
+    }
+    if (!ok) return false;
+    mask = loaded;
+    return true;
+}
+
+bool CheckpointReader::LoadFile(const std::string& path, CheckpointReader& reader)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::vector<char> data;
+    char chunk[64 * 1024];
+    size_t count;
+    while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + count);
+    bool error = std::ferror(file) != 0;
+    std::fclose(file);
+
+    std::uint32_t version = 0;
+    if (error || data.size() < sizeof(FileMagic) + sizeof(version)
+        || std::memcmp(data.data(), FileMagic, sizeof(FileMagic)) != 0)
+        return false;
+    std::memcpy(&version, data.data() + sizeof(FileMagic), sizeof(version));
+    if (version != CheckpointVersion) return false;
+    data.erase(data.begin(), data.begin() + sizeof(FileMagic) + sizeof(version));
+    reader = CheckpointReader(std::move(data));
+    return true;
+}
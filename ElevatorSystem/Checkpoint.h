@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "FloorMask.h"
+#include "TimerService.h"
+
+// 检查点文件: "ELCK" | 版本 | 数据, 数据按各模块SaveState的顺序定长写入(小端)
+// 各模块写入前先写一个段标记, 读取时段标记或长度不符即判定为文件损坏; 恢复失败后的对象状态不确定, 应丢弃
+const std::uint32_t CheckpointVersion = 8;
+
+// 生成段标记, 如CheckpointTag("CAR ")
+constexpr std::uint32_t CheckpointTag(const char (&name)[5])
+{
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(name[0]))
+        | static_cast<std::uint32_t>(static_cast<unsigned char>(name[1])) << 8
+        | static_cast<std::uint32_t>(static_cast<unsigned char>(name[2])) << 16
+        | static_cast<std::uint32_t>(static_cast<unsigned char>(name[3])) << 24;
+}
+
+class CheckpointWriter
+{
+public:
+    template <typename T>
+    void Put(T value) {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "只能直接写入数值类型");
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+    void PutMask(const FloorMask& mask);
+    template <typename T>
+    void PutVector(const std::vector<T>& values) {
+        Put<std::uint64_t>(values.size());
+        for (const T& value : values) Put(value);
+    }
+
+    const std::vector<char>& Data() const { return data; }
+    bool SaveToFile(const std::string& path) const;
+private:
+    std::vector<char> data;
+};
+
+class CheckpointReader
+{
+public:
+    CheckpointReader() {}
+    explicit CheckpointReader(std::vector<char> data) : data(std::move(data)) {}
+public:
+    // 读取失败后Ok()为false, 之后的读取都返回默认值, 调用方只需在最后检查一次
+    template <typename T>
+    T Get() {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "只能直接读取数值类型");
+        T value{};
+        if (!ok || data.size() - offset < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+    bool GetMask(FloorMask& mask); // 楼层数必须与mask一致
+    template <typename T>
+    bool GetVector(std::vector<T>& values) {
+        std::uint64_t count = Get<std::uint64_t>();
+        if (!ok || count > (data.size() - offset) / sizeof(T)) return Fail();
+        values.resize(static_cast<size_t>(count));
+        for (T& value : values) value = Get<T>();
+        return ok;
+    }
+    bool Expect(std::uint32_t tag) { return Get<std::uint32_t>() == tag || Fail(); }
+    bool Fail() { ok = false; return false; }
+    bool Ok() const { return ok; }
+    bool AtEnd() const { return offset == data.size(); }
+
+    static bool LoadFile(const std::string& path, CheckpointReader& reader); // 校验文件头
+private:
+    std::vector<char> data;
+    size_t offset = 0;
+    bool ok = true;
+};
+
+// 恢复时需要重新调度的定时
+// 全部模块读完后按原编号排序依次调度, 新编号保持原来的相对顺序, 同一时刻的事件仍按原顺序执行
+struct PendingTimer {
+    TimerService::TimerId id = TimerService::InvalidTimer; // 保存时的编号
+    std::function<void()> resume;
+};
@@ -0,0 +1,147 @@
+﻿#include "ControlProtocol.h"
+
+namespace {
+    const size_t MaxFrameSize = 0xFFFF;
+
+    std::uint16_t GetU16(const unsigned char* data)
+    {
+        return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    void PutU16(std::vector<unsigned char>& out, std::uint16_t value)
+    {
+        out.push_back(static_cast<unsigned char>(value));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+    }
+
+    void PutU64(std::vector<unsigned char>& out, std::uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i)
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+
+    void PutHeader(std::vector<unsigned char>& out, size_t size, ControlProtocol::FrameType type, std::uint8_t arg)
+    {
+        PutU16(out, static_cast<std::uint16_t>(size));
+        out.push_back(static_cast<unsigned char>(type));
+        out.push_back(arg);
+    }
+
+    // 每层一位, 从低位开始
+    template <typename Predicate>
+    void PutBitmap(std::vector<unsigned char>& out, int floor_count, Predicate test)
+    {
+        for (int base = 0; base < floor_count; base += 8) {
+            unsigned char bits = 0;
+            for (int bit = 0; bit < 8 && base + bit < floor_count; ++bit)
+                if (test(base + bit)) bits |= static_cast<unsigned char>(1 << bit);
+            out.push_back(bits);
+        }
+    }
+}
+
+int ControlProtocol::ParseRequest(const unsigned char* data, size_t size, Frame& frame)
+{
+    if (size < HeaderSize) return 0;
+    FrameType type = static_cast<FrameType>(data[2]);
+    if (GetU16(data) != RequestSize || !(IsCommand(type) || type == FrameType::QueryState || type == FrameType::Sync))
+        return -1;
+    if (size < RequestSize) return 0;
+    frame.type = type;
+    frame.arg = data[3];
+    frame.a = GetU16(data + 4);
+    frame.b = GetU16(data + 6);
+    return static_cast<int>(RequestSize);
+}
+
+bool ControlProtocol::ToCommand(const Frame& frame, int elevator_count, int floor_count, SimCommand& command)
+{
+    command = SimCommand();
+    switch (frame.type) {
+    case FrameType::HallCall:
+        if (frame.a >= floor_count || frame.arg > 1) return false;
+        command.type = SimCommand::Type::HallCall;
+        command.floor = frame.a;
+        command.dir = frame.arg == 0 ? Direction::Up : Direction::Down;
+        return true;
+    case FrameType::CarCall:
+        if (frame.a >= elevator_count || frame.b >= floor_count) return false;
+        command.type = SimCommand::Type::CarCall;
+        command.car = frame.a;
+        command.floor = frame.b;
+        return true;
+    case FrameType::OpenDoor:
+    case FrameType::CloseDoor:
+    case FrameType::Alarm:
+        if (frame.a >= elevator_count) return false;
+        command.type = frame.type == FrameType::OpenDoor ? SimCommand::Type::OpenDoor
+            : frame.type == FrameType::CloseDoor ? SimCommand::Type::CloseDoor : SimCommand::Type::Alarm;
+        command.car = frame.a;
+        return true;
+    case FrameType::Passenger:
+        if (frame.a >= floor_count || frame.b >= floor_count || frame.a == frame.b) return false;
+        command.type = SimCommand::Type::Passenger;
+        command.floor = frame.a;
+        command.target = frame.b;
+        return true;
+    case FrameType::Service:
+        if (frame.a >= elevator_count || frame.arg > 1) return false;
+        command.type = SimCommand::Type::Service;
+        command.car = frame.a;
+        command.target = frame.arg;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ControlProtocol::AppendRequest(std::vector<unsigned char>& out, const Frame& frame)
+{
+    PutHeader(out, RequestSize, frame.type, frame.arg);
+    PutU16(out, frame.a);
+    PutU16(out, frame.b);
+}
+
+bool ControlProtocol::AppendState(std::vector<unsigned char>& out, std::uint16_t tag, const GroupSnapshot& snapshot)
+{
+    int car_count = static_cast<int>(snapshot.cars.size());
+    int floor_count = static_cast<int>(snapshot.hall_buttons.size());
+    size_t bitmap = (floor_count + 7) / 8;
+    size_t size = HeaderSize + 24 + car_count * (5 + bitmap) + 2 * bitmap;
+    if (size > MaxFrameSize || car_count > 0xFFFF) return false;
+
+    out.reserve(out.size() + size);
+    PutHeader(out, size, FrameType::State, 0);
+    PutU16(out, tag);
+    PutU16(out, static_cast<std::uint16_t>(car_count));
+    PutU16(out, static_cast<std::uint16_t>(floor_count));
+    PutU16(out, 0);
+    PutU64(out, snapshot.version);
+    PutU64(out, static_cast<std::uint64_t>(snapshot.now));
+    for (const CarSnapshot& car : snapshot.cars) {
+        PutU16(out, static_cast<std::uint16_t>(car.floor));
+        out.push_back(static_cast<unsigned char>(car.state));
+        out.push_back(static_cast<unsigned char>(car.direction));
+        out.push_back(static_cast<unsigned char>((car.out_of_service ? 1 : 0) | (car.stalled ? 2 : 0)));
+        PutBitmap(out, floor_count, [&](int floor) { return floor < car.targets.Size() && car.targets.Test(floor); });
+    }
+    PutBitmap(out, floor_count, [&](int floor) { return snapshot.hall_buttons[floor].upPressed; });
+    PutBitmap(out, floor_count, [&](int floor) { return snapshot.hall_buttons[floor].downPressed; });
+    return true;
+}
+
+void ControlProtocol::AppendStatus(std::vector<unsigned char>& out, std::uint16_t tag, std::uint64_t accepted, std::uint64_t rejected)
+{
+    PutHeader(out, HeaderSize + 20, FrameType::Status, 0);
+    PutU16(out, tag);
+    PutU16(out, 0);
+    PutU64(out, accepted);
+    PutU64(out, rejected);
+}
+
+void ControlProtocol::AppendError(std::vector<unsigned char>& out, std::uint16_t tag, std::uint16_t code)
+{
+    PutHeader(out, HeaderSize + 4, FrameType::Error, 0);
+    PutU16(out, tag);
+    PutU16(out, code);
+}
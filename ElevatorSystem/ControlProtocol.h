@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SimulationThread.h"
+
+// 本机控制端口的二进制协议, 整数均为小端, 电梯和楼层都从0开始
+// 每帧以4字节帧头开始: u16帧总长(含帧头) | u8类型 | u8参数
+// 请求帧固定8字节, 帧头后是两个u16(a, b):
+//   HallCall    参数为方向(0上 1下), a为楼层
+//   CarCall     a为电梯, b为楼层
+//   OpenDoor / CloseDoor / Alarm    a为电梯
+//   Passenger   a为出发层, b为目的层(目的层派梯)
+//   Service     参数为1停用、0恢复, a为电梯
+//   QueryState  a为标签, 应答State
+//   Sync        a为标签, 之前的命令都进入模拟线程的队列后应答Status
+// 应答帧:
+//   State   u16标签 | u16电梯数 | u16楼层数 | u16保留 | u64快照版本 | i64虚拟时间(ms)
+//           | 每部电梯: u16楼层 u8状态 u8方向 u8标志(1停用 2卡滞) 内选位图 | 上行外呼位图 | 下行外呼位图
+//           位图每层一位, 占(楼层数+7)/8字节; 状态和方向取ElevatorState、Direction的序号
+//   Status  u16标签 | u16保留 | u64已提交命令数 | u64拒绝命令数(电梯或楼层越界), 均为本连接的累计值
+//   Error   u16标签 | u16错误码(1状态超过单帧上限)
+class ControlProtocol
+{
+public:
+    enum class FrameType : std::uint8_t {
+        HallCall = 1,
+        CarCall = 2,
+        OpenDoor = 3,
+        CloseDoor = 4,
+        Alarm = 5,
+        Passenger = 6,
+        Service = 7,
+        QueryState = 0x20,
+        Sync = 0x21,
+        State = 0x80,
+        Status = 0x81,
+        Error = 0x82
+    };
+    struct Frame {
+        FrameType type = FrameType::HallCall;
+        std::uint8_t arg = 0;
+        std::uint16_t a = 0;
+        std::uint16_t b = 0;
+    };
+    static const size_t HeaderSize = 4;
+    static const size_t RequestSize = 8;
+    static const std::uint16_t StateTooLarge = 1;
+
+    // 从data开头解析一个请求帧, 返回帧长; 数据不足一帧返回0, 帧长或类型不对返回-1(应断开连接)
+    static int ParseRequest(const unsigned char* data, size_t size, Frame& frame);
+    static bool IsCommand(FrameType type) { return type >= FrameType::HallCall && type <= FrameType::Service; }
+    // 命令帧转成模拟命令, 电梯或楼层越界返回false
+    static bool ToCommand(const Frame& frame, int elevator_count, int floor_count, SimCommand& command);
+
+    static void AppendRequest(std::vector<unsigned char>& out, const Frame& frame); // 客户端编码请求
+    static bool AppendState(std::vector<unsigned char>& out, std::uint16_t tag, const GroupSnapshot& snapshot); // 超过单帧上限返回false, out不变
+    static void AppendStatus(std::vector<unsigned char>& out, std::uint16_t tag, std::uint64_t accepted, std::uint64_t rejected);
+    static void AppendError(std::vector<unsigned char>& out, std::uint16_t tag, std::uint16_t code);
+};
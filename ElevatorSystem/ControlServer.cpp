@@ -0,0 +1,183 @@
+﻿#include "ControlServer.h"
+#include "ControlProtocol.h"
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace {
+    const qint64 ReadBufferBytes = 256 * 1024; // 套接字读缓冲上限, 超出部分留在系统缓冲中形成反压
+    const size_t BatchSize = 4096;             // 攒满一批就提交, 减少命令在界面线程的停留
+    const int RetryMs = 1;
+}
+
+const QString ControlServer::DefaultName = "elevator-control";
+
+ControlServer::ControlServer(SimulationThread& simulation, QObject* parent)
+    : QObject(parent), simulation(simulation), tcp_server(new QTcpServer(this)),
+    local_server(new QLocalServer(this)), retry_timer(new QTimer(this))
+{
+    retry_timer->setSingleShot(true);
+    connect(retry_timer, &QTimer::timeout, this, &ControlServer::RetryBlocked);
+    connect(tcp_server, &QTcpServer::newConnection, this, [=]() {
+        while (QTcpSocket* socket = tcp_server->nextPendingConnection()) {
+            socket->setReadBufferSize(ReadBufferBytes);
+            socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            Accept(socket);
+        }
+    });
+    connect(local_server, &QLocalServer::newConnection, this, [=]() {
+        while (QLocalSocket* socket = local_server->nextPendingConnection()) {
+            socket->setReadBufferSize(ReadBufferBytes);
+            connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+            Accept(socket);
+        }
+    });
+}
+
+ControlServer::~ControlServer()
+{
+    // 连接对象是服务器的子对象, 先断开信号再随服务器销毁
+    for (auto& entry : connections)
+        entry.first->disconnect(this);
+    connections.clear();
+}
+
+bool ControlServer::Listen(quint16 port, const QString& name)
+{
+    bool tcp = tcp_server->listen(QHostAddress::LocalHost, port);
+    QLocalServer::removeServer(name); // 上次异常退出留下的套接字文件
+    local_server->setSocketOptions(QLocalServer::UserAccessOption);
+    bool local = local_server->listen(name);
+    return tcp || local;
+}
+
+void ControlServer::Close()
+{
+    tcp_server->close();
+    local_server->close();
+    retry_timer->stop();
+    std::vector<QIODevice*> devices;
+    for (auto& entry : connections)
+        devices.push_back(entry.first);
+    connections.clear();
+    for (QIODevice* device : devices) {
+        device->disconnect(this);
+        device->close();
+        device->deleteLater();
+    }
+}
+
+quint16 ControlServer::GetPort() const
+{
+    return tcp_server->serverPort();
+}
+
+void ControlServer::Accept(QIODevice* device)
+{
+    connections.emplace(device, Connection());
+    connect(device, &QIODevice::readyRead, this, [=]() { Process(device); });
+    connect(device, &QObject::destroyed, this, [=]() { connections.erase(device); });
+    Process(device); // 连接建立前已到达的数据
+}
+
+void ControlServer::Process(QIODevice* device)
+{
+    auto it = connections.find(device);
+    if (it == connections.end()) return;
+    Connection& connection = it->second;
+    // 上一批还没进入队列时不再读取, 数据留在套接字缓冲中
+    if (!Flush(connection)) {
+        retry_timer->start(RetryMs);
+        return;
+    }
+
+    reply.clear();
+    const int elevator_count = simulation.GetElevatorCount();
+    const int floor_count = simulation.GetFloorCount();
+    bool blocked = false;
+    while (!blocked) {
+        QByteArray data = device->read(ReadBufferBytes);
+        if (data.isEmpty() && connection.buffer.isEmpty()) break;
+        connection.buffer.append(data);
+
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(connection.buffer.constData());
+        size_t size = static_cast<size_t>(connection.buffer.size());
+        size_t offset = 0;
+        while (offset < size) {
+            ControlProtocol::Frame frame;
+            int length = ControlProtocol::ParseRequest(bytes + offset, size - offset, frame);
+            if (length == 0) break;
+            if (length < 0) {
+                // 帧错误后无法再找到帧边界, 断开连接
+                connections.erase(it);
+                device->disconnect(this);
+                device->close();
+                device->deleteLater();
+                return;
+            }
+            if (ControlProtocol::IsCommand(frame.type)) {
+                SimCommand command;
+                if (ControlProtocol::ToCommand(frame, elevator_count, floor_count, command))
+                    connection.pending.push_back(command);
+                else
+                    ++connection.rejected;
+                if (connection.pending.size() >= BatchSize && !Flush(connection)) {
+                    offset += length;
+                    blocked = true;
+                    break;
+                }
+            }
+            else {
+                // 查询按顺序应答: 之前的命令全部进入队列后再回复
+                if (!Flush(connection)) {
+                    blocked = true;
+                    break;
+                }
+                if (frame.type == ControlProtocol::FrameType::Sync) {
+                    ControlProtocol::AppendStatus(reply, frame.a, connection.accepted, connection.rejected);
+                }
+                else {
+                    // 与界面同在界面线程上读取快照, 读到的是最新发布的版本, 刚提交的命令可能尚未生效
+                    if (!ControlProtocol::AppendState(reply, frame.a, simulation.ReadSnapshot()))
+                        ControlProtocol::AppendError(reply, frame.a, ControlProtocol::StateTooLarge);
+                }
+            }
+            offset += length;
+        }
+        connection.buffer.remove(0, static_cast<qsizetype>(offset));
+        if (data.isEmpty()) break;
+    }
+    if (!blocked && !Flush(connection))
+        blocked = true;
+    if (blocked)
+        retry_timer->start(RetryMs);
+    if (!reply.empty())
+        device->write(reinterpret_cast<const char*>(reply.data()), static_cast<qint64>(reply.size()));
+}
+
+bool ControlServer::Flush(Connection& connection)
+{
+    size_t count = connection.pending.size() - connection.posted;
+    if (count > 0) {
+        size_t posted = simulation.Post(connection.pending.data() + connection.posted, count);
+        connection.posted += posted;
+        connection.accepted += posted;
+        if (posted < count) return false;
+    }
+    connection.pending.clear();
+    connection.posted = 0;
+    return true;
+}
+
+void ControlServer::RetryBlocked()
+{
+    std::vector<QIODevice*> devices;
+    for (auto& entry : connections)
+        devices.push_back(entry.first);
+    for (QIODevice* device : devices)
+        Process(device);
+}
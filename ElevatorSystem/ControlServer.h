@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "SimulationThread.h"
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+class QTimer;
+
+// 本机控制端口: 外部系统(楼宇管理模拟、压测工具)用ControlProtocol的二进制帧呼梯、控制门和报警、查询状态
+// 同时监听本地套接字(Linux上为Unix域套接字, Windows上为命名管道)和回环地址的TCP端口
+// 在界面线程上运行: 每次读入的命令整批提交到模拟线程的命令队列, 队列满时暂停读取, 由套接字缓冲向客户端反压, 不丢命令
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    ControlServer(SimulationThread& simulation, QObject* parent = nullptr);
+    ~ControlServer();
+public:
+    bool Listen(quint16 port = DefaultPort, const QString& name = DefaultName); // 两者之一监听成功即返回true
+    void Close(); // 断开所有连接并释放端口和套接字名
+    quint16 GetPort() const;
+    static const quint16 DefaultPort = 9465;
+    static const QString DefaultName;
+private:
+    struct Connection {
+        QByteArray buffer;                // 尚未解析的字节
+        std::vector<SimCommand> pending;  // 已解析、尚未进入队列的命令
+        size_t posted = 0;                // pending中已进入队列的条数
+        std::uint64_t accepted = 0;
+        std::uint64_t rejected = 0;
+    };
+    void Accept(QIODevice* device);
+    void Process(QIODevice* device);
+    bool Flush(Connection& connection); // 全部提交返回true
+    void RetryBlocked();
+
+private:
+    SimulationThread& simulation;
+    QTcpServer* tcp_server;
+    QLocalServer* local_server;
+    QTimer* retry_timer; // 队列满时稍后重试
+    std::unordered_map<QIODevice*, Connection> connections;
+    std::vector<unsigned char> reply; // 每次复用
+};
@@ -0,0 +1,131 @@
+﻿#include "Dispatcher.h"
+#include <algorithm>
+#include <cstdlib>
+
+CarStatus Dispatcher::Status(const ElevatorCar& car)
+{
+    CarStatus status;
+    status.floor = car.GetCurrentFloor();
+    status.direction = car.GetState() == ElevatorState::Idle ? Direction::None : car.GetDirection();
+    status.state = car.GetState();
+    status.route = car.GetRouteSummary();
+    status.busy_ms = car.GetBusyTime();
+    return status;
+}
+
+namespace {
+    // 从pos出发朝extreme方向共有count个停靠, 估算严格位于pos与target之间的停靠数
+    // extreme为该方向最远的停靠层; 目标层本身的停靠不计入(反正要在那里开门)
+    long long StopsBefore(int count, int pos, int extreme, int target)
+    {
+        if (count <= 0) return 0;
+        int span = std::abs(extreme - pos);
+        int reach = std::abs(target - pos);
+        if (span < reach) return count;
+        if (span == reach) return count - 1;
+        return static_cast<long long>(count) * reach / span;
+    }
+
+    // 从from到to途经stops个停靠(不含to), 按停靠均匀分布把行程分成若干段, 每段从静止出发到停稳
+    long long TravelTime(const MotionTable& motion, int from, int to, long long stops)
+    {
+        const int distance = std::abs(to - from);
+        if (distance == 0) return 0;
+        if (!motion.IsKinematic() || stops <= 0) return motion.RunTime(from, to); // 匀速时与分段无关
+        const long long legs = std::min<long long>(stops, distance - 1) + 1;
+        const int step = to > from ? 1 : -1;
+        long long time = 0;
+        int at = from;
+        for (long long leg = 1; leg <= legs; ++leg) {
+            int next = from + step * static_cast<int>(distance * leg / legs);
+            time += motion.RunTime(at, next);
+            at = next;
+        }
+        return time;
+    }
+}
+
+long long Dispatcher::EstimateArrival(const CarStatus& status, const CarTiming& timing, const MotionTable& motion, int floor,
+    int* stops_before)
+{
+    // 电梯经过有请求的楼层都会停靠(不区分上下行), 所以只需判断目标是否在当前行进方向的前方
+    const RouteSummary& route = status.route;
+    const int pos = status.floor;
+    long long travel = 0;   // 行驶时间
+    long long stops = 0;    // 到达前的停靠次数
+    long long reversals = 0;
+
+    if (status.direction == Direction::None || route.stop_count == 0) {
+        travel = motion.RunTime(pos, floor);
+    }
+    else if (status.direction == Direction::Up) {
+        if (floor >= pos) {
+            // 顺路
+            stops = StopsBefore(route.stops_above, pos, route.upper, floor);
+            travel = TravelTime(motion, pos, floor, stops);
+        }
+        else {
+            // 先到最高停靠层再折返
+            int far = std::max(route.upper, pos);
+            long long after = StopsBefore(route.stops_below, pos, route.lower, floor);
+            travel = TravelTime(motion, pos, far, route.stops_above - 1) + TravelTime(motion, far, floor, after);
+            stops = route.stops_above + after;
+            reversals = 1;
+        }
+    }
+    else {
+        if (floor <= pos) {
+            stops = StopsBefore(route.stops_below, pos, route.lower, floor);
+            travel = TravelTime(motion, pos, floor, stops);
+        }
+        else {
+            // 先到最低停靠层再折返
+            int far = route.lower < 0 ? pos : std::min(route.lower, pos);
+            long long after = StopsBefore(route.stops_above, pos, route.upper, floor);
+            travel = TravelTime(motion, pos, far, route.stops_below - 1) + TravelTime(motion, far, floor, after);
+            stops = route.stops_below + after;
+            reversals = 1;
+        }
+    }
+    if (stops_before) *stops_before = static_cast<int>(stops);
+    return status.busy_ms + travel + stops * DwellTime(timing) + reversals * motion.ReversalTime();
+}
+
+long long Dispatcher::AssignmentCost(const CarStatus& status, const CarTiming& timing, const MotionTable& motion, int floor,
+    bool already_stopping)
+{
+    int stops_before = 0;
+    long long cost = EstimateArrival(status, timing, motion, floor, &stops_before);
+    if (!already_stopping) {
+        // 之后的每个停靠都要多等一次开关门
+        int stops_after = std::max(0, status.route.stop_count - stops_before);
+        cost += static_cast<long long>(stops_after) * DwellTime(timing);
+    }
+    return cost;
+}
+
+long long Dispatcher::DestinationCost(const CarStatus& status, const CarTiming& timing, const MotionTable& motion,
+    int origin, int destination, bool stops_at_origin, bool stops_at_destination)
+{
+    long long cost = AssignmentCost(status, timing, motion, origin, stops_at_origin);
+    if (!stops_at_destination)
+        cost += DwellTime(timing);
+
+    // 到达origin时电梯的运行方向; 若与乘客方向相反且前方还有停靠, 乘客需要先随电梯绕行
+    const RouteSummary& route = status.route;
+    if (status.direction == Direction::None || route.stop_count == 0)
+        return cost;
+    bool ahead = status.direction == Direction::Up ? origin >= status.floor : origin <= status.floor;
+    bool heading_up = (status.direction == Direction::Up) == ahead;
+    bool trip_up = destination > origin;
+    if (heading_up == trip_up)
+        return cost;
+    int far = origin;
+    if (heading_up && route.upper > origin)
+        far = route.upper;
+    else if (!heading_up && route.lower >= 0 && route.lower < origin)
+        far = route.lower;
+    if (far != origin)
+        cost += 2LL * motion.RunTime(origin, far) + motion.ReversalTime();
+    return cost;
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include "ElevatorCar.h"
+#include "Kinematics.h"
+#include "Utilities.h"
+
+// 派梯时用到的单部电梯状态
+struct CarStatus {
+    int floor = 0;
+    Direction direction = Direction::None;
+    ElevatorState state = ElevatorState::Idle;
+    RouteSummary route;
+    int busy_ms = 0;
+};
+
+// 基于预计到达时间(ETA)的代价函数: 行驶时间 + 途中停靠的开关门时间 + 换向代价
+// 行驶时间查电梯的运行时间表(MotionTable), 不逐层模拟
+class Dispatcher
+{
+public:
+    static CarStatus Status(const ElevatorCar& car);
+    // stops_before非空时返回到达前途经的停靠数
+    static long long EstimateArrival(const CarStatus& status, const CarTiming& timing, const MotionTable& motion, int floor,
+        int* stops_before = nullptr);
+    // 派梯代价: 到达时间 + 新增停靠给后续各停靠层带来的延误; already_stopping表示该层已在停靠计划中
+    static long long AssignmentCost(const CarStatus& status, const CarTiming& timing, const MotionTable& motion, int floor,
+        bool already_stopping);
+    // 目的层派梯代价: 在AssignmentCost基础上, 加上目的层的新增停靠以及接到乘客后反向运行的绕行时间
+    static long long DestinationCost(const CarStatus& status, const CarTiming& timing, const MotionTable& motion,
+        int origin, int destination, bool stops_at_origin, bool stops_at_destination);
+    static int DwellTime(const CarTiming& timing) { return timing.open_ms + timing.stay_open_ms + timing.close_ms; }
+};
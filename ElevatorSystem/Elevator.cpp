@@ -1,32 +1,30 @@
 ﻿#include "Elevator.h"
 
-Elevator::Elevator(int elevator_id, int floor_cnt, QLabel* elevator_floor, QWidget* parent)
-    : QWidget(parent), elevator_id(elevator_id), floor_cnt(floor_cnt),
-    current_floor(0), state(ElevatorState::Idle), direction(Direction::None),
-	elevator_floor(elevator_floor), is_door_open(false), is_alarm_active(false)
+Elevator::Elevator(SimulationThread* simulation, int index, QWidget* parent)
+    : QWidget(parent), simulation(simulation), index(index), elevator_id(index + 1),
+	floor_cnt(simulation->GetFloorCount()), snapshot(simulation->ReadSnapshot().cars[index])
 {
     ui.setupUi(this);
+    floor_numbers.reserve(floor_cnt);
+    floor_texts.reserve(floor_cnt);
+    for (int i = 0; i < floor_cnt; ++i) {
+        floor_numbers.push_back(QString::number(i + 1));
+        floor_texts.push_back(QString("当前楼层:   %1 楼").arg(i + 1));
+    }
     Init();
 }
 
+Elevator::~Elevator()
+{
+}
+
 void Elevator::Init()
 {
     this->setFixedSize(280, 480);
-    this->InitParams();
     this->InitWidget();
     this->UpdateDisplay();
 }
 
-void Elevator::InitParams()
-{
-    current_floor = 0;
-    state = ElevatorState::Idle;
-    direction = Direction::None;
-    internal_targets.clear();
-    external_up_requests.clear();
-    external_down_requests.clear();
-}
-
 void Elevator::InitWidget()
 {
     QWidget* mainContainer = new QWidget();
@@ -41,7 +39,7 @@ void Elevator::InitWidget()
     mainLayout->setContentsMargins(10, 10, 10, 10);
     mainLayout->setAlignment(Qt::AlignTop);
 
-    QLabel* titleLabel = new QLabel(QString("电梯 %1").arg(elevator_id), mainContainer);
+    titleLabel = new QLabel(QString("电梯 %1").arg(elevator_id), mainContainer);
     titleLabel->setStyleSheet("font-size: 12px; font-weight: bold; color: #333;");
     titleLabel->setAlignment(Qt::AlignCenter);
     mainLayout->addWidget(titleLabel);
@@ -49,9 +47,9 @@ void Elevator::InitWidget()
     QHBoxLayout* bodyLayout = new QHBoxLayout();
     mainLayout->addLayout(bodyLayout, 1);
 
-    QSlider* floorSlider = new QSlider(Qt::Vertical, mainContainer);
+    floorSlider = new QSlider(Qt::Vertical, mainContainer);
     floorSlider->setRange(1, floor_cnt);
-    floorSlider->setValue(current_floor + 1);
+    floorSlider->setValue(snapshot.floor + 1);
     floorSlider->setEnabled(false);
     floorSlider->setStyleSheet(
         "QSlider::groove:vertical {"
@@ -66,7 +64,7 @@ void Elevator::InitWidget()
         "}"
     );
 
-    QLabel* floorValueLabel = new QLabel(QString::number(current_floor + 1), mainContainer);
+    floorValueLabel = new QLabel(floor_numbers[snapshot.floor], mainContainer);
     floorValueLabel->setObjectName("floorValueLabel");
     floorValueLabel->setAlignment(Qt::AlignCenter);
     floorValueLabel->setStyleSheet("font-weight: bold; color: blue;");
@@ -80,34 +78,13 @@ void Elevator::InitWidget()
     rightLayout->setSpacing(10);
     bodyLayout->addLayout(rightLayout, 1);
 
-    QGridLayout* btnGrid = new QGridLayout();
-    btnGrid->setSpacing(3);
-    const int BUTTONS_PER_ROW = 5;
-    for (int i = 0; i < floor_cnt; ++i) {
-        QPushButton* btn = new QPushButton(QString::number(i + 1), mainContainer);
-        btn->setFixedSize(40, 40);
-        btn->setStyleSheet(
-            "QPushButton {"
-            "   border: 1px solid #666;"
-            "   border-radius: 5px;"
-            "   background-color: white;"
-            "}"
-            "QPushButton:disabled {"
-            "   background-color: red;"
-            "}"
-            "QPushButton:pressed {"
-            "   background-color: #ccc;"
-            "   border: 1px solid #999;"
-            "   color: #fff;"
-            "}"
-        );
-        connect(btn, &QPushButton::clicked, this, [=]() {
-            this->AddInternalTarget(i);
-            });
-        floorButtons.push_back(btn);
-        btnGrid->addWidget(btn, i / BUTTONS_PER_ROW, i % BUTTONS_PER_ROW);
-    }
-    rightLayout->addLayout(btnGrid);
+    keypad = new FloorKeypad(floor_cnt, mainContainer);
+    keypad->SetActiveFloors(snapshot.targets); // 与Bind一致: 新建的面板立即显示已有的内选, 不等下一份快照
+    keypad->SetServedFloors(simulation->GetServedFloors(index));
+    connect(keypad, &FloorKeypad::FloorClicked, this, [=](int floor) {
+        PostCommand(SimCommand::Type::CarCall, floor);
+        });
+    rightLayout->addWidget(keypad, 1);
 
     QHBoxLayout* doorLayout = new QHBoxLayout();
     QPushButton* openBtn = CreateDoorButton("开门", "lightgreen");
@@ -131,6 +108,21 @@ void Elevator::InitWidget()
     connect(alarmBtn, &QPushButton::clicked, this, &Elevator::HandleAlarm);
     doorLayout->addWidget(alarmBtn);
 
+    // 停用/恢复: 停用后外呼改派给其他电梯, 车内乘客照常送达
+    serviceBtn = new QPushButton(this);
+    serviceBtn->setFixedSize(50, 20);
+    serviceBtn->setStyleSheet(
+        "QPushButton {"
+        "   background-color: lightgray;"
+        "   border: 1px solid #666;"
+        "   border-radius: 5px;"
+        "}"
+        "QPushButton:pressed { background-color: #bdbdbd; }"
+    );
+    connect(serviceBtn, &QPushButton::clicked, this, &Elevator::HandleService);
+    doorLayout->addWidget(serviceBtn);
+    UpdateServiceButton();
+
     rightLayout->addLayout(doorLayout);
 
     QGroupBox* statusGroup = CreateStatusGroup();
@@ -142,317 +134,71 @@ void Elevator::InitWidget()
     this->setLayout(windowLayout);
 }
 
-void Elevator::AddInternalTarget(int floor)
+void Elevator::HandleOpenDoor()
 {
-    if (floor == current_floor) return;
-    if (!internal_targets.insert(floor).second) return;
-    if (floor >= 0 && floor < floorButtons.size()) {
-        floorButtons[floor]->setDisabled(true);
-    }
-    if (state == ElevatorState::Idle) {
-        DecideNextAction();
-    }
+    PostCommand(SimCommand::Type::OpenDoor);
 }
 
-void Elevator::AddExternalRequest(int floor, Direction dir)
+void Elevator::HandleCloseDoor()
 {
-    if (floor == current_floor && state == ElevatorState::Idle) {
-        HandleOpenDoor();
-        return;
-    }
-    if (dir == Direction::Up) {
-        if (!external_up_requests.insert(floor).second) return;
-    }
-    else if (dir == Direction::Down) {
-        if (!external_down_requests.insert(floor).second) return;
-    }
-    if (state == ElevatorState::Idle) {
-        DecideNextAction();
-    }
+    PostCommand(SimCommand::Type::CloseDoor);
 }
 
-bool Elevator::InternalRequestExists(int floor) const
+void Elevator::HandleAlarm()
 {
-    return internal_targets.count(floor) > 0;
+    PostCommand(SimCommand::Type::Alarm);
 }
 
-bool Elevator::ExternalRequestExists(int floor, Direction dir) const
+void Elevator::HandleService()
 {
-    if (dir == Direction::Up)
-        return external_up_requests.count(floor) > 0;
-    else if (dir == Direction::Down)
-        return external_down_requests.count(floor) > 0;
-    return false;
+    // 以快照中的状态为准, 连续点击在快照更新前只会重复同一个命令
+    SimCommand command;
+    command.type = SimCommand::Type::Service;
+    command.car = index;
+    command.target = snapshot.out_of_service ? 0 : 1;
+    simulation->Post(command);
 }
 
-void Elevator::ClearAllTimers()
+void Elevator::UpdateServiceButton()
 {
-	if (m_openTimer) {
-		m_openTimer->stop();
-		delete m_openTimer;
-		m_openTimer = nullptr;
-	}
-	if (m_stayOpenTimer) {
-		m_stayOpenTimer->stop();
-		delete m_stayOpenTimer;
-		m_stayOpenTimer = nullptr;
-	}
-	if (m_closeTimer) {
-		m_closeTimer->stop();
-		delete m_closeTimer;
-		m_closeTimer = nullptr;
-	}
+    serviceBtn->setText(snapshot.out_of_service ? "恢复" : "停用");
 }
 
-void Elevator::DecideNextAction()
+void Elevator::PostCommand(SimCommand::Type type, int floor)
 {
-    // 选择方向
-    if (!internal_targets.empty() || !external_up_requests.empty() || !external_down_requests.empty()) {
-        // 优先上行
-        int up_min = INT_MAX, down_max = INT_MIN;
-        for (int f : internal_targets) {
-            if (f > current_floor) up_min = std::min(up_min, f);
-            if (f < current_floor) down_max = std::max(down_max, f);
-        }
-        // 处理外部上升请求和外部下降请求中高于当前楼层的楼层
-        for (int f : external_up_requests) {
-            if (f >= current_floor) up_min = std::min(up_min, f);
-        }
-        // 处理外部下降请求中的上行目标
-        for (int f : external_down_requests) {  
-            if (f > current_floor) up_min = std::min(up_min, f);
-        }
-        // 处理外部下降请求和外部上升请求中低于当前楼层的楼层
-        for (int f : external_down_requests) {
-            if (f < current_floor) down_max = std::max(down_max, f);
-        }
-        // 处理外部上升请求中的下行目标
-        for (int f : external_up_requests) {    
-            if (f < current_floor) down_max = std::max(down_max, f);
-        }
-        if (up_min != INT_MAX) {
-            direction = Direction::Up;
-            state = ElevatorState::Up;
-        }
-        else if (down_max != INT_MIN) {
-            direction = Direction::Down;
-            state = ElevatorState::Down;
-        }
-        else if (!internal_targets.empty()) {
-            // 只剩本层目标
-            direction = Direction::None;
-            state = ElevatorState::Idle;
-        }
-        else {
-            direction = Direction::None;
-            state = ElevatorState::Idle;
-        }
-		qDebug() << "up_min:" << up_min << "down_max:" << down_max;
-        QTimer::singleShot(600, this, &Elevator::MoveToNextFloor);
-    }
-    else {
-        direction = Direction::None;
-        state = ElevatorState::Idle;
-        UpdateDisplay();
-    }
+    SimCommand command;
+    command.type = type;
+    command.car = index;
+    command.floor = floor;
+    simulation->Post(command);
 }
 
-void Elevator::MoveToNextFloor()
+void Elevator::Bind(int index, const CarSnapshot& car)
 {
-    if (state == ElevatorState::Opening || state == ElevatorState::Open || state == ElevatorState::Closing)
-        return;
-
-    // 1. 查找当前方向上的下一个目标
-    int next = -1;
-    if (direction == Direction::Up) {
-        int min_above = INT_MAX;
-        for (int f : internal_targets)
-            if (f > current_floor) 
-                min_above = std::min(min_above, f);
-        for (int f : external_up_requests)
-            if (f > current_floor) 
-                min_above = std::min(min_above, f);
-        // 如果没有,再从external_down_requests中找
-        if (min_above == INT_MAX) {
-            for (int f : external_down_requests) {
-                min_above = std::min(min_above, f);
-            }
-        }
-
-        if (min_above != INT_MAX) next = min_above;
-    }
-    else if (direction == Direction::Down) {
-        int max_below = INT_MIN;
-        for (int f : internal_targets)
-            if (f < current_floor) 
-                max_below = std::max(max_below, f);
-        for (int f : external_down_requests)
-            if (f < current_floor) 
-                max_below = std::max(max_below, f);
-		// 如果没有,再从external_up_requests中找
-		if (max_below == INT_MIN) {
-			for (int f : external_up_requests) {
-				max_below = std::max(max_below, f);
-			}
-		}
-
-        if (max_below != INT_MIN) next = max_below;
-    }
-
-    // 2. 没有目标则换向或Idle
-    if (next == -1) {
-        // 尝试换向
-        if (direction == Direction::Up) {
-            int max_below = INT_MIN;
-            for (int f : internal_targets)
-                if (f < current_floor) max_below = std::max(max_below, f);
-            for (int f : external_down_requests)
-                if (f < current_floor) max_below = std::max(max_below, f);
-            if (max_below != INT_MIN) {
-                direction = Direction::Down;
-                state = ElevatorState::Down;
-                QTimer::singleShot(600, this, &Elevator::MoveToNextFloor);
-                return;
-            }
-        }
-        else if (direction == Direction::Down) {
-            int min_above = INT_MAX;
-            for (int f : internal_targets)
-                if (f > current_floor) min_above = std::min(min_above, f);
-            for (int f : external_up_requests)
-                if (f > current_floor) min_above = std::min(min_above, f);
-            if (min_above != INT_MAX) {
-                direction = Direction::Up;
-                state = ElevatorState::Up;
-                QTimer::singleShot(600, this, &Elevator::MoveToNextFloor);
-                return;
-            }
-        }
-        // 没有目标，Idle
-        direction = Direction::None;
-        state = ElevatorState::Idle;
-        UpdateDisplay();
-        return;
-    }
-    qDebug() << "next:" << next;
-
-    // 3. 移动一层
-    if (next > current_floor) {
-        current_floor++;
-        state = ElevatorState::Up;
-    }
-    else if (next < current_floor) {
-        current_floor--;
-        state = ElevatorState::Down;
-    }
-
-    // 4. 到达目标楼层，处理开门、请求清除
-    bool stop = false;
-    if (internal_targets.count(current_floor)) {
-        internal_targets.erase(current_floor);
-        stop = true;
-    }
-    if (external_up_requests.count(current_floor)) {
-        external_up_requests.erase(current_floor);
-        stop = true;
-    }
-    if (external_down_requests.count(current_floor)) {
-        external_down_requests.erase(current_floor);
-        stop = true;
-    }
-
-    if (stop) {
-        if (current_floor >= 0 && current_floor < floorButtons.size()) {
-            floorButtons[current_floor]->setDisabled(false);
-        }
-        emit FloorArrived(current_floor, state);
-        state = ElevatorState::Opening;
-        UpdateDisplay();
-        m_openTimer = new QTimer(this);
-        m_openTimer->singleShot(1000, [=]() {
-            state = ElevatorState::Open;
-            UpdateDisplay();
-            m_stayOpenTimer = new QTimer(this);
-            m_stayOpenTimer->singleShot(2000, [=]() {
-                state = ElevatorState::Closing;
-                UpdateDisplay();
-                m_closeTimer = new QTimer(this);
-                m_closeTimer->singleShot(1000, [=]() {
-                    DecideNextAction();
-                    });
-                });
-            });
-    }
-    else {
-        QTimer::singleShot(600, this, &Elevator::MoveToNextFloor);
-    }
-
-    elevator_floor->setText(QString::number(current_floor + 1));
-    elevator_floor->repaint();
+    // 面板回收后换绑到另一部电梯, 控件保留, 显示状态全部重置
+    this->index = index;
+    elevator_id = index + 1;
+    titleLabel->setText(QString("电梯 %1").arg(elevator_id));
+    snapshot = car;
+    shown_floor = -1;
+    state_shown = false;
+    keypad->SetActiveFloors(car.targets);
+    keypad->SetServedFloors(simulation->GetServedFloors(index));
+    UpdateServiceButton();
     UpdateDisplay();
 }
 
-void Elevator::HandleOpenDoor()
-{
-    ClearAllTimers();
-    if (state == ElevatorState::Idle ||
-        state == ElevatorState::Closing ||
-        state == ElevatorState::Open)
-    {
-        state = ElevatorState::Opening;
-        UpdateDisplay();
-        int arrived_floor = current_floor;
-        if (arrived_floor >= 0 && arrived_floor < floorButtons.size()) {
-            QPushButton* btn = floorButtons[arrived_floor];
-            btn->setDisabled(false);
-        }
-        m_openTimer = new QTimer(this);
-        m_openTimer->singleShot(1000, [=]() {
-            state = ElevatorState::Open;
-            UpdateDisplay();
-            m_stayOpenTimer = new QTimer(this);
-            m_stayOpenTimer->singleShot(2000, [=]() {
-                state = ElevatorState::Closing;
-                UpdateDisplay();
-                m_closeTimer = new QTimer(this);
-                m_closeTimer->singleShot(1000, [=]() {
-                    DecideNextAction();
-                });
-            });
-        });
-    }
-}
-
-void Elevator::HandleCloseDoor()
+void Elevator::ApplySnapshot(const CarSnapshot& next)
 {
-    ClearAllTimers();
-    if (state == ElevatorState::Open || state == ElevatorState::Opening)
-    {
-        state = ElevatorState::Closing;
+    bool floor_changed = next.floor != snapshot.floor;
+    bool state_changed = next.state != snapshot.state;
+    bool service_changed = next.out_of_service != snapshot.out_of_service;
+    keypad->SetActiveFloors(next.targets);
+    snapshot = next;
+    if (service_changed)
+        UpdateServiceButton();
+    if (floor_changed || state_changed)
         UpdateDisplay();
-        m_closeTimer = new QTimer(this);
-        m_closeTimer->singleShot(1000, [=]() {
-            DecideNextAction();
-        });
-    }
-}
-
-void Elevator::HandleAlarm() {
-    ClearAllTimers();
-    if (!is_alarm_active) {
-        is_alarm_active = true;
-		state = ElevatorState::Warning;
-        UpdateDisplay();
-        emit AlarmTriggered(elevator_id); // 触发报警信号
-
-        // 3秒后复位报警状态
-        QTimer::singleShot(3000, [=]() {
-            is_alarm_active = false;
-			state = ElevatorState::Idle;
-            UpdateDisplay();
-            DecideNextAction();
-        });
-    }
 }
 
 QPushButton* Elevator::CreateDoorButton(const QString& text, const QString& color)
@@ -486,9 +232,9 @@ QGroupBox* Elevator::CreateStatusGroup()
         QLabel* label = new QLabel(pair.first + pair.second, group);
         label->setStyleSheet("font-size: 20px; color: #444; text-decoration: underline;");
         layout->addWidget(label);
-        if (pair.first == "状态:") label->setObjectName("stateLabel");
-        else if (pair.first == "当前楼层:") label->setObjectName("floorLabel");
-        else if (pair.first == "门状态:") label->setObjectName("doorLabel");
+        if (pair.first == "状态:") stateLabel = label;
+        else if (pair.first == "当前楼层:") floorLabel = label;
+        else if (pair.first == "门状态:") doorLabel = label;
     }
 
     group->setStyleSheet(
@@ -502,65 +248,66 @@ QGroupBox* Elevator::CreateStatusGroup()
     return group;
 }
 
-void Elevator::UpdateDisplay()
-{
-    QSlider* floorSlider = findChild<QSlider*>();
-    if (floorSlider) {
-        floorSlider->setValue(current_floor + 1);
-    }
-    QLabel* floorValueLabel = findChild<QLabel*>("floorValueLabel");
-    if (floorValueLabel) {
-        floorValueLabel->setText(QString::number(current_floor + 1));
-    }
-    // 状态栏
-    QString state_color = "#444";
-    state_color = state == ElevatorState::Idle ? "#444" : "red";
-    QLabel* stateLabel = findChild<QLabel*>("stateLabel");
-    if (stateLabel) {
-        QString state_str;
+namespace {
+    const QString& StateText(ElevatorState state)
+    {
+        static const QString texts[] = {
+            "状态:          空闲", "状态:          上行", "状态:          下行",
+            "状态:          开门中", "状态:          已开门", "状态:          关门中",
+            "状态:          报警中"
+        };
         switch (state) {
-        case ElevatorState::Idle: state_str = "空闲"; break;
-        case ElevatorState::Up: state_str = "上行"; break;
-        case ElevatorState::Down: state_str = "下行"; break;
-        case ElevatorState::Opening: state_str = "开门中"; break;
-        case ElevatorState::Open: state_str = "已开门"; break;
-        case ElevatorState::Closing: state_str = "关门中"; break;
-		case ElevatorState::Warning: state_str = "报警中"; break;
+        case ElevatorState::Up: return texts[1];
+        case ElevatorState::Down: return texts[2];
+        case ElevatorState::Opening: return texts[3];
+        case ElevatorState::Open: return texts[4];
+        case ElevatorState::Closing: return texts[5];
+        case ElevatorState::Warning: return texts[6];
+        default: return texts[0];
         }
-        stateLabel->setText(QString("状态:          %1").arg(state_str));
-        stateLabel->setStyleSheet(QString("color: %1; font-size: 20px;").arg(state_color));
     }
-    switch (state) {
-    case ElevatorState::Up:
-    case ElevatorState::Down:
-        state_color = "red";
-        break;
-    default:
-        state_color = "#444";
-        break;
-    }
-    QLabel* floorLabel = findChild<QLabel*>("floorLabel");
-    if (floorLabel) {
-        floorLabel->setText(QString("当前楼层:   %1 楼").arg(current_floor + 1));
-        floorLabel->setStyleSheet(QString("color: %1; font-size: 20px;").arg(state_color));
+
+    const QString& DoorText(ElevatorState state)
+    {
+        static const QString texts[] = {
+            "门状态:       关闭", "门状态:       打开", "门状态:       开门中", "门状态:       关门中"
+        };
+        switch (state) {
+        case ElevatorState::Open: return texts[1];
+        case ElevatorState::Opening: return texts[2];
+        case ElevatorState::Closing: return texts[3];
+        default: return texts[0];
+        }
     }
-    switch (state) {
-    case ElevatorState::Open:
-    case ElevatorState::Opening:
-    case ElevatorState::Closing:
-        state_color = "red";
-        break;
-    default:
-        state_color = "#444";
-        break;
+
+    // 状态栏标签只有两种样式, 仅在切换时重新设置样式表
+    void SetHighlight(QLabel* label, bool highlight, int& shown)
+    {
+        static const QString normal_style = "color: #444; font-size: 20px;";
+        static const QString highlight_style = "color: red; font-size: 20px;";
+        if (shown == int(highlight)) return;
+        shown = int(highlight);
+        label->setStyleSheet(highlight ? highlight_style : normal_style);
     }
-    QLabel* doorLabel = findChild<QLabel*>("doorLabel");
-    if (doorLabel) {
-        QString doorState = "关闭";
-        if (state == ElevatorState::Open) doorState = "打开";
-        else if (state == ElevatorState::Opening) doorState = "开门中";
-        else if (state == ElevatorState::Closing) doorState = "关门中";
-        doorLabel->setText(QString("门状态:       %1").arg(doorState));
-        doorLabel->setStyleSheet(QString("color: %1; font-size: 20px;").arg(state_color));
+}
+
+// 只更新与上次显示不同的控件; 由界面线程每帧至多调用一次, setText等只标记重绘, 不同步绘制
+void Elevator::UpdateDisplay()
+{
+    const int current_floor = snapshot.floor;
+    const ElevatorState state = snapshot.state;
+    if (current_floor != shown_floor) {
+        shown_floor = current_floor;
+        floorSlider->setValue(current_floor + 1);
+        floorValueLabel->setText(floor_numbers[current_floor]);
+        floorLabel->setText(floor_texts[current_floor]);
     }
+    if (state_shown && state == shown_state) return;
+    state_shown = true;
+    shown_state = state;
+    stateLabel->setText(StateText(state));
+    doorLabel->setText(DoorText(state));
+    SetHighlight(stateLabel, state != ElevatorState::Idle, state_style);
+    SetHighlight(floorLabel, state == ElevatorState::Up || state == ElevatorState::Down, floor_style);
+    SetHighlight(doorLabel, state == ElevatorState::Open || state == ElevatorState::Opening || state == ElevatorState::Closing, door_style);
 }
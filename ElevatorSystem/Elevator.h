@@ -17,61 +17,64 @@
 #include <qtimer.h>
 #include <vector>
 #include <Utilities.h>
+#include "FloorKeypad.h"
+#include "SimulationThread.h"
 
 
+// 单部电梯的显示面板, 运行逻辑在模拟线程上
+// 按钮操作以命令形式投递给模拟线程, 显示内容来自模拟线程发布的快照
 class Elevator : public QWidget
 {
     Q_OBJECT
 
 public:
-    Elevator(int elevator_id, int floor_cnt, QLabel* elevator_floor, QWidget* parent = nullptr);
-    ~Elevator() {}
+    Elevator(SimulationThread* simulation, int index, QWidget* parent = nullptr);
+    ~Elevator();
 public:
     void Init();
-    void AddInternalTarget(int floor); // 电梯内目标
-    void AddExternalRequest(int floor, Direction dir); // 电梯外请求
-    ElevatorState GetState() const { return state; }
-    int GetCurrentFloor() const { return current_floor; }
+    ElevatorState GetState() const { return snapshot.state; }
+    int GetCurrentFloor() const { return snapshot.floor; }
     int GetElevatorID() const { return elevator_id; }
+    int GetIndex() const { return index; }
+    void Bind(int index, const CarSnapshot& car); // 改为显示另一部电梯
+    void ApplySnapshot(const CarSnapshot& next); // 界面线程每帧调用, 只刷新变化的部分
     void UpdateDisplay();
-    void MoveToNextFloor();
-    void DecideNextAction();
 private:
-    void InitParams();
     void InitWidget();
     QPushButton* CreateDoorButton(const QString& text, const QString& color);
     QGroupBox* CreateStatusGroup();
-    bool InternalRequestExists(int floor) const;
-    bool ExternalRequestExists(int floor, Direction dir) const;
-	void ClearAllTimers();
 public slots:
     void HandleOpenDoor();
     void HandleCloseDoor();
 	void HandleAlarm();
+    void HandleService();
+private:
+    void PostCommand(SimCommand::Type type, int floor = 0);
+    void UpdateServiceButton();
 
 private:
     Ui::ElevatorClass ui;
+    SimulationThread* simulation;
+    int index; // 电梯下标(从0开始)
     int elevator_id;
     int floor_cnt;
-    int current_floor;
-    ElevatorState state;
-    Direction direction;
-    QLabel* elevator_floor;
-    bool is_door_open;
-    bool is_alarm_active;
-    std::vector<QPushButton*> floorButtons;
-
-    // 请求管理
-    std::set<int> internal_targets;         // 电梯内目标楼层
-    std::set<int> external_up_requests;     // 外部上行请求
-    std::set<int> external_down_requests;   // 外部下行请求
-
-    // 定时器管理
-    QTimer* m_openTimer = nullptr;
-    QTimer* m_stayOpenTimer = nullptr;
-    QTimer* m_closeTimer = nullptr;
+    FloorKeypad* keypad = nullptr; // 电梯内楼层按键
+    CarSnapshot snapshot; // 最近一次显示的状态
 
-signals:
-    void FloorArrived(int floor, ElevatorState direction);
-    void AlarmTriggered(int elevator_id);
+    // 创建时缓存的控件和文本, 刷新时不查找控件、不拼接字符串
+    QLabel* titleLabel = nullptr;
+    QSlider* floorSlider = nullptr;
+    QLabel* floorValueLabel = nullptr;
+    QLabel* stateLabel = nullptr;
+    QLabel* floorLabel = nullptr;
+    QLabel* doorLabel = nullptr;
+    QPushButton* serviceBtn = nullptr;
+    std::vector<QString> floor_numbers; // "1".."n"
+    std::vector<QString> floor_texts;   // 状态栏的楼层文本
+    int shown_floor = -1;
+    bool state_shown = false;
+    ElevatorState shown_state = ElevatorState::Idle;
+    int state_style = -1; // 已设置的样式: -1未设置, 0普通, 1高亮
+    int floor_style = -1;
+    int door_style = -1;
 };
\ No newline at end of file
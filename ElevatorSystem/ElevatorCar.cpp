@@ -0,0 +1,573 @@
+﻿#include "ElevatorCar.h"
+#include "Checkpoint.h"
+#include "Kinematics.h"
+#include <algorithm>
+
+namespace {
+    // -1表示没有楼层
+    int LowerFloor(int a, int b)
+    {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        return std::min(a, b);
+    }
+
+    int HigherFloor(int a, int b)
+    {
+        return std::max(a, b);
+    }
+}
+
+ElevatorCar::ElevatorCar(int elevator_id, int floor_cnt, TimerService& timers, const CarTiming& timing,
+    std::shared_ptr<const MotionTable> motion)
+    : elevator_id(elevator_id), floor_cnt(floor_cnt),
+    current_floor(0), state(ElevatorState::Idle), direction(Direction::None),
+    is_alarm_active(false), timers(timers), timing(timing),
+    motion(motion && motion->GetFloorCount() == floor_cnt ? motion : std::make_shared<const MotionTable>(timing, floor_cnt)),
+    internal_targets(floor_cnt), external_up_requests(floor_cnt),
+    external_down_requests(floor_cnt), stop_mask(floor_cnt), served_floors(floor_cnt)
+{
+    for (int floor = 0; floor < floor_cnt; ++floor)
+        served_floors.Set(floor);
+}
+
+ElevatorCar::~ElevatorCar()
+{
+    ClearAllTimers();
+}
+
+void ElevatorCar::Reset()
+{
+    ClearAllTimers();
+    current_floor = 0;
+    state = ElevatorState::Idle;
+    direction = Direction::None;
+    is_alarm_active = false;
+    hold_ms = 0;
+    load = 0;
+    run_origin = 0;
+    internal_targets.Clear();
+    external_up_requests.Clear();
+    external_down_requests.Clear();
+    stop_mask.Clear();
+    route = RouteSummary();
+    NotifyFloorChanged();
+    NotifyStateChanged();
+}
+
+void ElevatorCar::SetServedFloors(const FloorMask& floors)
+{
+    if (floors.Size() == floor_cnt)
+        served_floors = floors;
+}
+
+bool ElevatorCar::AddInternalTarget(int floor)
+{
+    if (!Serves(floor)) return false;
+    if (floor == current_floor) return false;
+    if (!internal_targets.Set(floor)) return false;
+    AddStop(floor);
+    NotifyTargetChanged(floor, true);
+    if (state == ElevatorState::Idle) {
+        DecideNextAction();
+    }
+    return true;
+}
+
+void ElevatorCar::AddExternalRequest(int floor, Direction dir)
+{
+    if (!Serves(floor)) return;
+    if (floor == current_floor && state == ElevatorState::Idle) {
+        OpenDoor();
+        return;
+    }
+    if (dir == Direction::Up) {
+        if (!external_up_requests.Set(floor)) return;
+    }
+    else if (dir == Direction::Down) {
+        if (!external_down_requests.Set(floor)) return;
+    }
+    else {
+        return;
+    }
+    AddStop(floor);
+    if (state == ElevatorState::Idle) {
+        DecideNextAction();
+    }
+}
+
+bool ElevatorCar::RemoveExternalRequest(int floor, Direction dir)
+{
+    if (floor < 0 || floor >= floor_cnt) return false;
+    if (dir == Direction::Up) {
+        if (!external_up_requests.Reset(floor)) return false;
+    }
+    else if (dir == Direction::Down) {
+        if (!external_down_requests.Reset(floor)) return false;
+    }
+    else {
+        return false;
+    }
+    // 没有剩余目标的电梯在下一层停下转为空闲, 不会空驶到原楼层
+    if (!internal_targets.Test(floor) && !external_up_requests.Test(floor) && !external_down_requests.Test(floor))
+        RemoveStop(floor);
+    return true;
+}
+
+bool ElevatorCar::InternalRequestExists(int floor) const
+{
+    return floor >= 0 && floor < floor_cnt && internal_targets.Test(floor);
+}
+
+bool ElevatorCar::ExternalRequestExists(int floor, Direction dir) const
+{
+    if (floor < 0 || floor >= floor_cnt)
+        return false;
+    if (dir == Direction::Up)
+        return external_up_requests.Test(floor);
+    else if (dir == Direction::Down)
+        return external_down_requests.Test(floor);
+    return false;
+}
+
+void ElevatorCar::AddStop(int floor)
+{
+    if (!stop_mask.Set(floor)) return;
+    route.stop_count++;
+    if (floor > current_floor) route.stops_above++;
+    else if (floor < current_floor) route.stops_below++;
+    if (floor > route.upper) route.upper = floor;
+    if (route.lower < 0 || floor < route.lower) route.lower = floor;
+    NotifyPlanChanged();
+}
+
+bool ElevatorCar::RemoveStop(int floor)
+{
+    if (!stop_mask.Reset(floor))
+        return false;
+    route.stop_count--;
+    if (floor > current_floor) route.stops_above--;
+    else if (floor < current_floor) route.stops_below--;
+    if (floor == route.upper) route.upper = stop_mask.NextBelow(floor);
+    if (floor == route.lower) route.lower = stop_mask.NextAbove(floor);
+    NotifyPlanChanged();
+    return true;
+}
+
+void ElevatorCar::MoveTo(int floor)
+{
+    // 离开的楼层和到达的楼层分别计入/移出上下方停靠数
+    if (stop_mask.Test(current_floor)) {
+        if (floor > current_floor) route.stops_below++;
+        else route.stops_above++;
+    }
+    if (stop_mask.Test(floor)) {
+        if (floor > current_floor) route.stops_above--;
+        else route.stops_below--;
+    }
+    current_floor = floor;
+}
+
+int ElevatorCar::GetBusyTime() const
+{
+    TimerService::Time due = 0;
+    int tail = 0;
+    GetBusySchedule(due, tail);
+    return static_cast<int>(std::max<TimerService::Time>(0, due - timers.Now())) + tail;
+}
+
+void ElevatorCar::GetBusySchedule(TimerService::Time& due, int& tail) const
+{
+    due = 0;
+    tail = 0;
+    switch (state) {
+    case ElevatorState::Opening: tail = timing.stay_open_ms + hold_ms + timing.close_ms; break;
+    case ElevatorState::Open: tail = timing.close_ms; break;
+    case ElevatorState::Closing:
+    case ElevatorState::Warning: break;
+    default: return;
+    }
+    if (pending_timer != TimerService::InvalidTimer)
+        due = pending_due;
+}
+
+void ElevatorCar::Schedule(int delay_ms)
+{
+    ClearAllTimers();
+    pending_due = timers.Now() + delay_ms;
+    pending_timer = timers.Schedule(delay_ms, [this]() {
+        pending_timer = TimerService::InvalidTimer;
+        OnTimer();
+    });
+    NotifyPlanChanged();
+}
+
+void ElevatorCar::OnTimer()
+{
+    // 待执行的动作只由当前状态决定, 检查点只需保存状态和到期时间
+    switch (state) {
+    case ElevatorState::Opening:
+        SetState(ElevatorState::Open);
+        Schedule(timing.stay_open_ms + hold_ms);
+        hold_ms = 0;
+        break;
+    case ElevatorState::Open:
+        SetState(ElevatorState::Closing);
+        Schedule(timing.close_ms);
+        break;
+    case ElevatorState::Closing:
+        DecideNextAction();
+        break;
+    case ElevatorState::Warning:
+        // 报警结束后复位
+        is_alarm_active = false;
+        SetState(ElevatorState::Idle);
+        DecideNextAction();
+        break;
+    default:
+        MoveToNextFloor();
+        break;
+    }
+}
+
+void ElevatorCar::ClearAllTimers()
+{
+    if (pending_timer != TimerService::InvalidTimer) {
+        timers.Cancel(pending_timer);
+        pending_timer = TimerService::InvalidTimer;
+        NotifyPlanChanged();
+    }
+}
+
+void ElevatorCar::DecideNextAction()
+{
+    // 选择方向
+    if (HasPendingRequests()) {
+        // 本层的请求(例如关门过程中加入的)直接开门服务, 否则会一直滞留; 满载时外呼留给其他电梯
+        const bool passes = PassesFull(current_floor);
+        if (!passes && ClearRequestsAtFloor(current_floor)) {
+            StopAtCurrentFloor();
+            return;
+        }
+        // 前方还有停靠层时保持原方向(LOOK), 否则换向; 空闲时优先上行; 满载时只看内选
+        const FloorMask& targets = IsFull() ? internal_targets : stop_mask;
+        int up_min = targets.NextAbove(current_floor);
+        int down_max = targets.NextBelow(current_floor);
+        bool keep_down = direction == Direction::Down && down_max >= 0;
+        if (up_min >= 0 && !keep_down) {
+            direction = Direction::Up;
+            state = ElevatorState::Up;
+        }
+        else if (down_max >= 0) {
+            direction = Direction::Down;
+            state = ElevatorState::Down;
+        }
+        else {
+            // 只剩本层目标
+            direction = Direction::None;
+            state = ElevatorState::Idle;
+        }
+        run_origin = current_floor;
+        NotifyStateChanged();
+        Schedule(StepTime());
+        if (passes) NotifyBypassed(current_floor);
+    }
+    else {
+        direction = Direction::None;
+        SetState(ElevatorState::Idle);
+    }
+}
+
+void ElevatorCar::MoveToNextFloor()
+{
+    if (state == ElevatorState::Opening || state == ElevatorState::Open ||
+        state == ElevatorState::Closing || state == ElevatorState::Warning)
+        return;
+
+    // 1. 查找当前方向上的下一个目标; 满载时只去内选楼层, 途经的外呼在第4步改派
+    int next = -1;
+    const FloorMask& targets = IsFull() ? internal_targets : stop_mask;
+    if (IsFull()) {
+        if (direction == Direction::Up)
+            next = internal_targets.NextAbove(current_floor);
+        else if (direction == Direction::Down)
+            next = internal_targets.NextBelow(current_floor);
+    }
+    else if (direction == Direction::Up) {
+        next = LowerFloor(internal_targets.NextAbove(current_floor), external_up_requests.NextAbove(current_floor));
+        // 如果没有,再从external_down_requests中找
+        if (next < 0)
+            next = external_down_requests.First();
+    }
+    else if (direction == Direction::Down) {
+        next = HigherFloor(internal_targets.NextBelow(current_floor), external_down_requests.NextBelow(current_floor));
+        // 如果没有,再从external_up_requests中找
+        if (next < 0)
+            next = external_up_requests.Last();
+    }
+
+    // 2. 没有目标则换向或Idle; 经过本层时才登记的请求就地开门
+    if (next == -1) {
+        if (!PassesFull(current_floor) && ClearRequestsAtFloor(current_floor)) {
+            StopAtCurrentFloor();
+            return;
+        }
+        // 尝试换向; 身后的任何停靠都要折返, 包括改派过来的同向外呼
+        if (direction == Direction::Up) {
+            int max_below = targets.NextBelow(current_floor);
+            if (max_below >= 0) {
+                direction = Direction::Down;
+                run_origin = current_floor;
+                SetState(ElevatorState::Down);
+                Schedule(StepTime());
+                return;
+            }
+        }
+        else if (direction == Direction::Down) {
+            int min_above = targets.NextAbove(current_floor);
+            if (min_above >= 0) {
+                direction = Direction::Up;
+                run_origin = current_floor;
+                SetState(ElevatorState::Up);
+                Schedule(StepTime());
+                return;
+            }
+        }
+        // 没有目标，Idle
+        direction = Direction::None;
+        SetState(ElevatorState::Idle);
+        return;
+    }
+
+    // 3. 移动一层; 没有停稳就反向(前方的目标被撤销)时按重新起步计时
+    if ((next - current_floor) * (current_floor - run_origin) < 0)
+        run_origin = current_floor;
+    if (next > current_floor) {
+        MoveTo(current_floor + 1);
+        state = ElevatorState::Up;
+    }
+    else if (next < current_floor) {
+        MoveTo(current_floor - 1);
+        state = ElevatorState::Down;
+    }
+    NotifyFloorChanged();
+
+    // 4. 到达目标楼层，处理开门、请求清除; 满载时不为外呼停靠, 由观察者(群控)改派
+    if (PassesFull(current_floor)) {
+        NotifyStateChanged();
+        Schedule(StepTime());
+        NotifyBypassed(current_floor);
+    }
+    else if (ClearRequestsAtFloor(current_floor)) {
+        StopAtCurrentFloor();
+    }
+    else {
+        NotifyStateChanged();
+        Schedule(StepTime());
+    }
+}
+
+int ElevatorCar::StepTime() const
+{
+    // 运行时间都从本次起步的楼层查表: 下一层要停靠(或前方已没有目标)时按停稳计时, 否则按不减速经过计时
+    // 匀速模型中两者都是move_ms; 空闲时的重新决策也按move_ms
+    const int step = state == ElevatorState::Up ? 1 : state == ElevatorState::Down ? -1 : 0;
+    const int next = current_floor + step;
+    if (step == 0 || next < 0 || next >= floor_cnt) return timing.move_ms;
+    const FloorMask& targets = IsFull() ? internal_targets : stop_mask;
+    const bool beyond = step > 0 ? targets.NextAbove(next) >= 0 : targets.NextBelow(next) >= 0;
+    const bool stopping = targets.Test(next) || !beyond;
+    const int from = (next - run_origin) * step > 0 ? run_origin : current_floor;
+    const int reach = stopping ? motion->RunTime(from, next) : motion->PassTime(from, next);
+    const int passed = motion->PassTime(from, current_floor);
+    return std::max(0, reach - passed);
+}
+
+bool ElevatorCar::ClearRequestsAtFloor(int floor)
+{
+    if (!RemoveStop(floor))
+        return false;
+    if (internal_targets.Reset(floor)) {
+        NotifyTargetChanged(floor, false);
+    }
+    external_up_requests.Reset(floor);
+    external_down_requests.Reset(floor);
+    return true;
+}
+
+void ElevatorCar::StopAtCurrentFloor()
+{
+    // 先进入开门状态再通知到达, 观察者在回调中添加的目标不会打断开门
+    ElevatorState arrived_state = state;
+    StartDoorCycle();
+    NotifyArrived(current_floor, arrived_state);
+}
+
+void ElevatorCar::StartDoorCycle()
+{
+    // 开门 -> 保持 -> 关门 -> 重新决策方向, 后续阶段由OnTimer推进
+    SetState(ElevatorState::Opening);
+    Schedule(timing.open_ms);
+}
+
+void ElevatorCar::OpenDoor()
+{
+    if (state == ElevatorState::Idle ||
+        state == ElevatorState::Closing ||
+        state == ElevatorState::Open)
+    {
+        ClearAllTimers();
+        StopAtCurrentFloor();
+    }
+}
+
+void ElevatorCar::CloseDoor()
+{
+    if (state == ElevatorState::Open || state == ElevatorState::Opening)
+    {
+        SetState(ElevatorState::Closing);
+        Schedule(timing.close_ms);
+    }
+}
+
+void ElevatorCar::TriggerAlarm()
+{
+    if (is_alarm_active) return;
+    ClearAllTimers();
+    is_alarm_active = true;
+    SetState(ElevatorState::Warning);
+    NotifyAlarm();
+
+    Schedule(timing.alarm_ms);
+}
+
+void ElevatorCar::HoldDoor(int ms)
+{
+    if (ms <= 0) return;
+    if (state == ElevatorState::Opening) {
+        hold_ms += ms;
+        NotifyPlanChanged();
+    }
+    else if (state == ElevatorState::Open && pending_timer != TimerService::InvalidTimer) {
+        Schedule(static_cast<int>(pending_due - timers.Now()) + ms);
+    }
+}
+
+void ElevatorCar::SaveState(CheckpointWriter& writer) const
+{
+    writer.Put(CheckpointTag("CAR "));
+    writer.Put<std::int32_t>(current_floor);
+    writer.Put(state);
+    writer.Put(direction);
+    writer.Put(is_alarm_active);
+    writer.PutMask(internal_targets);
+    writer.PutMask(external_up_requests);
+    writer.PutMask(external_down_requests);
+    writer.Put(pending_timer);
+    writer.Put(pending_due);
+    writer.Put<std::int32_t>(hold_ms);
+    writer.Put<std::int32_t>(run_origin);
+}
+
+bool ElevatorCar::LoadState(CheckpointReader& reader, std::vector<PendingTimer>& pending)
+{
+    if (!reader.Expect(CheckpointTag("CAR "))) return false;
+    int floor = reader.Get<std::int32_t>();
+    ElevatorState loaded_state = reader.Get<ElevatorState>();
+    Direction loaded_direction = reader.Get<Direction>();
+    bool alarm = reader.Get<bool>();
+    FloorMask internal(floor_cnt), up(floor_cnt), down(floor_cnt);
+    reader.GetMask(internal);
+    reader.GetMask(up);
+    reader.GetMask(down);
+    TimerService::TimerId timer = reader.Get<TimerService::TimerId>();
+    TimerService::Time due = reader.Get<TimerService::Time>();
+    int hold = reader.Get<std::int32_t>();
+    int origin = reader.Get<std::int32_t>();
+    if (!reader.Ok() || floor < 0 || floor >= floor_cnt || origin < 0 || origin >= floor_cnt) return reader.Fail();
+
+    ClearAllTimers();
+    current_floor = floor;
+    state = loaded_state;
+    direction = loaded_direction;
+    is_alarm_active = alarm;
+    hold_ms = hold;
+    run_origin = origin;
+    internal_targets = internal;
+    external_up_requests = up;
+    external_down_requests = down;
+    // 停靠位图和路线摘要由三类请求重新算出
+    stop_mask.Clear();
+    route = RouteSummary();
+    for (int f = 0; f < floor_cnt; ++f)
+        if (internal.Test(f) || up.Test(f) || down.Test(f)) AddStop(f);
+
+    pending_due = due;
+    if (timer != TimerService::InvalidTimer) {
+        pending.push_back(PendingTimer{ timer, [this]() {
+            Schedule(static_cast<int>(pending_due - timers.Now()));
+        } });
+    }
+    NotifyFloorChanged();
+    NotifyStateChanged();
+    return true;
+}
+
+void ElevatorCar::AddObserver(CarObserver* observer)
+{
+    if (std::find(observers.begin(), observers.end(), observer) == observers.end())
+        observers.push_back(observer);
+}
+
+void ElevatorCar::RemoveObserver(CarObserver* observer)
+{
+    observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+}
+
+void ElevatorCar::SetState(ElevatorState new_state)
+{
+    state = new_state;
+    NotifyStateChanged();
+}
+
+void ElevatorCar::NotifyStateChanged()
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCarStateChanged(*this);
+}
+
+void ElevatorCar::NotifyFloorChanged()
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCarFloorChanged(*this);
+}
+
+void ElevatorCar::NotifyArrived(int floor, ElevatorState arrived_state)
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCarArrived(*this, floor, arrived_state);
+}
+
+void ElevatorCar::NotifyTargetChanged(int floor, bool active)
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCarTargetChanged(*this, floor, active);
+}
+
+void ElevatorCar::NotifyAlarm()
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCarAlarm(*this);
+}
+
+void ElevatorCar::NotifyBypassed(int floor)
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCarBypassed(*this, floor);
+}
+
+void ElevatorCar::NotifyPlanChanged()
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCarPlanChanged(*this);
+}
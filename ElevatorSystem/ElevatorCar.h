@@ -0,0 +1,157 @@
+﻿#pragma once
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include "FloorMask.h"
+#include "Utilities.h"
+#include "TimerService.h"
+
+class ElevatorCar;
+class MotionTable;
+class CheckpointWriter;
+class CheckpointReader;
+struct PendingTimer;
+
+// 电梯事件观察者: 界面、调度器等通过它接收电梯的状态变化
+class CarObserver
+{
+public:
+    virtual ~CarObserver() {}
+    virtual void OnCarStateChanged(const ElevatorCar& car) {}                        // 状态/方向变化
+    virtual void OnCarFloorChanged(const ElevatorCar& car) {}                        // 经过或到达新楼层
+    virtual void OnCarArrived(const ElevatorCar& car, int floor, ElevatorState state) {} // 在某层停靠
+    virtual void OnCarTargetChanged(const ElevatorCar& car, int floor, bool active) {}   // 内部目标增删
+    virtual void OnCarAlarm(const ElevatorCar& car) {}                               // 触发报警
+    virtual void OnCarBypassed(const ElevatorCar& car, int floor) {}                 // 满载经过有外呼的楼层不停
+    virtual void OnCarPlanChanged(const ElevatorCar& car) {}                         // 停靠计划或待执行动作变化
+};
+
+// 电梯运行参数(时间单位: 毫秒)
+struct CarTiming {
+    int move_ms = 600;        // 移动一层(匀速模型)
+    int open_ms = 1000;       // 开门
+    int stay_open_ms = 2000;  // 保持开门
+    int close_ms = 1000;      // 关门
+    int alarm_ms = 3000;      // 报警持续时间
+    int capacity = 13;        // 额定载客人数, 0为不限
+    int transfer_ms = 1000;   // 每位乘客上下梯的时间, 计入开门停留
+    // 运动学模型(MotionTable), rated_speed为0时按move_ms匀速逐层运行
+    double rated_speed = 0.0;   // 额定速度(m/s)
+    double acceleration = 1.0;  // 最大加速度(m/s²)
+    double jerk = 1.5;          // 加加速度(m/s³), 决定起步和制动的平顺程度
+    double floor_height = 3.5;  // 层高(m)
+    double lobby_height = 0.0;  // 大堂(1层到2层)的层高(m), 0为与其他楼层相同
+};
+
+// 路线摘要: 随停靠层的增删和电梯移动增量维护, 供调度器估算到达时间
+struct RouteSummary {
+    int stop_count = 0;  // 待停靠楼层数
+    int stops_above = 0; // 当前楼层上方的停靠数
+    int stops_below = 0; // 当前楼层下方的停靠数
+    int upper = -1;      // 最高停靠层, -1表示没有
+    int lower = -1;      // 最低停靠层
+};
+
+// 单部电梯的运行逻辑(LOOK算法), 不依赖任何界面
+class ElevatorCar
+{
+public:
+    // motion为空时按timing建运行时间表; 同型号的电梯传入同一张表
+    ElevatorCar(int elevator_id, int floor_cnt, TimerService& timers, const CarTiming& timing = CarTiming(),
+        std::shared_ptr<const MotionTable> motion = nullptr);
+    ~ElevatorCar();
+    ElevatorCar(const ElevatorCar&) = delete;
+    ElevatorCar& operator=(const ElevatorCar&) = delete;
+public:
+    void Reset();
+    void SetServedFloors(const FloorMask& floors); // 分区: 只在这些楼层停靠, 其余楼层直驶通过
+    bool AddInternalTarget(int floor); // 电梯内目标, 返回是否新增
+    void AddExternalRequest(int floor, Direction dir); // 电梯外请求
+    bool RemoveExternalRequest(int floor, Direction dir); // 外呼改派给其他电梯, 本层还有其他请求时仍然停靠
+    void OpenDoor();
+    void CloseDoor();
+    void TriggerAlarm();
+    void HoldDoor(int ms); // 乘客上下梯: 开门中或已开门时延长保持开门的时间
+    void SetLoad(int passengers) { load = passengers; } // 车内人数由电梯组维护
+    void DecideNextAction();
+    void MoveToNextFloor();
+
+    ElevatorState GetState() const { return state; }
+    Direction GetDirection() const { return direction; }
+    int GetCurrentFloor() const { return current_floor; }
+    int GetElevatorID() const { return elevator_id; }
+    int GetFloorCount() const { return floor_cnt; }
+    bool IsAlarmActive() const { return is_alarm_active; }
+    int GetLoad() const { return load; }
+    bool IsFull() const { return timing.capacity > 0 && load >= timing.capacity; }
+    bool Serves(int floor) const { return floor >= 0 && floor < floor_cnt && served_floors.Test(floor); }
+    const FloorMask& GetServedFloors() const { return served_floors; }
+    const CarTiming& GetTiming() const { return timing; }
+    const MotionTable& GetMotion() const { return *motion; }
+    const std::shared_ptr<const MotionTable>& GetMotionTable() const { return motion; }
+    bool InternalRequestExists(int floor) const;
+    bool ExternalRequestExists(int floor, Direction dir) const;
+    bool HasPendingRequests() const { return stop_mask.Any(); }
+    const FloorMask& GetStopMask() const { return stop_mask; }
+    const FloorMask& GetInternalTargets() const { return internal_targets; }
+    const FloorMask& GetExternalRequests(Direction dir) const { return dir == Direction::Down ? external_down_requests : external_up_requests; }
+    const RouteSummary& GetRouteSummary() const { return route; }
+    int GetBusyTime() const; // 完成当前开关门/报警还需的时间(毫秒), 之后才能移动
+    // GetBusyTime = max(0, due - 当前时间) + tail; due在当前阶段结束时刻, tail为之后各阶段的时间, 不在开关门/报警时两者为0
+    void GetBusySchedule(TimerService::Time& due, int& tail) const;
+
+    void SaveState(CheckpointWriter& writer) const;
+    bool LoadState(CheckpointReader& reader, std::vector<PendingTimer>& pending); // 待执行的动作放入pending, 由调用方统一调度
+
+    void AddObserver(CarObserver* observer);
+    void RemoveObserver(CarObserver* observer);
+private:
+    void Schedule(int delay_ms); // 到期时调用OnTimer
+    void OnTimer();
+    void ClearAllTimers();
+    void AddStop(int floor);
+    bool RemoveStop(int floor); // 返回原来是否需要停靠
+    void MoveTo(int floor);
+    int StepTime() const; // 按当前运行方向再走一层所需的时间
+    bool ClearRequestsAtFloor(int floor); // 清除本层所有请求, 返回是否需要停靠
+    bool PassesFull(int floor) const { return IsFull() && stop_mask.Test(floor) && !internal_targets.Test(floor); } // 满载时只为内选停靠
+    void StopAtCurrentFloor();
+    void StartDoorCycle();
+    void SetState(ElevatorState new_state);
+    void NotifyStateChanged();
+    void NotifyFloorChanged();
+    void NotifyArrived(int floor, ElevatorState arrived_state);
+    void NotifyTargetChanged(int floor, bool active);
+    void NotifyAlarm();
+    void NotifyBypassed(int floor);
+    void NotifyPlanChanged();
+
+private:
+    int elevator_id;
+    int floor_cnt;
+    int current_floor;
+    ElevatorState state;
+    Direction direction;
+    bool is_alarm_active;
+    int load = 0;    // 车内人数
+    int hold_ms = 0; // 开门完成后额外保持开门的时间(乘客上下梯)
+    TimerService& timers;
+    CarTiming timing;
+    std::shared_ptr<const MotionTable> motion;
+    int run_origin = 0; // 本次运行从静止出发的楼层, 用于查运行时间表
+
+    // 请求管理(楼层位图)
+    FloorMask internal_targets;         // 电梯内目标楼层
+    FloorMask external_up_requests;     // 外部上行请求
+    FloorMask external_down_requests;   // 外部下行请求
+    FloorMask stop_mask;                // 三者之并: 需要停靠的楼层
+    FloorMask served_floors;            // 可停靠的楼层, 默认全部
+    RouteSummary route;
+
+    // 同一时刻只有一个待执行的动作(移动/开关门/报警复位)
+    TimerService::TimerId pending_timer = TimerService::InvalidTimer;
+    TimerService::Time pending_due = 0;
+
+    std::vector<CarObserver*> observers;
+};
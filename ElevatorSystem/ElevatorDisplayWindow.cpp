@@ -1,27 +1,77 @@
 ﻿#include "ElevatorDisplayWindow.h"
 #include "Elevator.h"
+#include <QScrollBar>
+#include <algorithm>
 
-ElevatorDisplayWindow::ElevatorDisplayWindow(int elevatorCount, int floorCount, QLabel* elevator_floor_labels, SimulationMainWindow* simu_window, QWidget* parent)
-    : QWidget(parent, Qt::Window), elevator_count(elevatorCount), elevator_floor_labels(elevator_floor_labels), simu_window(simu_window), floor_count(floorCount) {
+ElevatorDisplayWindow::ElevatorDisplayWindow(int elevatorCount, int floorCount, SimulationMainWindow* simu_window, QWidget* parent)
+    : QWidget(parent, Qt::Window), elevator_count(elevatorCount), simu_window(simu_window), floor_count(floorCount) {
     setWindowTitle("电梯监控界面");
     setMinimumSize(1100, 700);
 	move(100, 100); // 设置窗口初始位置
     scrollArea = new QScrollArea(this);
-    QWidget* container = new QWidget(scrollArea);
-    QGridLayout* layout = new QGridLayout(container);
-
-    // 每行显示3个电梯
-    for (int i = 0; i < elevatorCount; ++i) {
-        Elevator* elevator = new Elevator(i + 1, floorCount, &elevator_floor_labels[i], container);
-        elevator->Init();
-        layout->addWidget(elevator, i / 3, i % 3);
-        elevator->show();
-		simu_window->AddElevator(elevator);
-    }
+    container = new QWidget(scrollArea);
+    // 容器只占位, 面板按固定网格直接定位, 不经过布局
+    int rows = (elevatorCount + Columns - 1) / Columns;
+    container->setFixedSize(Columns * PanelWidth + 10, std::max(rows, 1) * PanelHeight + 10);
 
     scrollArea->setWidget(container);
-    scrollArea->setWidgetResizable(true);
+    scrollArea->setWidgetResizable(false);
+    connect(scrollArea->verticalScrollBar(), &QScrollBar::valueChanged, this, &ElevatorDisplayWindow::UpdateVisiblePanels);
 
     QVBoxLayout* mainLayout = new QVBoxLayout(this);
     mainLayout->addWidget(scrollArea);
-}
\ No newline at end of file
+}
+
+void ElevatorDisplayWindow::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    UpdateVisiblePanels();
+}
+
+void ElevatorDisplayWindow::UpdateVisiblePanels()
+{
+    const int top = scrollArea->verticalScrollBar()->value();
+    const int bottom = top + scrollArea->viewport()->height();
+    const int first = std::max(0, top / PanelHeight) * Columns;
+    const int last = std::min(elevator_count - 1, (bottom / PanelHeight + 1) * Columns - 1);
+
+    // 回收滚出视野的面板
+    auto out_of_view = [=](Elevator* panel) {
+        return panel->GetIndex() < first || panel->GetIndex() > last;
+    };
+    for (Elevator* panel : active_panels) {
+        if (out_of_view(panel)) {
+            panel->hide();
+            free_panels.push_back(panel);
+        }
+    }
+    active_panels.erase(std::remove_if(active_panels.begin(), active_panels.end(), out_of_view), active_panels.end());
+
+    // 为新进入视野的电梯绑定面板
+    for (int i = first; i <= last; ++i) {
+        bool shown = std::any_of(active_panels.begin(), active_panels.end(),
+            [=](Elevator* panel) { return panel->GetIndex() == i; });
+        if (shown) continue;
+        const CarSnapshot& car = simu_window->GetSimulation().ReadSnapshot().cars[i];
+        Elevator* panel;
+        if (free_panels.empty()) {
+            panel = new Elevator(&simu_window->GetSimulation(), i, container);
+        }
+        else {
+            panel = free_panels.back();
+            free_panels.pop_back();
+            panel->Bind(i, car);
+        }
+        panel->move(5 + (i % Columns) * PanelWidth, 5 + (i / Columns) * PanelHeight);
+        panel->show();
+        active_panels.push_back(panel);
+    }
+}
+
+void ElevatorDisplayWindow::ApplySnapshot(const GroupSnapshot& snapshot)
+{
+    for (Elevator* panel : active_panels) {
+        if (panel->GetIndex() < static_cast<int>(snapshot.cars.size()))
+            panel->ApplySnapshot(snapshot.cars[panel->GetIndex()]);
+    }
+}
@@ -13,8 +13,14 @@ class ElevatorDisplayWindow : public QWidget
 	Q_OBJECT
 
 public:
-	ElevatorDisplayWindow(int elevatorCount, int floorCount, QLabel* elevator_floor_labels, SimulationMainWindow* simu_window, QWidget* parent = nullptr);
+	ElevatorDisplayWindow(int elevatorCount, int floorCount, SimulationMainWindow* simu_window, QWidget* parent = nullptr);
 	~ElevatorDisplayWindow() {}
+public:
+	void ApplySnapshot(const GroupSnapshot& snapshot); // 只刷新当前可见的面板
+protected:
+	void resizeEvent(QResizeEvent* event) override;
+private:
+	void UpdateVisiblePanels(); // 按滚动位置创建、回收面板
 
 private:
 	Ui::ElevatorDisplayWindowClass ui;
@@ -27,7 +33,13 @@ public:
 	SimulationMainWindow* simu_window;
 private:
 	QScrollArea* scrollArea;
-	QLabel* elevator_floor_labels;
+	QWidget* container;
 	int elevator_count;
 	int floor_count;
+	// 面板只为可见的电梯创建, 滚出视野后放回空闲列表, 再次需要时换绑复用
+	std::vector<Elevator*> active_panels;
+	std::vector<Elevator*> free_panels;
+	static const int Columns = 3; // 每行显示3个电梯
+	static const int PanelWidth = 290;
+	static const int PanelHeight = 490;
 };
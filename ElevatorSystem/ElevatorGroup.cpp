@@ -0,0 +1,1012 @@
+﻿#include "ElevatorGroup.h"
+#include "Checkpoint.h"
+#include "Dispatcher.h"
+#include "JointAssignment.h"
+#include "LookaheadOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+
+namespace {
+    // 批量派梯窗口内最多联合求解的外呼数, 保证求解时间有界; 超出的外呼保留立即派梯的结果
+    const size_t MaxBatchedCalls = 64;
+    // 联合求解时不可用或满载的电梯的附加代价: 与ChooseCar一样, 只有没有可用电梯时才派给它们
+    const long long UnavailablePenalty = 1LL << 40;
+
+    std::uint64_t ElapsedNs(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void SavePassengers(CheckpointWriter& writer, const std::vector<Passenger>& passengers)
+    {
+        writer.Put<std::uint64_t>(passengers.size());
+        for (const Passenger& p : passengers) {
+            writer.Put(p.id);
+            writer.Put<std::int32_t>(p.origin);
+            writer.Put<std::int32_t>(p.destination);
+            writer.Put(p.arrival_time);
+            writer.Put(p.board_time);
+            writer.Put(p.alight_time);
+            writer.Put<std::int32_t>(p.elevator_id);
+            writer.Put<std::int32_t>(p.assigned_car);
+            writer.Put<std::int32_t>(p.transfer_floor);
+        }
+    }
+
+    bool LoadPassengers(CheckpointReader& reader, std::vector<Passenger>& passengers)
+    {
+        std::uint64_t count = reader.Get<std::uint64_t>();
+        passengers.clear();
+        for (std::uint64_t i = 0; i < count && reader.Ok(); ++i) {
+            Passenger p;
+            p.id = reader.Get<std::uint64_t>();
+            p.origin = reader.Get<std::int32_t>();
+            p.destination = reader.Get<std::int32_t>();
+            p.arrival_time = reader.Get<TimerService::Time>();
+            p.board_time = reader.Get<TimerService::Time>();
+            p.alight_time = reader.Get<TimerService::Time>();
+            p.elevator_id = reader.Get<std::int32_t>();
+            p.assigned_car = reader.Get<std::int32_t>();
+            p.transfer_floor = reader.Get<std::int32_t>();
+            passengers.push_back(p);
+        }
+        return reader.Ok();
+    }
+}
+
+ElevatorGroup::ElevatorGroup(int elevator_count, int floor_count, TimerService& timers, const CarTiming& timing)
+    : floor_count(floor_count), timers(timers)
+{
+    floorButtonStates.resize(floor_count);
+    waiting.resize(floor_count);
+    riders.resize(elevator_count);
+    planned_destinations.assign(elevator_count, std::vector<int>(floor_count, 0));
+    health.resize(elevator_count);
+    cars.reserve(elevator_count);
+    // 所有电梯型号相同, 共用一张运行时间表
+    std::shared_ptr<const MotionTable> motion = std::make_shared<const MotionTable>(timing, floor_count);
+    fleet.Reset(elevator_count, floor_count, timing, motion);
+    for (int i = 0; i < elevator_count; ++i) {
+        cars.emplace_back(new ElevatorCar(i + 1, floor_count, timers, timing, motion));
+        cars.back()->AddObserver(this);
+        SyncFleet(*cars.back());
+    }
+}
+
+ElevatorGroup::~ElevatorGroup()
+{
+    if (watchdog_timer != TimerService::InvalidTimer)
+        timers.Cancel(watchdog_timer);
+    if (batch_timer != TimerService::InvalidTimer)
+        timers.Cancel(batch_timer);
+    for (auto& car : cars)
+        car->RemoveObserver(this);
+}
+
+const char* ElevatorGroup::ModeName(DispatchMode mode)
+{
+    switch (mode) {
+    case DispatchMode::Collective: return "collective";
+    case DispatchMode::Destination: return "destination";
+    }
+    return "unknown";
+}
+
+bool ElevatorGroup::ParseMode(const std::string& name, DispatchMode& mode)
+{
+    const DispatchMode all[] = { DispatchMode::Collective, DispatchMode::Destination };
+    for (DispatchMode m : all) {
+        if (name == ModeName(m)) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ElevatorGroup::ApplyZonePlan(const ZonePlan& plan)
+{
+    zoned = false;
+    for (size_t i = 0; i < cars.size() && i < plan.served.size(); ++i) {
+        cars[i]->SetServedFloors(plan.served[i]);
+        if (cars[i]->GetServedFloors().Count() < floor_count) zoned = true;
+        SyncFleet(*cars[i]);
+    }
+    transfer_floors = plan.transfer_floors;
+}
+
+void ElevatorGroup::PressHallButton(int floor, Direction dir)
+{
+    if (floor < 0 || floor >= floor_count) return;
+    LightHallButton(floor, dir);
+    AssignExternalRequests(floor, dir);
+}
+
+void ElevatorGroup::LightHallButton(int floor, Direction dir)
+{
+    if (HasElevatorStoppedAtFloor(floor)) return;
+    FloorButtonState& state = floorButtonStates[floor];
+    if (dir == Direction::Up && !state.upPressed) {
+        state.upPressed = true;
+        state.upDirection = Direction::Up;
+        NotifyHallCallChanged(floor, Direction::Up, true);
+    }
+    else if (dir == Direction::Down && !state.downPressed) {
+        state.downPressed = true;
+        state.downDirection = Direction::Down;
+        NotifyHallCallChanged(floor, Direction::Down, true);
+    }
+}
+
+void ElevatorGroup::AssignExternalRequests(int floor, Direction dir, int destination)
+{
+    auto start = std::chrono::steady_clock::now();
+    ElevatorCar* best = ChooseCar(floor, dir, destination);
+    RecordDecision(start);
+    if (best) {
+        best->AddExternalRequest(floor, dir);
+        ++call_version;
+        NotifyCallAssigned(*best, floor, dir);
+        if (batch_window_ms > 0 && dispatch_mode == DispatchMode::Collective)
+            QueueBatchedCall(floor, dir, destination);
+    }
+}
+
+void ElevatorGroup::QueueBatchedCall(int floor, Direction dir, int destination)
+{
+    for (const BatchedCall& call : batch)
+        if (call.floor == floor && call.dir == dir && call.destination == destination) return;
+    if (batch.size() >= MaxBatchedCalls) return;
+    BatchedCall call;
+    call.floor = floor;
+    call.dir = dir;
+    call.destination = destination;
+    batch.push_back(call);
+    if (batch_timer == TimerService::InvalidTimer)
+        ScheduleBatch(timers.Now() + batch_window_ms);
+}
+
+void ElevatorGroup::ScheduleBatch(TimerService::Time due)
+{
+    batch_due = std::max(due, timers.Now());
+    batch_timer = timers.Schedule(static_cast<int>(batch_due - timers.Now()), [this]() {
+        batch_timer = TimerService::InvalidTimer;
+        SolveBatch();
+    });
+}
+
+void ElevatorGroup::SolveBatch()
+{
+    // 只处理仍在等待的外呼, 窗口内已被接走的跳过; 分区时原电梯必须能到达乘客的去向
+    std::vector<BatchedCall> calls;
+    std::vector<int> holders;
+    for (const BatchedCall& call : batch) {
+        for (size_t c = 0; c < cars.size(); ++c) {
+            const ElevatorCar& car = *cars[c];
+            if (car.ExternalRequestExists(call.floor, call.dir) && (call.destination < 0 || car.Serves(call.destination))) {
+                calls.push_back(call);
+                holders.push_back(static_cast<int>(c));
+                break;
+            }
+        }
+    }
+    batch.clear();
+    if (calls.size() < 2 || dispatch_mode != DispatchMode::Collective) return;
+
+    auto start = std::chrono::steady_clock::now();
+    // 先从原电梯撤下, 代价矩阵不偏向立即派梯时选中的电梯
+    for (size_t k = 0; k < calls.size(); ++k)
+        cars[holders[k]]->RemoveExternalRequest(calls[k].floor, calls[k].dir);
+
+    // 每轮每部电梯最多接一个外呼; 派出的外呼计入停靠计划后, 剩下的外呼在下一轮按新的代价求解
+    const int car_count = GetElevatorCount();
+    std::vector<int> targets(calls.size(), -1);
+    std::vector<size_t> open(calls.size());
+    std::iota(open.begin(), open.end(), size_t(0));
+    std::vector<long long> matrix;
+    while (!open.empty()) {
+        matrix.assign(open.size() * car_count, JointAssignment::Forbidden);
+        for (size_t r = 0; r < open.size(); ++r) {
+            const BatchedCall& call = calls[open[r]];
+            fleet.AssignmentCosts(call.floor, timers.Now(), costs);
+            for (int c = 0; c < car_count; ++c) {
+                if (!fleet.Serves(c, call.floor) || (call.destination >= 0 && !fleet.Serves(c, call.destination)))
+                    continue;
+                matrix[r * car_count + c] = costs[c] + (fleet.TakesCalls(c) ? 0 : UnavailablePenalty);
+            }
+        }
+        std::vector<int> solution = JointAssignment::Solve(matrix, static_cast<int>(open.size()), car_count);
+        std::vector<size_t> rest;
+        for (size_t r = 0; r < open.size(); ++r) {
+            const BatchedCall& call = calls[open[r]];
+            if (solution[r] < 0) {
+                rest.push_back(open[r]);
+                continue;
+            }
+            targets[open[r]] = solution[r];
+            cars[solution[r]]->AddExternalRequest(call.floor, call.dir);
+        }
+        if (rest.size() == open.size()) break; // 剩下的外呼没有电梯能到达
+        open.swap(rest);
+    }
+    RecordDecision(start);
+
+    int moved = 0;
+    for (size_t k = 0; k < calls.size(); ++k) {
+        if (targets[k] < 0) {
+            cars[holders[k]]->AddExternalRequest(calls[k].floor, calls[k].dir);
+        }
+        else if (targets[k] != holders[k]) {
+            ++moved;
+            NotifyCallAssigned(*cars[targets[k]], calls[k].floor, calls[k].dir);
+        }
+    }
+    if (moved > 0) ++call_version;
+}
+
+ElevatorCar* ElevatorGroup::ChooseCar(int floor, Direction dir, int destination)
+{
+    // 选择代价最小的电梯; 已计划在该层停靠的电梯不增加额外停靠
+    // 候梯乘客会进入任何在本层开门的电梯, 所以只看停靠计划而不区分方向
+    // 分区时只考虑服务本层(以及已知目的层)的电梯
+    // 先只看可用且未满载的电梯; 全部故障或满载时仍派给能到达的电梯, 外呼不会丢失
+    // 代价对所有电梯一次算出(FleetState), 两轮只是按不同条件挑最小值
+    fleet.AssignmentCosts(floor, timers.Now(), costs);
+    int best = -1;
+    for (int pass = 0; pass < 2 && best < 0; ++pass) {
+        for (int i = 0; i < fleet.GetCount(); ++i) {
+            if (!fleet.Serves(i, floor) || (destination >= 0 && !fleet.Serves(i, destination)) ||
+                (pass == 0 && !fleet.TakesCalls(i)))
+                continue;
+            if (best < 0 || costs[i] < costs[best])
+                best = i;
+        }
+    }
+    return best < 0 ? nullptr : cars[best].get();
+}
+
+ElevatorCar* ElevatorGroup::ChooseCarForDestination(int origin, int destination)
+{
+    // 目的层相同的乘客尽量分到同一部电梯, 减少停靠次数; 与ChooseCar一样优先可用的电梯
+    ElevatorCar* best = nullptr;
+    long long best_cost = 0;
+    for (int pass = 0; pass < 2 && !best; ++pass) {
+        for (int i = 0; i < fleet.GetCount(); ++i) {
+            if (!fleet.Serves(i, origin) || !fleet.Serves(i, destination) || (pass == 0 && !fleet.TakesCalls(i)))
+                continue;
+            ElevatorCar& elevator = *cars[i];
+            long long cost = Dispatcher::DestinationCost(fleet.Status(i, timers.Now()), elevator.GetTiming(),
+                elevator.GetMotion(), origin, destination, fleet.StopsAt(i, origin), PlansStopAt(elevator, destination));
+            if (!best || cost < best_cost) {
+                best_cost = cost;
+                best = &elevator;
+            }
+        }
+    }
+    return best;
+}
+
+int ElevatorGroup::FindTransferFloor(int origin, int destination) const
+{
+    // 在换乘层中选绕行最少的一个, 两程都要有电梯直达
+    int best = -1;
+    int best_distance = 0;
+    for (int floor : transfer_floors) {
+        bool first = false, second = false;
+        for (auto& car : cars) {
+            first = first || CanCarry(*car, origin, floor);
+            second = second || CanCarry(*car, floor, destination);
+        }
+        int distance = std::abs(floor - origin) + std::abs(destination - floor);
+        if (first && second && floor != origin && floor != destination && (best < 0 || distance < best_distance)) {
+            best = floor;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+bool ElevatorGroup::PlansStopAt(const ElevatorCar& car, int floor) const
+{
+    return car.GetStopMask().Test(floor) || planned_destinations[car.GetElevatorID() - 1][floor] > 0;
+}
+
+bool ElevatorGroup::IsCallCovered(int floor, Direction dir, int destination) const
+{
+    for (auto& car : cars) {
+        // 满载电梯只有登记了本层外呼才算: 经过时会把外呼改派出去
+        if (car->Serves(destination) && car->Serves(floor) && IsAvailable(*car) &&
+            (car->ExternalRequestExists(floor, dir) || (!car->IsFull() && car->GetStopMask().Test(floor))))
+            return true;
+    }
+    return false;
+}
+
+bool ElevatorGroup::HasElevatorStoppedAtFloor(int floor) const
+{
+    for (auto& elevator : cars) {
+        if (elevator->GetCurrentFloor() == floor &&
+            (elevator->GetState() == ElevatorState::Idle ||
+                elevator->GetState() == ElevatorState::Open)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t ElevatorGroup::AddPassenger(int origin, int destination)
+{
+    if (origin < 0 || origin >= floor_count || destination < 0 || destination >= floor_count || origin == destination)
+        return 0;
+    Passenger passenger;
+    passenger.origin = origin;
+    passenger.destination = destination;
+    if (zoned) {
+        // 没有电梯直达时经空中大堂换乘
+        bool direct = false;
+        for (auto& car : cars)
+            direct = direct || CanCarry(*car, origin, destination);
+        if (!direct) {
+            passenger.transfer_floor = FindTransferFloor(origin, destination);
+            if (passenger.transfer_floor < 0) return 0;
+        }
+    }
+    passenger.id = ++next_passenger_id;
+    passenger.arrival_time = timers.Now();
+    return StartLeg(passenger) ? passenger.id : 0;
+}
+
+bool ElevatorGroup::StartLeg(Passenger& passenger)
+{
+    const int origin = passenger.origin;
+    const int destination = passenger.LegDestination();
+    Direction dir = destination > origin ? Direction::Up : Direction::Down;
+
+    if (dispatch_mode == DispatchMode::Destination) {
+        auto start = std::chrono::steady_clock::now();
+        ElevatorCar* car = ChooseCarForDestination(origin, destination);
+        RecordDecision(start);
+        if (!car) return false;
+        passenger.assigned_car = car->GetElevatorID();
+        for (size_t i = 0; i < observers.size(); ++i)
+            observers[i]->OnDestinationAssigned(passenger);
+
+        // 分配的电梯正在本层开门且未满载, 直接进入
+        if (car->GetCurrentFloor() == origin && !car->IsFull() &&
+            (car->GetState() == ElevatorState::Opening || car->GetState() == ElevatorState::Open)) {
+            BoardPassenger(*car, passenger);
+            car->HoldDoor(car->GetTiming().transfer_ms);
+            return true;
+        }
+        planned_destinations[car->GetElevatorID() - 1][destination]++;
+        waiting[origin].push_back(passenger);
+        car->AddExternalRequest(origin, dir);
+        NotifyCallAssigned(*car, origin, dir);
+        return true;
+    }
+
+    // 本层有能到达目的层且未满载的电梯正在开门, 直接进入
+    for (auto& car : cars) {
+        if (car->GetCurrentFloor() == origin && car->Serves(destination) && !car->IsFull() &&
+            (car->GetState() == ElevatorState::Opening || car->GetState() == ElevatorState::Open)) {
+            BoardPassenger(*car, passenger);
+            car->HoldDoor(car->GetTiming().transfer_ms);
+            return true;
+        }
+    }
+    waiting[origin].push_back(passenger);
+    LightHallButton(origin, dir);
+    AssignExternalRequests(origin, dir, destination);
+    return true;
+}
+
+void ElevatorGroup::BoardPassenger(ElevatorCar& car, Passenger& passenger)
+{
+    // 换乘后的第二程不再计为上梯, 候梯时间只算第一次
+    bool first_leg = passenger.board_time < 0;
+    if (first_leg)
+        passenger.board_time = timers.Now();
+    passenger.elevator_id = car.GetElevatorID();
+    riders[car.GetElevatorID() - 1].push_back(passenger);
+    car.SetLoad(static_cast<int>(riders[car.GetElevatorID() - 1].size()));
+    SyncFleet(car);
+    if (first_leg) {
+        for (size_t i = 0; i < observers.size(); ++i)
+            observers[i]->OnPassengerBoarded(passenger);
+    }
+    car.AddInternalTarget(passenger.LegDestination());
+}
+
+size_t ElevatorGroup::GetWaitingCount() const
+{
+    size_t count = 0;
+    for (auto& queue : waiting)
+        count += queue.size();
+    return count;
+}
+
+size_t ElevatorGroup::GetRidingCount() const
+{
+    size_t count = 0;
+    for (auto& list : riders)
+        count += list.size();
+    return count;
+}
+
+void ElevatorGroup::OnCarArrived(const ElevatorCar& car, int floor, ElevatorState state)
+{
+    if (floor < 0 || floor >= floor_count) return;
+    ++call_version;
+
+    // 到达目的地的乘客离开, 到达换乘层的乘客改为在本层候梯
+    ElevatorCar& stopped = *cars[car.GetElevatorID() - 1];
+    std::vector<Passenger>& inside = riders[car.GetElevatorID() - 1];
+    const size_t riding = inside.size();
+    std::vector<Passenger> transferring;
+    for (size_t i = 0; i < inside.size();) {
+        if (inside[i].LegDestination() == floor) {
+            if (inside[i].transfer_floor >= 0) {
+                Passenger next = inside[i];
+                next.origin = floor;
+                next.transfer_floor = -1;
+                next.elevator_id = 0;
+                next.assigned_car = 0;
+                transferring.push_back(next);
+            }
+            else {
+                inside[i].alight_time = timers.Now();
+                for (size_t k = 0; k < observers.size(); ++k)
+                    observers[k]->OnPassengerAlighted(inside[i]);
+            }
+            inside[i] = inside.back();
+            inside.pop_back();
+        }
+        else {
+            ++i;
+        }
+    }
+    stopped.SetLoad(static_cast<int>(inside.size()));
+    SyncFleet(stopped);
+    size_t transfers = riding - inside.size();
+
+    // 本层候梯乘客按到达顺序进入, 直到满载; 目的层派梯时只有分配到这部电梯的乘客进入
+    bool left_behind = false;
+    if (!waiting[floor].empty()) {
+        const int capacity = stopped.GetTiming().capacity;
+        size_t room = capacity > 0 ? static_cast<size_t>(std::max(0, capacity - stopped.GetLoad())) : waiting[floor].size();
+        std::vector<Passenger> boarding, remaining;
+        for (auto& passenger : waiting[floor]) {
+            bool wants = passenger.assigned_car == car.GetElevatorID() ||
+                (passenger.assigned_car == 0 && car.Serves(passenger.LegDestination()));
+            if (wants && boarding.size() < room) {
+                boarding.push_back(passenger);
+            }
+            else {
+                left_behind = left_behind || wants;
+                remaining.push_back(passenger);
+            }
+        }
+        waiting[floor].swap(remaining);
+        for (auto& passenger : boarding) {
+            if (passenger.assigned_car > 0)
+                planned_destinations[passenger.assigned_car - 1][passenger.LegDestination()]--;
+            BoardPassenger(stopped, passenger);
+        }
+        transfers += boarding.size();
+    }
+    // 上下梯的乘客越多, 开门停留越久
+    stopped.HoldDoor(static_cast<int>(transfers) * stopped.GetTiming().transfer_ms);
+
+    FloorButtonState& button = floorButtonStates[floor];
+
+    // 检查上按钮是否需要恢复
+    if (button.upPressed && button.upDirection == Direction::Up) {
+        button.upPressed = false;
+        button.upDirection = Direction::None;
+        NotifyHallCallChanged(floor, Direction::Up, false);
+    }
+    // 检查下按钮是否需要恢复
+    if (button.downPressed && button.downDirection == Direction::Down) {
+        button.downPressed = false;
+        button.downDirection = Direction::None;
+        NotifyHallCallChanged(floor, Direction::Down, false);
+    }
+
+    if (left_behind)
+        RecallLeftBehind(car, floor);
+
+    // 分区时停靠的电梯不一定能把本层乘客送到目的层, 满载时也会留下乘客, 留下的乘客重新呼梯
+    // 先复制再派梯: 派梯可能让另一部电梯在本层开门并修改候梯队列
+    if ((zoned || left_behind) && !waiting[floor].empty()) {
+        std::vector<int> legs;
+        for (auto& passenger : waiting[floor])
+            if (passenger.assigned_car == 0) legs.push_back(passenger.LegDestination());
+        for (int destination : legs) {
+            Direction dir = destination > floor ? Direction::Up : Direction::Down;
+            if (!IsCallCovered(floor, dir, destination)) {
+                LightHallButton(floor, dir);
+                AssignExternalRequests(floor, dir, destination);
+            }
+        }
+    }
+    for (auto& passenger : transferring)
+        StartLeg(passenger);
+
+    // 外呼全部处理完时停止看门狗, 事件队列可以排空
+    if (watchdog_timer != TimerService::InvalidTimer && !HasHallCalls()) {
+        timers.Cancel(watchdog_timer);
+        watchdog_timer = TimerService::InvalidTimer;
+    }
+}
+
+void ElevatorGroup::OnCarAlarm(const ElevatorCar& car)
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCarAlarm(car.GetElevatorID());
+    RescueCalls(*cars[car.GetElevatorID() - 1], timers.Now());
+}
+
+void ElevatorGroup::OnCarBypassed(const ElevatorCar& car, int floor)
+{
+    // 满载电梯经过时把本层外呼改派给其他电梯; 没有能接手的电梯时外呼留在原电梯, 下客后折返服务
+    ElevatorCar& full = *cars[car.GetElevatorID() - 1];
+    const Direction dirs[] = { Direction::Up, Direction::Down };
+    for (Direction dir : dirs) {
+        if (full.ExternalRequestExists(floor, dir))
+            ReassignCall(full, floor, dir);
+    }
+}
+
+void ElevatorGroup::RecallLeftBehind(const ElevatorCar& car, int floor)
+{
+    // 目的层派梯: 分配给满载电梯的乘客重新分配; 集选控制的乘客由OnCarArrived中的重新呼梯处理
+    if (dispatch_mode != DispatchMode::Destination) return;
+    const int id = car.GetElevatorID();
+    std::vector<Passenger> recall, remaining;
+    for (Passenger& passenger : waiting[floor]) {
+        if (passenger.assigned_car == id) {
+            planned_destinations[id - 1][passenger.LegDestination()]--;
+            passenger.assigned_car = 0;
+            recall.push_back(passenger);
+        }
+        else {
+            remaining.push_back(passenger);
+        }
+    }
+    waiting[floor].swap(remaining);
+    for (Passenger& passenger : recall)
+        StartLeg(passenger);
+}
+
+void ElevatorGroup::OnCarStateChanged(const ElevatorCar& car)
+{
+    // 出发、转为空闲和停靠后第一次开门算进展; 门的后续动作、门被重新打开和报警都不算
+    CarHealth& state = health[car.GetElevatorID() - 1];
+    ElevatorState previous = state.state;
+    state.state = car.GetState();
+    bool progress = state.state == ElevatorState::Idle || state.state == ElevatorState::Up || state.state == ElevatorState::Down ||
+        (state.state == ElevatorState::Opening && previous != ElevatorState::Open && previous != ElevatorState::Closing);
+    if (progress) {
+        state.last_progress = timers.Now();
+        state.stalled = false;
+    }
+    SyncFleet(car);
+}
+
+void ElevatorGroup::OnCarFloorChanged(const ElevatorCar& car)
+{
+    CarHealth& state = health[car.GetElevatorID() - 1];
+    state.last_progress = timers.Now();
+    state.stalled = false;
+    SyncFleet(car);
+}
+
+void ElevatorGroup::OnCarPlanChanged(const ElevatorCar& car)
+{
+    SyncFleet(car);
+}
+
+void ElevatorGroup::SyncFleet(const ElevatorCar& car)
+{
+    fleet.Update(car.GetElevatorID() - 1, car, CanTakeCalls(car));
+}
+
+bool ElevatorGroup::HasHallCalls() const
+{
+    for (auto& car : cars)
+        if (car->GetExternalRequests(Direction::Up).Any() || car->GetExternalRequests(Direction::Down).Any())
+            return true;
+    return false;
+}
+
+bool ElevatorGroup::IsAvailable(const ElevatorCar& car) const
+{
+    const CarHealth& state = health[car.GetElevatorID() - 1];
+    return !car.IsAlarmActive() && !state.out_of_service && !state.stalled;
+}
+
+void ElevatorGroup::SetOutOfService(int index, bool out_of_service)
+{
+    // 停用的电梯送完车内乘客, 不再接受外呼; 恢复服务时重新开始计时
+    if (index < 0 || index >= GetElevatorCount() || health[index].out_of_service == out_of_service) return;
+    CarHealth& state = health[index];
+    state.out_of_service = out_of_service;
+    state.stalled = false;
+    state.last_progress = timers.Now();
+    SyncFleet(*cars[index]);
+    if (out_of_service)
+        RescueCalls(*cars[index], timers.Now());
+}
+
+void ElevatorGroup::RescueCalls(ElevatorCar& car, TimerService::Time fault_since)
+{
+    // 先复制外呼位图: 改派时本电梯的外呼会被移除
+    const Direction dirs[] = { Direction::Up, Direction::Down };
+    for (Direction dir : dirs) {
+        FloorMask calls = car.GetExternalRequests(dir);
+        for (int floor = calls.First(); floor >= 0; floor = calls.NextAbove(floor)) {
+            // 接手的电梯可能立即在本层开门带走乘客, 耽搁时间的起点要在改派前算好
+            TimerService::Time since = CallSince(floor, dir, fault_since);
+            ElevatorCar* target = ReassignCall(car, floor, dir);
+            if (!target) continue;
+            for (size_t i = 0; i < observers.size(); ++i)
+                observers[i]->OnCallRescued(car.GetElevatorID(), target->GetElevatorID(), floor, dir, timers.Now() - since);
+        }
+    }
+}
+
+ElevatorCar* ElevatorGroup::ReassignCall(ElevatorCar& car, int floor, Direction dir)
+{
+    return dispatch_mode == DispatchMode::Destination
+        ? ReassignDestinationCall(car, floor, dir)
+        : ReassignCollectiveCall(car, floor, dir);
+}
+
+ElevatorCar* ElevatorGroup::ReassignCollectiveCall(ElevatorCar& car, int floor, Direction dir)
+{
+    // 分区时按一位候梯乘客的去向选电梯, 其他去向的乘客在新电梯停靠后重新呼梯
+    int destination = -1;
+    for (size_t i = 0; zoned && i < waiting[floor].size() && destination < 0; ++i) {
+        const Passenger& passenger = waiting[floor][i];
+        if (passenger.assigned_car == 0 && (passenger.LegDestination() > floor) == (dir == Direction::Up))
+            destination = passenger.LegDestination();
+    }
+    auto start = std::chrono::steady_clock::now();
+    ElevatorCar* target = ChooseCar(floor, dir, destination);
+    RecordDecision(start);
+    if (!target || !CanTakeCalls(*target)) return nullptr;
+    car.RemoveExternalRequest(floor, dir);
+    target->AddExternalRequest(floor, dir);
+    ++call_version;
+    NotifyCallAssigned(*target, floor, dir);
+    return target;
+}
+
+ElevatorCar* ElevatorGroup::ReassignDestinationCall(ElevatorCar& car, int floor, Direction dir)
+{
+    // 目的层派梯: 逐个乘客重新分配并重新告知; 全部分配完再登记外呼, 登记可能让电梯在本层开门并修改候梯队列
+    const int from = car.GetElevatorID();
+    std::vector<ElevatorCar*> targets;
+    bool remaining = false;
+    for (Passenger& passenger : waiting[floor]) {
+        const int leg = passenger.LegDestination();
+        if (passenger.assigned_car != from || (leg > floor) != (dir == Direction::Up)) continue;
+        auto start = std::chrono::steady_clock::now();
+        ElevatorCar* target = ChooseCarForDestination(floor, leg);
+        RecordDecision(start);
+        if (!target || !CanTakeCalls(*target)) {
+            remaining = true;
+            continue;
+        }
+        planned_destinations[from - 1][leg]--;
+        planned_destinations[target->GetElevatorID() - 1][leg]++;
+        passenger.assigned_car = target->GetElevatorID();
+        for (size_t i = 0; i < observers.size(); ++i)
+            observers[i]->OnDestinationAssigned(passenger);
+        if (std::find(targets.begin(), targets.end(), target) == targets.end())
+            targets.push_back(target);
+    }
+    if (targets.empty()) return nullptr;
+    if (!remaining)
+        car.RemoveExternalRequest(floor, dir);
+    ++call_version;
+    for (ElevatorCar* target : targets) {
+        target->AddExternalRequest(floor, dir);
+        NotifyCallAssigned(*target, floor, dir);
+    }
+    return targets.front();
+}
+
+TimerService::Time ElevatorGroup::CallSince(int floor, Direction dir, TimerService::Time fault_since) const
+{
+    // 故障之后才到的乘客只从到达时算起; 没有乘客信息(界面按钮)时从故障开始算
+    TimerService::Time earliest = -1;
+    for (const Passenger& passenger : waiting[floor]) {
+        if ((passenger.LegDestination() > floor) == (dir == Direction::Up) &&
+            (earliest < 0 || passenger.arrival_time < earliest))
+            earliest = passenger.arrival_time;
+    }
+    return std::max(fault_since, earliest);
+}
+
+void ElevatorGroup::ScheduleWatchdog(TimerService::Time due)
+{
+    // 只保留最早的一次检查
+    if (watchdog_timer != TimerService::InvalidTimer) {
+        if (watchdog_due <= due) return;
+        timers.Cancel(watchdog_timer);
+    }
+    watchdog_due = std::max(due, timers.Now());
+    watchdog_timer = timers.Schedule(static_cast<int>(watchdog_due - timers.Now()), [this]() {
+        watchdog_timer = TimerService::InvalidTimer;
+        CheckStalls();
+    });
+}
+
+void ElevatorGroup::CheckStalls()
+{
+    // 有外呼的可用电梯超过stall_timeout_ms没有进展即视为停滞; 没有外呼时不再检查, 事件队列可以排空
+    const TimerService::Time now = timers.Now();
+    TimerService::Time next = -1;
+    for (size_t i = 0; i < cars.size(); ++i) {
+        ElevatorCar& car = *cars[i];
+        if (!IsAvailable(car) || (!car.GetExternalRequests(Direction::Up).Any() && !car.GetExternalRequests(Direction::Down).Any()))
+            continue;
+        CarHealth& state = health[i];
+        if (now - state.last_progress >= stall_timeout_ms) {
+            state.stalled = true;
+            SyncFleet(car);
+            RescueCalls(car, state.last_progress);
+        }
+        else if (next < 0 || state.last_progress + stall_timeout_ms < next) {
+            next = state.last_progress + stall_timeout_ms;
+        }
+    }
+    if (next >= 0)
+        ScheduleWatchdog(next);
+}
+
+void ElevatorGroup::SaveState(CheckpointWriter& writer) const
+{
+    writer.Put(CheckpointTag("GRP "));
+    writer.Put<std::int32_t>(GetElevatorCount());
+    writer.Put<std::int32_t>(floor_count);
+    writer.Put(dispatch_mode);
+    writer.Put(next_passenger_id);
+    writer.Put(dispatch_stats.decisions);
+    writer.Put(dispatch_stats.total_ns);
+    for (const FloorButtonState& button : floorButtonStates) {
+        writer.Put(button.upPressed);
+        writer.Put(button.downPressed);
+        writer.Put(button.upDirection);
+        writer.Put(button.downDirection);
+    }
+    for (const auto& passengers : waiting)
+        SavePassengers(writer, passengers);
+    for (const auto& passengers : riders)
+        SavePassengers(writer, passengers);
+    for (const auto& planned : planned_destinations)
+        for (int count : planned)
+            writer.Put<std::int32_t>(count);
+    for (const auto& car : cars)
+        car->SaveState(writer);
+    for (const CarHealth& state : health) {
+        writer.Put(state.out_of_service);
+        writer.Put(state.stalled);
+        writer.Put(state.state);
+        writer.Put(state.last_progress);
+    }
+    writer.Put(watchdog_timer);
+    writer.Put(watchdog_due);
+    writer.Put<std::uint64_t>(batch.size());
+    for (const BatchedCall& call : batch) {
+        writer.Put<std::int32_t>(call.floor);
+        writer.Put(call.dir);
+        writer.Put<std::int32_t>(call.destination);
+    }
+    writer.Put(batch_timer);
+    writer.Put(batch_due);
+}
+
+bool ElevatorGroup::LoadState(CheckpointReader& reader, std::vector<PendingTimer>& pending)
+{
+    // 电梯数和楼层数决定了状态的形状, 必须与保存时一致
+    if (!reader.Expect(CheckpointTag("GRP "))
+        || reader.Get<std::int32_t>() != GetElevatorCount()
+        || reader.Get<std::int32_t>() != floor_count)
+        return reader.Fail();
+    dispatch_mode = reader.Get<DispatchMode>();
+    next_passenger_id = reader.Get<std::uint64_t>();
+    dispatch_stats.decisions = reader.Get<std::uint64_t>();
+    dispatch_stats.total_ns = reader.Get<std::uint64_t>();
+    std::vector<FloorButtonState> buttons(floor_count);
+    for (FloorButtonState& button : buttons) {
+        button.upPressed = reader.Get<bool>();
+        button.downPressed = reader.Get<bool>();
+        button.upDirection = reader.Get<Direction>();
+        button.downDirection = reader.Get<Direction>();
+    }
+    for (auto& passengers : waiting)
+        LoadPassengers(reader, passengers);
+    for (auto& passengers : riders)
+        LoadPassengers(reader, passengers);
+    for (auto& planned : planned_destinations)
+        for (int& count : planned)
+            count = reader.Get<std::int32_t>();
+    for (auto& car : cars)
+        if (!car->LoadState(reader, pending)) return false;
+    // 电梯恢复状态时的通知会改写健康状态, 所以在电梯之后读取
+    for (CarHealth& state : health) {
+        state.out_of_service = reader.Get<bool>();
+        state.stalled = reader.Get<bool>();
+        state.state = reader.Get<ElevatorState>();
+        state.last_progress = reader.Get<TimerService::Time>();
+    }
+    TimerService::TimerId saved_watchdog = reader.Get<TimerService::TimerId>();
+    TimerService::Time saved_due = reader.Get<TimerService::Time>();
+    std::uint64_t batched = reader.Get<std::uint64_t>();
+    batch.clear();
+    for (std::uint64_t i = 0; i < batched && reader.Ok(); ++i) {
+        BatchedCall call;
+        call.floor = reader.Get<std::int32_t>();
+        call.dir = reader.Get<Direction>();
+        call.destination = reader.Get<std::int32_t>();
+        if (call.floor < 0 || call.floor >= floor_count || call.destination >= floor_count) return reader.Fail();
+        batch.push_back(call);
+    }
+    TimerService::TimerId saved_batch = reader.Get<TimerService::TimerId>();
+    TimerService::Time saved_batch_due = reader.Get<TimerService::Time>();
+    if (!reader.Ok()) return false;
+    // 车内人数由乘客列表得出, 不单独保存
+    for (size_t i = 0; i < cars.size(); ++i) {
+        cars[i]->SetLoad(static_cast<int>(riders[i].size()));
+        SyncFleet(*cars[i]);
+    }
+
+    if (watchdog_timer != TimerService::InvalidTimer) {
+        timers.Cancel(watchdog_timer);
+        watchdog_timer = TimerService::InvalidTimer;
+    }
+    if (saved_watchdog != TimerService::InvalidTimer) {
+        pending.push_back(PendingTimer{ saved_watchdog, [this, saved_due]() {
+            ScheduleWatchdog(saved_due);
+        } });
+    }
+    if (batch_timer != TimerService::InvalidTimer) {
+        timers.Cancel(batch_timer);
+        batch_timer = TimerService::InvalidTimer;
+    }
+    if (saved_batch != TimerService::InvalidTimer) {
+        pending.push_back(PendingTimer{ saved_batch, [this, saved_batch_due]() {
+            ScheduleBatch(saved_batch_due);
+        } });
+    }
+
+    // 按钮灯与界面同步
+    for (int floor = 0; floor < floor_count; ++floor) {
+        FloorButtonState& current = floorButtonStates[floor];
+        if (current.upPressed != buttons[floor].upPressed)
+            NotifyHallCallChanged(floor, Direction::Up, buttons[floor].upPressed);
+        if (current.downPressed != buttons[floor].downPressed)
+            NotifyHallCallChanged(floor, Direction::Down, buttons[floor].downPressed);
+        current = buttons[floor];
+    }
+    return true;
+}
+
+void ElevatorGroup::AddObserver(GroupObserver* observer)
+{
+    if (std::find(observers.begin(), observers.end(), observer) == observers.end())
+        observers.push_back(observer);
+}
+
+void ElevatorGroup::RemoveObserver(GroupObserver* observer)
+{
+    observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+}
+
+void ElevatorGroup::NotifyHallCallChanged(int floor, Direction dir, bool active)
+{
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnHallCallChanged(floor, dir, active);
+}
+
+void ElevatorGroup::RecordDecision(std::chrono::steady_clock::time_point start)
+{
+    std::uint64_t elapsed = ElapsedNs(start);
+    dispatch_stats.decisions++;
+    dispatch_stats.total_ns += elapsed;
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnDispatchDecision(elapsed);
+}
+
+void ElevatorGroup::BuildAssignmentProblem(AssignmentProblem& problem) const
+{
+    problem.version = call_version;
+    problem.cars.resize(cars.size());
+    problem.calls.clear();
+    if (cars.empty()) return;
+    problem.timing = cars[0]->GetTiming();
+    problem.motion = cars[0]->GetMotionTable();
+    const bool movable_mode = dispatch_mode == DispatchMode::Collective;
+    const Direction dirs[] = { Direction::Up, Direction::Down };
+    FloorMask seen[2] = { FloorMask(floor_count), FloorMask(floor_count) };
+
+    for (size_t i = 0; i < cars.size(); ++i) {
+        const ElevatorCar& car = *cars[i];
+        LookaheadCar& out = problem.cars[i];
+        out.status = Dispatcher::Status(car);
+        out.fixed_stops.clear();
+        const FloorMask& stops = car.GetStopMask();
+        for (int floor = stops.First(); floor >= 0; floor = stops.NextAbove(floor)) {
+            // 内选、本层正在处理的请求和已在别的电梯登记过的外呼都不改派
+            bool fixed = !movable_mode || car.InternalRequestExists(floor) || floor == car.GetCurrentFloor();
+            for (int d = 0; d < 2; ++d) {
+                if (!car.ExternalRequestExists(floor, dirs[d])) continue;
+                if (fixed || !seen[d].Set(floor)) {
+                    fixed = true;
+                    continue;
+                }
+                PendingCall call;
+                call.floor = floor;
+                call.dir = dirs[d];
+                call.car = static_cast<int>(i);
+                problem.calls.push_back(call);
+            }
+            if (fixed) out.fixed_stops.push_back(floor);
+        }
+    }
+
+    // 已等待时间取本层同方向最早到达的乘客; 分区时候选电梯必须能到达这些乘客的目的层
+    const TimerService::Time now = timers.Now();
+    for (PendingCall& call : problem.calls) {
+        TimerService::Time earliest = now;
+        for (const Passenger& passenger : waiting[call.floor]) {
+            if (passenger.assigned_car == 0 && (passenger.LegDestination() > call.floor) == (call.dir == Direction::Up))
+                earliest = std::min(earliest, passenger.arrival_time);
+        }
+        call.age_ms = now - earliest;
+        call.candidates.clear();
+        for (int c = 0; c < static_cast<int>(cars.size()); ++c) {
+            bool can_serve = cars[c]->Serves(call.floor);
+            const std::vector<Passenger>& queue = waiting[call.floor];
+            for (size_t k = 0; zoned && can_serve && k < queue.size(); ++k) {
+                int leg = queue[k].LegDestination();
+                if (queue[k].assigned_car == 0 && (leg > call.floor) == (call.dir == Direction::Up))
+                    can_serve = cars[c]->Serves(leg);
+            }
+            // 故障或满载的电梯不接手外呼, 但仍是它自己外呼的候选
+            if (can_serve && (CanTakeCalls(*cars[c]) || c == call.car)) call.candidates.push_back(c);
+        }
+    }
+}
+
+int ElevatorGroup::ApplyAssignmentPlan(const AssignmentPlan& plan)
+{
+    if (plan.version != call_version || dispatch_mode != DispatchMode::Collective) return 0;
+    int applied = 0;
+    const int car_count = static_cast<int>(cars.size());
+    for (const Reassignment& move : plan.moves) {
+        if (move.from_car < 0 || move.from_car >= car_count || move.to_car < 0 || move.to_car >= car_count) continue;
+        ElevatorCar& from = *cars[move.from_car];
+        ElevatorCar& to = *cars[move.to_car];
+        if (!from.ExternalRequestExists(move.floor, move.dir) || !to.Serves(move.floor) || !CanTakeCalls(to)) continue;
+        from.RemoveExternalRequest(move.floor, move.dir);
+        to.AddExternalRequest(move.floor, move.dir);
+        ++applied;
+        NotifyCallAssigned(to, move.floor, move.dir);
+    }
+    if (applied > 0) ++call_version;
+    return applied;
+}
+
+void ElevatorGroup::NotifyCallAssigned(const ElevatorCar& car, int floor, Direction dir)
+{
+    if (stall_timeout_ms > 0 && IsAvailable(car))
+        ScheduleWatchdog(health[car.GetElevatorID() - 1].last_progress + stall_timeout_ms);
+    for (size_t i = 0; i < observers.size(); ++i)
+        observers[i]->OnCallAssigned(car.GetElevatorID(), floor, dir);
+}
@@ -0,0 +1,178 @@
+﻿#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ElevatorCar.h"
+#include "FleetState.h"
+#include "Passenger.h"
+#include "TimerService.h"
+#include "Utilities.h"
+#include "Zoning.h"
+
+struct AssignmentProblem;
+struct AssignmentPlan;
+
+// 调度器统计: 决策次数与累计耗时
+struct DispatchStats {
+    std::uint64_t decisions = 0;
+    std::uint64_t total_ns = 0;
+};
+
+// 派梯方式
+enum class DispatchMode {
+    Collective, // 集选控制: 候梯厅只有上/下按钮, 进入轿厢后才知道目的层
+    Destination // 目的层派梯: 候梯厅输入目的层, 直接告知乘客应乘坐的电梯
+};
+
+struct FloorButtonState {
+    bool upPressed = false;
+    bool downPressed = false;
+    Direction upDirection = Direction::None;
+    Direction downDirection = Direction::None;
+};
+
+// 电梯组事件观察者(楼层按钮、报警提示等)
+class GroupObserver
+{
+public:
+    virtual ~GroupObserver() {}
+    virtual void OnHallCallChanged(int floor, Direction dir, bool active) {} // 楼层按钮点亮/熄灭
+    virtual void OnCarAlarm(int elevator_id) {}
+    virtual void OnPassengerBoarded(const Passenger& passenger) {}
+    virtual void OnPassengerAlighted(const Passenger& passenger) {}
+    virtual void OnDestinationAssigned(const Passenger& passenger) {} // 目的层派梯: assigned_car为应乘坐的电梯
+    virtual void OnCallAssigned(int elevator_id, int floor, Direction dir) {} // 外部请求分配给某部电梯
+    virtual void OnDispatchDecision(std::uint64_t elapsed_ns) {}            // 一次派梯决策的耗时(真实时间)
+    virtual void OnCallRescued(int from_id, int to_id, int floor, Direction dir, TimerService::Time delayed_ms) {} // 故障电梯的外呼改派, delayed_ms为因故障耽搁的时间
+};
+
+// 电梯健康状态: 报警、停用或停滞的电梯不再接受新外呼, 已登记的外呼改派给其他电梯
+struct CarHealth {
+    bool out_of_service = false;
+    bool stalled = false;                       // 有外呼却长时间没有进展
+    ElevatorState state = ElevatorState::Idle;  // 上次通知的状态, 用于区分门被反复重开
+    TimerService::Time last_progress = 0;       // 最近一次经过楼层、出发、转为空闲或停靠开门的时间
+};
+
+// 批量派梯窗口内的一个外呼; destination为分区时乘客的去向, 未知为-1
+struct BatchedCall {
+    int floor = 0;
+    Direction dir = Direction::None;
+    int destination = -1;
+};
+
+// 电梯组: 管理所有电梯和楼层外部请求, 负责调度
+class ElevatorGroup : public CarObserver
+{
+public:
+    ElevatorGroup(int elevator_count, int floor_count, TimerService& timers, const CarTiming& timing = CarTiming());
+    ~ElevatorGroup();
+    ElevatorGroup(const ElevatorGroup&) = delete;
+    ElevatorGroup& operator=(const ElevatorGroup&) = delete;
+public:
+    int GetElevatorCount() const { return static_cast<int>(cars.size()); }
+    int GetFloorCount() const { return floor_count; }
+    ElevatorCar& GetCar(int index) { return *cars[index]; }
+    const ElevatorCar& GetCar(int index) const { return *cars[index]; }
+    const std::vector<FloorButtonState>& GetFloorButtonStates() const { return floorButtonStates; }
+    void SetDispatchMode(DispatchMode mode) { dispatch_mode = mode; }
+    DispatchMode GetDispatchMode() const { return dispatch_mode; }
+    static const char* ModeName(DispatchMode mode);
+    static bool ParseMode(const std::string& name, DispatchMode& mode);
+    void ApplyZonePlan(const ZonePlan& plan); // 设置各电梯的服务楼层和换乘层, 在开始运行前调用
+    bool CanCarry(const ElevatorCar& car, int from, int to) const { return car.Serves(from) && car.Serves(to); }
+
+    void PressHallButton(int floor, Direction dir); // 楼层外部按钮按下
+    void AssignExternalRequests(int floor, Direction dir, int destination = -1); // destination已知时只派能到达它的电梯
+    bool HasElevatorStoppedAtFloor(int floor) const;
+    std::uint64_t AddPassenger(int origin, int destination); // 乘客到达候梯厅, 返回乘客编号
+    size_t GetWaitingCount() const;
+    size_t GetRidingCount() const;
+    const DispatchStats& GetDispatchStats() const { return dispatch_stats; }
+
+    // 故障改派: 报警和停用时立即改派; 停滞由看门狗在stall_timeout_ms没有进展后发现, 0为不检测
+    void SetOutOfService(int index, bool out_of_service);
+    const CarHealth& GetHealth(int index) const { return health[index]; }
+    bool IsAvailable(const ElevatorCar& car) const;
+    bool CanTakeCalls(const ElevatorCar& car) const { return IsAvailable(car) && !car.IsFull(); } // 可以接手新外呼: 可用且未满载
+    void SetStallTimeout(int timeout_ms) { stall_timeout_ms = timeout_ms; }
+    int GetStallTimeout() const { return stall_timeout_ms; }
+
+    // 批量派梯(仅集选控制): 外呼照常立即派梯, 同时记入窗口; 窗口在第一个外呼之后window_ms结束,
+    // 届时仍在等待的外呼按电梯×外呼代价矩阵联合求解并改派; 0为关闭, 单个外呼不受影响
+    void SetBatchWindow(int window_ms) { batch_window_ms = window_ms; }
+    int GetBatchWindow() const { return batch_window_ms; }
+
+    // 前瞻优化: 外呼分配变化时版本号加一; 只有集选控制的外呼可以改派, 目的层派梯已把结果告知乘客
+    std::uint64_t GetCallVersion() const { return call_version; }
+    void BuildAssignmentProblem(AssignmentProblem& problem) const;
+    int ApplyAssignmentPlan(const AssignmentPlan& plan); // 版本不符时不改派, 返回改派的外呼数
+
+    // 检查点: 楼层按钮、乘客、派梯计划及各电梯的状态
+    void SaveState(CheckpointWriter& writer) const;
+    bool LoadState(CheckpointReader& reader, std::vector<PendingTimer>& pending);
+
+    void AddObserver(GroupObserver* observer);
+    void RemoveObserver(GroupObserver* observer);
+
+    // CarObserver
+    void OnCarStateChanged(const ElevatorCar& car) override;
+    void OnCarFloorChanged(const ElevatorCar& car) override;
+    void OnCarArrived(const ElevatorCar& car, int floor, ElevatorState state) override;
+    void OnCarAlarm(const ElevatorCar& car) override;
+    void OnCarBypassed(const ElevatorCar& car, int floor) override;
+    void OnCarPlanChanged(const ElevatorCar& car) override;
+private:
+    ElevatorCar* ChooseCar(int floor, Direction dir, int destination);
+    void RescueCalls(ElevatorCar& car, TimerService::Time fault_since); // 改派故障电梯上登记的全部外呼
+    ElevatorCar* ReassignCall(ElevatorCar& car, int floor, Direction dir); // 把car在本层的外呼改派给能接手的电梯, 没有时返回nullptr
+    ElevatorCar* ReassignCollectiveCall(ElevatorCar& car, int floor, Direction dir);
+    ElevatorCar* ReassignDestinationCall(ElevatorCar& car, int floor, Direction dir);
+    bool HasHallCalls() const; // 是否有电梯登记了外呼
+    TimerService::Time CallSince(int floor, Direction dir, TimerService::Time fault_since) const;
+    void ScheduleWatchdog(TimerService::Time due); // 在due之前没有待执行的检查时安排一次
+    void CheckStalls();
+    int FindTransferFloor(int origin, int destination) const; // 没有电梯直达时的换乘层, 无法到达返回-1
+    bool StartLeg(Passenger& passenger);   // 乘客在origin层开始(下一程)候梯, 没有电梯可派时返回false
+    void LightHallButton(int floor, Direction dir);
+    bool IsCallCovered(int floor, Direction dir, int destination) const; // 已有能到达destination的电梯要来本层
+    ElevatorCar* ChooseCarForDestination(int origin, int destination);
+    bool PlansStopAt(const ElevatorCar& car, int floor) const;
+    void BoardPassenger(ElevatorCar& car, Passenger& passenger);
+    void RecallLeftBehind(const ElevatorCar& car, int floor); // 满载留下的乘客重新呼梯
+    void NotifyHallCallChanged(int floor, Direction dir, bool active);
+    void NotifyCallAssigned(const ElevatorCar& car, int floor, Direction dir);
+    void RecordDecision(std::chrono::steady_clock::time_point start); // 计入调度统计并通知观察者
+    void SyncFleet(const ElevatorCar& car); // 电梯或其健康状态变化后更新派梯热数据
+    void QueueBatchedCall(int floor, Direction dir, int destination);
+    void ScheduleBatch(TimerService::Time due);
+    void SolveBatch(); // 批量派梯窗口结束
+
+private:
+    int floor_count;
+    TimerService& timers;
+    std::vector<std::unique_ptr<ElevatorCar>> cars;  // 电梯对象数组
+    FleetState fleet;                                // 派梯用的电梯状态(结构数组), 与cars同步
+    std::vector<long long> costs;                    // 每次派梯的各电梯代价
+    std::vector<FloorButtonState> floorButtonStates; // 楼层按钮状态数组
+    std::vector<std::vector<Passenger>> waiting;     // 各楼层候梯乘客
+    std::vector<std::vector<Passenger>> riders;      // 各电梯内乘客
+    std::vector<std::vector<int>> planned_destinations; // 各电梯已分配但尚未上梯的乘客, 按目的层计数
+    std::vector<int> transfer_floors;                // 分区时的换乘层
+    bool zoned = false;                              // 是否有电梯不服务全部楼层
+    std::uint64_t call_version = 0;
+    DispatchMode dispatch_mode = DispatchMode::Collective;
+    std::uint64_t next_passenger_id = 0;
+    DispatchStats dispatch_stats;
+    std::vector<CarHealth> health;                   // 各电梯的健康状态
+    int stall_timeout_ms = 30000;
+    TimerService::TimerId watchdog_timer = TimerService::InvalidTimer; // 只在有外呼时运行
+    TimerService::Time watchdog_due = 0;
+    int batch_window_ms = 0;
+    std::vector<BatchedCall> batch;                  // 当前窗口内的外呼, 按到达顺序
+    TimerService::TimerId batch_timer = TimerService::InvalidTimer;
+    TimerService::Time batch_due = 0;
+    std::vector<GroupObserver*> observers;
+};
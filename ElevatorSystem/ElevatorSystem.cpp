@@ -3,6 +3,8 @@
 #include <qmessagebox.h>
 #include <qlabel.h>
 #include <qlineedit.h>
+#include <qcheckbox.h>
+#include <qcombobox.h>
 ElevatorSystem::ElevatorSystem(QWidget *parent)
     : QMainWindow(parent), elevator_count(5), floor_count(20)
 {
@@ -31,12 +33,24 @@ void ElevatorSystem::InitWidget() {
 	f_edit->setAlignment(Qt::AlignCenter);
 	f_edit->setGeometry(300, 150, 100, 50);
 
+	QCheckBox* dd_check = new QCheckBox("目的层派梯 destination dispatch", this);
+	dd_check->setChecked(this->destination_dispatch);
+	dd_check->setGeometry(80, 205, 320, 30);
+
+	QLabel* z_label = new QLabel("分区 zoning: ", this);
+	z_label->setGeometry(80, 240, 200, 30);
+	QComboBox* zone_box = new QComboBox(this);
+	zone_box->addItem("不分区", static_cast<int>(ZoningMode::None));
+	zone_box->addItem("高低区分组", static_cast<int>(ZoningMode::Banks));
+	zone_box->addItem("空中大堂", static_cast<int>(ZoningMode::SkyLobby));
+	zone_box->setGeometry(300, 240, 100, 30);
+
 	//创建按钮
 	QPushButton* start_button = new QPushButton("开始模拟", this);
-	start_button->setGeometry(120, 280, 100, 40);
+	start_button->setGeometry(120, 290, 100, 40);
 
 	QPushButton* reset_button = new QPushButton("重置参数", this);
-	reset_button->setGeometry(260, 280, 100, 40);
+	reset_button->setGeometry(260, 290, 100, 40);
 
 	//连接信号和槽
 	connect(start_button, &QPushButton::clicked, this, [=]() {
@@ -46,6 +60,8 @@ void ElevatorSystem::InitWidget() {
 			if (ok1 && ok2) {
 				this->elevator_count = elevator_count;
 				this->floor_count = floor_count;
+				this->destination_dispatch = dd_check->isChecked();
+				this->zoning = static_cast<ZoningMode>(zone_box->currentData().toInt());
 				BeginSimulation();
 			}
 			else {
@@ -53,6 +69,8 @@ void ElevatorSystem::InitWidget() {
 				ResetParams();
 				e_edit->setText(QString::number(this->elevator_count));
 				f_edit->setText(QString::number(this->floor_count));
+				dd_check->setChecked(this->destination_dispatch);
+				zone_box->setCurrentIndex(0);
 			}
 		}
 	);
@@ -61,6 +79,8 @@ void ElevatorSystem::InitWidget() {
 			ResetParams();
 			e_edit->setText(QString::number(this->elevator_count));
 			f_edit->setText(QString::number(this->floor_count));
+			dd_check->setChecked(this->destination_dispatch);
+			zone_box->setCurrentIndex(0);
 		}
 	);
 }
@@ -3,6 +3,7 @@
 #include <QtWidgets/QMainWindow>
 #include "ui_ElevatorSystem.h"
 #include <qpushbutton.h>
+#include "Zoning.h"
 
 
 class ElevatorSystem : public QMainWindow
@@ -15,12 +16,17 @@ public:
 public:
 	int GetFloorCount() const { return floor_count; }
 	int GetElevatorCount() const { return elevator_count; }
+	bool IsDestinationDispatch() const { return destination_dispatch; }
+	ZoningMode GetZoning() const { return zoning; }
+	static const int BankCount = 3; // 分组分区时的组数
 private:
 	void BeginSimulation(); // 开始模拟
 	void InitWidget(); // 初始化
 	void ResetParams() {
 		elevator_count = 5;
 		floor_count = 20;
+		destination_dispatch = false;
+		zoning = ZoningMode::None;
 	}
 public slots:
 	void HandleSimulationClosed() {
@@ -31,4 +37,6 @@ private:
     Ui::ElevatorSystemClass ui;
 	int elevator_count; // 电梯数量
 	int floor_count; // 楼层数量
+	bool destination_dispatch = false; // 目的层派梯模式
+	ZoningMode zoning = ZoningMode::None; // 分区方式
 };
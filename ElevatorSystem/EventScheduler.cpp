@@ -0,0 +1,83 @@
+﻿#include "EventScheduler.h"
+
+TimerService::TimerId EventScheduler::Schedule(int delay_ms, std::function<void()> callback)
+{
+    return ScheduleAt(now + (delay_ms > 0 ? delay_ms : 0), std::move(callback));
+}
+
+TimerService::TimerId EventScheduler::ScheduleAt(Time time, std::function<void()> callback)
+{
+    TimerId id = ++next_id;
+    queue.push(Event{ time < now ? now : time, id });
+    callbacks.emplace(id, std::move(callback));
+    return id;
+}
+
+void EventScheduler::Cancel(TimerId id)
+{
+    // 队列中的条目在出队时丢弃
+    callbacks.erase(id);
+}
+
+void EventScheduler::DiscardCancelled()
+{
+    while (!queue.empty() && callbacks.find(queue.top().id) == callbacks.end())
+        queue.pop();
+}
+
+TimerService::Time EventScheduler::NextEventTime()
+{
+    DiscardCancelled();
+    return queue.empty() ? -1 : queue.top().time;
+}
+
+bool EventScheduler::Step()
+{
+    DiscardCancelled();
+    if (queue.empty()) return false;
+    Event event = queue.top();
+    queue.pop();
+    auto it = callbacks.find(event.id);
+    std::function<void()> callback = std::move(it->second);
+    callbacks.erase(it);
+    now = event.time;
+    ++executed;
+    callback();
+    return true;
+}
+
+size_t EventScheduler::RunUntil(Time time)
+{
+    size_t count = 0;
+    for (;;) {
+        DiscardCancelled();
+        if (queue.empty() || queue.top().time > time) break;
+        Step();
+        ++count;
+    }
+    if (time > now) now = time;
+    return count;
+}
+
+size_t EventScheduler::RunAll()
+{
+    size_t count = 0;
+    while (Step())
+        ++count;
+    return count;
+}
+
+void EventScheduler::Reset()
+{
+    queue = decltype(queue)();
+    callbacks.clear();
+    now = 0;
+    executed = 0;
+}
+
+void EventScheduler::Restore(Time time, std::uint64_t executed_count)
+{
+    Reset();
+    now = time;
+    executed = executed_count;
+}
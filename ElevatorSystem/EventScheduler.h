@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "TimerService.h"
+
+// 离散事件调度器: 按时间戳顺序执行事件, 时钟为虚拟时间(毫秒)
+// 批量模拟时直接RunAll()/RunUntil()快进, 界面模式下按真实时间逐帧推进
+class EventScheduler : public TimerService
+{
+public:
+    EventScheduler() {}
+    EventScheduler(const EventScheduler&) = delete;
+    EventScheduler& operator=(const EventScheduler&) = delete;
+public:
+    TimerId Schedule(int delay_ms, std::function<void()> callback) override;
+    TimerId ScheduleAt(Time time, std::function<void()> callback); // 在绝对时间执行
+    void Cancel(TimerId id) override;
+    Time Now() const override { return now; }
+
+    bool Empty() const { return callbacks.empty(); }
+    size_t PendingCount() const { return callbacks.size(); }
+    Time NextEventTime(); // 没有事件时返回-1
+    std::uint64_t ExecutedCount() const { return executed; }
+
+    bool Step();               // 执行下一个事件, 没有事件返回false
+    size_t RunUntil(Time time); // 执行所有不晚于time的事件, 并把时钟推进到time
+    size_t RunAll();           // 执行到事件队列为空
+    void Reset();
+    void Restore(Time time, std::uint64_t executed_count); // 清空事件, 时钟和计数恢复为检查点中的值
+
+private:
+    struct Event {
+        Time time;
+        TimerId id; // id递增, 同一时刻按加入顺序执行
+        bool operator>(const Event& other) const {
+            return time != other.time ? time > other.time : id > other.id;
+        }
+    };
+    void DiscardCancelled();
+
+private:
+    Time now = 0;
+    TimerId next_id = InvalidTimer;
+    std::uint64_t executed = 0;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+    std::unordered_map<TimerId, std::function<void()>> callbacks; // 未执行且未取消的事件
+};
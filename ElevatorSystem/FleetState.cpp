@@ -0,0 +1,201 @@
+﻿#include "FleetState.h"
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FLEET_SIMD_LANES 8
+#elif defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define FLEET_SIMD_LANES 4
+#else
+#define FLEET_SIMD_LANES 1
+#endif
+
+namespace {
+    const int SimdLanes = FLEET_SIMD_LANES;
+    // 批量计算时开关门/报警剩余时间的上限(约74小时), 保证代价不超出32位整数
+    const int BusyCap = 1 << 28;
+
+#if FLEET_SIMD_LANES > 1
+    // 32位整数向量的基本运算, AVX2与SSE4.1各一套, 代价计算只写一遍
+#if FLEET_SIMD_LANES == 8
+    typedef __m256i Vec;
+    inline Vec Load(const std::int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    inline void Store(std::int32_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    inline Vec Splat(int x) { return _mm256_set1_epi32(x); }
+    inline Vec Add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+    inline Vec Sub(Vec a, Vec b) { return _mm256_sub_epi32(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm256_mullo_epi32(a, b); }
+    inline Vec Min(Vec a, Vec b) { return _mm256_min_epi32(a, b); }
+    inline Vec Max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+    inline Vec Abs(Vec a) { return _mm256_abs_epi32(a); }
+    inline Vec Eq(Vec a, Vec b) { return _mm256_cmpeq_epi32(a, b); }
+    inline Vec Gt(Vec a, Vec b) { return _mm256_cmpgt_epi32(a, b); }
+    inline Vec Or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    inline Vec Select(Vec mask, Vec a, Vec b) { return _mm256_blendv_epi8(b, a, mask); } // mask ? a : b
+    inline Vec Div(Vec a, Vec b) { // 截断除法; 被除数小于2^20时单精度结果精确
+        return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(a), _mm256_cvtepi32_ps(b)));
+    }
+#else
+    typedef __m128i Vec;
+    inline Vec Load(const std::int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    inline void Store(std::int32_t* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    inline Vec Splat(int x) { return _mm_set1_epi32(x); }
+    inline Vec Add(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+    inline Vec Sub(Vec a, Vec b) { return _mm_sub_epi32(a, b); }
+    inline Vec Mul(Vec a, Vec b) { return _mm_mullo_epi32(a, b); }
+    inline Vec Min(Vec a, Vec b) { return _mm_min_epi32(a, b); }
+    inline Vec Max(Vec a, Vec b) { return _mm_max_epi32(a, b); }
+    inline Vec Abs(Vec a) { return _mm_abs_epi32(a); }
+    inline Vec Eq(Vec a, Vec b) { return _mm_cmpeq_epi32(a, b); }
+    inline Vec Gt(Vec a, Vec b) { return _mm_cmpgt_epi32(a, b); }
+    inline Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+    inline Vec Select(Vec mask, Vec a, Vec b) { return _mm_blendv_epi8(b, a, mask); }
+    inline Vec Div(Vec a, Vec b) {
+        return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(a), _mm_cvtepi32_ps(b)));
+    }
+#endif
+
+    // Dispatcher中StopsBefore的向量版本
+    inline Vec StopsBefore(Vec count, Vec pos, Vec extreme, Vec reach)
+    {
+        const Vec zero = Splat(0);
+        Vec span = Abs(Sub(extreme, pos));
+        Vec stops = Div(Mul(count, reach), Max(span, Splat(1)));
+        stops = Select(Eq(span, reach), Sub(count, Splat(1)), stops);
+        stops = Select(Gt(reach, span), count, stops);
+        return Select(Gt(count, zero), stops, zero);
+    }
+#endif
+}
+
+void FleetState::Reset(int car_count, int floor_count, const CarTiming& car_timing, std::shared_ptr<const MotionTable> table)
+{
+    count = car_count;
+    padded = (car_count + SimdLanes - 1) / SimdLanes * SimdLanes;
+    word_count = (floor_count + 63) / 64;
+    timing = car_timing;
+    motion = table;
+    // 单精度除法要求停靠数与楼层差之积小于2^20; 其余各项之和不超过2^30
+    const long long per_floor = static_cast<long long>(timing.move_ms) + Dispatcher::DwellTime(timing);
+    vectorized = SimdLanes > 1 && !motion->IsKinematic() && floor_count <= 1024 &&
+        timing.move_ms >= 0 && Dispatcher::DwellTime(timing) >= 0 && (2LL * floor_count + 1) * per_floor < (1LL << 30);
+
+    floor.assign(padded, 0);
+    heading.assign(padded, 0);
+    state.assign(padded, static_cast<std::int32_t>(ElevatorState::Idle));
+    stop_count.assign(padded, 0);
+    stops_above.assign(padded, 0);
+    stops_below.assign(padded, 0);
+    upper.assign(padded, -1);
+    lower.assign(padded, -1);
+    busy_due.assign(padded, 0);
+    busy_tail.assign(padded, 0);
+    takes_calls.assign(padded, 0);
+    stop_words.assign(static_cast<size_t>(padded) * word_count, 0);
+    served_words.assign(static_cast<size_t>(padded) * word_count, 0);
+    busy.assign(padded, 0);
+    stopping.assign(padded, 0);
+    lane_costs.assign(padded, 0);
+}
+
+void FleetState::Update(int index, const ElevatorCar& car, bool can_take_calls)
+{
+    const RouteSummary& route = car.GetRouteSummary();
+    floor[index] = car.GetCurrentFloor();
+    state[index] = static_cast<std::int32_t>(car.GetState());
+    if (car.GetState() == ElevatorState::Idle || car.GetDirection() == Direction::None)
+        heading[index] = 0;
+    else
+        heading[index] = car.GetDirection() == Direction::Up ? 1 : -1;
+    stop_count[index] = route.stop_count;
+    stops_above[index] = route.stops_above;
+    stops_below[index] = route.stops_below;
+    upper[index] = route.upper;
+    lower[index] = route.lower;
+    int tail = 0;
+    car.GetBusySchedule(busy_due[index], tail);
+    busy_tail[index] = tail;
+    takes_calls[index] = can_take_calls ? 1 : 0;
+    const size_t base = static_cast<size_t>(index) * word_count;
+    for (int w = 0; w < word_count; ++w) {
+        stop_words[base + w] = car.GetStopMask().Word(w);
+        served_words[base + w] = car.GetServedFloors().Word(w);
+    }
+}
+
+int FleetState::BusyTime(int index, TimerService::Time now) const
+{
+    return static_cast<int>(std::max<TimerService::Time>(0, busy_due[index] - now)) + busy_tail[index];
+}
+
+CarStatus FleetState::Status(int index, TimerService::Time now) const
+{
+    CarStatus status;
+    status.floor = floor[index];
+    status.direction = heading[index] > 0 ? Direction::Up : heading[index] < 0 ? Direction::Down : Direction::None;
+    status.state = static_cast<ElevatorState>(state[index]);
+    status.route.stop_count = stop_count[index];
+    status.route.stops_above = stops_above[index];
+    status.route.stops_below = stops_below[index];
+    status.route.upper = upper[index];
+    status.route.lower = lower[index];
+    status.busy_ms = BusyTime(index, now);
+    return status;
+}
+
+void FleetState::AssignmentCosts(int target, TimerService::Time now, std::vector<long long>& costs)
+{
+    costs.resize(count);
+    if (!vectorized) {
+        for (int i = 0; i < count; ++i)
+            costs[i] = Dispatcher::AssignmentCost(Status(i, now), timing, *motion, target, StopsAt(i, target));
+        return;
+    }
+#if FLEET_SIMD_LANES > 1
+    // 随时间变化的剩余开关门时间和本层是否已在停靠计划中先逐部取出, 再按SIMD宽度批量计算
+    for (int i = 0; i < count; ++i) {
+        busy[i] = std::min(BusyTime(i, now), BusyCap);
+        stopping[i] = StopsAt(i, target) ? -1 : 0;
+    }
+    const Vec zero = Splat(0);
+    const Vec one = Splat(1);
+    const Vec f = Splat(target);
+    const Vec move = Splat(timing.move_ms); // 匀速模型的换向代价也是move_ms
+    const Vec dwell = Splat(Dispatcher::DwellTime(timing));
+    for (int i = 0; i < padded; i += SimdLanes) {
+        Vec pos = Load(&floor[i]);
+        Vec head = Load(&heading[i]);
+        Vec stop_total = Load(&stop_count[i]);
+        Vec above = Load(&stops_above[i]);
+        Vec below = Load(&stops_below[i]);
+        Vec top = Load(&upper[i]);
+        Vec bottom = Load(&lower[i]);
+        Vec reach = Abs(Sub(f, pos));
+
+        // 与Dispatcher::EstimateArrival相同的分支, 各分支都算出后按掩码选择
+        Vec idle = Or(Eq(head, zero), Eq(stop_total, zero));
+        Vec up = Gt(head, zero);
+        Vec behind = Select(up, Gt(pos, f), Gt(f, pos)); // 目标在运行方向的后方, 要先到最远停靠层再折返
+        Vec before_up = StopsBefore(above, pos, top, reach);
+        Vec before_down = StopsBefore(below, pos, bottom, reach);
+        Vec stops = Select(up, Select(behind, Add(above, before_down), before_up),
+            Select(behind, Add(below, before_up), before_down));
+        Vec far_up = Max(top, pos);
+        Vec far_down = Select(Gt(zero, bottom), pos, Min(bottom, pos));
+        Vec detour = Select(up, Sub(Sub(Add(far_up, far_up), pos), f), Sub(Add(pos, f), Add(far_down, far_down)));
+        Vec travel = Select(behind, detour, reach);
+        Vec reversals = Select(behind, one, zero);
+        stops = Select(idle, zero, stops);
+        travel = Select(idle, reach, travel);
+        reversals = Select(idle, zero, reversals);
+
+        // AssignmentCost: 本层不在停靠计划中时, 之后的每个停靠都要多等一次开关门
+        Vec after = Select(Load(&stopping[i]), zero, Max(zero, Sub(stop_total, stops)));
+        Vec cost = Add(Load(&busy[i]), Mul(Add(travel, reversals), move));
+        cost = Add(cost, Mul(Add(stops, after), dwell));
+        Store(&lane_costs[i], cost);
+    }
+    for (int i = 0; i < count; ++i)
+        costs[i] = lane_costs[i];
+#endif
+}
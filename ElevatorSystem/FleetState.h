@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Dispatcher.h"
+#include "TimerService.h"
+
+// 电梯组的派梯热数据: 每个字段一段连续数组(结构数组), 下标为电梯下标
+// 由ElevatorGroup在电梯状态、位置和停靠计划变化时逐部更新, 派梯时只扫描这些数组, 不再访问电梯对象
+// 匀速模型下一次外呼对所有电梯的代价按SIMD批量计算(AVX2每次8部, SSE4.1每次4部), 其余情况逐部调用Dispatcher
+class FleetState
+{
+public:
+    void Reset(int car_count, int floor_count, const CarTiming& timing, std::shared_ptr<const MotionTable> motion);
+    void Update(int index, const ElevatorCar& car, bool takes_calls); // takes_calls: 可用且未满载, 由电梯组判断
+public:
+    int GetCount() const { return count; }
+    bool Serves(int index, int floor) const { return TestBit(served_words, index, floor); }
+    bool StopsAt(int index, int floor) const { return TestBit(stop_words, index, floor); }
+    bool TakesCalls(int index) const { return takes_calls[index] != 0; }
+    CarStatus Status(int index, TimerService::Time now) const; // 与Dispatcher::Status(car)相同
+    // 把floor的外呼派给各部电梯的代价, 与逐部调用Dispatcher::AssignmentCost的结果相同; costs按电梯下标
+    void AssignmentCosts(int floor, TimerService::Time now, std::vector<long long>& costs);
+private:
+    bool TestBit(const std::vector<std::uint64_t>& words, int index, int floor) const {
+        return (words[static_cast<size_t>(index) * word_count + (floor >> 6)] >> (floor & 63)) & 1;
+    }
+    int BusyTime(int index, TimerService::Time now) const;
+
+private:
+    int count = 0;
+    int padded = 0;     // 补齐到SIMD宽度的倍数, 多出的电梯没有停靠, 结果丢弃
+    int word_count = 0; // 每部电梯的楼层位图字数
+    CarTiming timing;   // 同组电梯型号相同
+    std::shared_ptr<const MotionTable> motion;
+    bool vectorized = false; // 匀速模型且代价不会超出32位整数时批量计算
+
+    std::vector<std::int32_t> floor;
+    std::vector<std::int32_t> heading;  // 1上行, -1下行, 0空闲(与Status一致, 空闲时不看方向)
+    std::vector<std::int32_t> state;
+    std::vector<std::int32_t> stop_count;
+    std::vector<std::int32_t> stops_above;
+    std::vector<std::int32_t> stops_below;
+    std::vector<std::int32_t> upper;
+    std::vector<std::int32_t> lower;
+    std::vector<TimerService::Time> busy_due; // 开关门/报警当前阶段结束的时刻, 见ElevatorCar::GetBusySchedule
+    std::vector<std::int32_t> busy_tail;
+    std::vector<std::uint8_t> takes_calls;
+    std::vector<std::uint64_t> stop_words;   // count * word_count
+    std::vector<std::uint64_t> served_words;
+
+    // 每次派梯的临时数组
+    std::vector<std::int32_t> busy;
+    std::vector<std::int32_t> stopping;
+    std::vector<std::int32_t> lane_costs;
+};
@@ -0,0 +1,232 @@
+﻿#include "FlightRecorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    const char FileMagic[4] = { 'E', 'L', 'F', 'R' };
+    const std::uint32_t FileVersion = 1;
+
+    static_assert(sizeof(FlightEvent) == 16, "FlightEvent的文件布局为16字节");
+
+    // 除时间外的字段打包进一个字: 楼层(32位) | 类型 | 状态 | 方向
+    std::uint64_t Pack(const FlightEvent& event)
+    {
+        return static_cast<std::uint32_t>(event.floor)
+            | static_cast<std::uint64_t>(event.type) << 32
+            | static_cast<std::uint64_t>(event.state) << 40
+            | static_cast<std::uint64_t>(event.direction) << 48;
+    }
+
+    FlightEvent Unpack(std::uint64_t time, std::uint64_t word)
+    {
+        FlightEvent event;
+        event.time = static_cast<std::int64_t>(time);
+        event.floor = static_cast<std::int32_t>(static_cast<std::uint32_t>(word));
+        event.type = static_cast<FlightEventType>((word >> 32) & 0xff);
+        event.state = static_cast<std::uint8_t>(word >> 40);
+        event.direction = static_cast<std::uint8_t>(word >> 48);
+        return event;
+    }
+
+    std::uint64_t RoundUpPow2(int value)
+    {
+        std::uint64_t result = 1;
+        while (result < static_cast<std::uint64_t>(value)) result <<= 1;
+        return result;
+    }
+
+    const char* StateName(ElevatorState state)
+    {
+        switch (state) {
+        case ElevatorState::Idle: return "空闲";
+        case ElevatorState::Up: return "上行";
+        case ElevatorState::Down: return "下行";
+        case ElevatorState::Opening: return "开门中";
+        case ElevatorState::Open: return "已开门";
+        case ElevatorState::Closing: return "关门中";
+        case ElevatorState::Warning: return "报警中";
+        }
+        return "?";
+    }
+
+    const char* DirectionName(Direction dir)
+    {
+        return dir == Direction::Up ? "上" : dir == Direction::Down ? "下" : "-";
+    }
+
+    bool IsDoorState(ElevatorState state)
+    {
+        return state == ElevatorState::Opening || state == ElevatorState::Open || state == ElevatorState::Closing;
+    }
+}
+
+const char* FlightEvent::TypeName() const
+{
+    switch (type) {
+    case FlightEventType::StateChange: return "状态";
+    case FlightEventType::FloorPass: return "到达";
+    case FlightEventType::Stop: return "停靠";
+    case FlightEventType::DoorPhase: return "门";
+    case FlightEventType::CallAssigned: return "派梯";
+    case FlightEventType::Alarm: return "报警";
+    }
+    return "?";
+}
+
+std::string FlightEvent::Describe() const
+{
+    char text[96];
+    if (type == FlightEventType::CallAssigned)
+        std::snprintf(text, sizeof(text), "%s %d层 %s行", TypeName(), floor + 1, DirectionName(GetDirection()));
+    else
+        std::snprintf(text, sizeof(text), "%s %d层 %s %s", TypeName(), floor + 1, StateName(GetState()), DirectionName(GetDirection()));
+    return text;
+}
+
+FlightRecorder::FlightRecorder(int elevator_count, const TimerService& timers, int capacity_per_car)
+    : timers(timers), capacity(RoundUpPow2(capacity_per_car < 2 ? 2 : capacity_per_car))
+{
+    for (int i = 0; i < elevator_count; ++i) {
+        std::unique_ptr<Ring> ring(new Ring());
+        ring->words.reset(new std::atomic<std::uint64_t>[capacity * 2]);
+        for (std::uint64_t w = 0; w < capacity * 2; ++w)
+            ring->words[w].store(0, std::memory_order_relaxed);
+        rings.push_back(std::move(ring));
+    }
+}
+
+void FlightRecorder::Attach(ElevatorGroup& group)
+{
+    group.AddObserver(this);
+    for (int i = 0; i < group.GetElevatorCount(); ++i)
+        group.GetCar(i).AddObserver(this);
+}
+
+void FlightRecorder::Detach(ElevatorGroup& group)
+{
+    for (int i = 0; i < group.GetElevatorCount(); ++i)
+        group.GetCar(i).RemoveObserver(this);
+    group.RemoveObserver(this);
+}
+
+void FlightRecorder::Record(int elevator_id, FlightEventType type, int floor, ElevatorState state, Direction direction)
+{
+    if (elevator_id < 1 || elevator_id > static_cast<int>(rings.size())) return;
+    Ring& ring = *rings[elevator_id - 1];
+    FlightEvent event;
+    event.floor = floor;
+    event.type = type;
+    event.state = static_cast<std::uint8_t>(state);
+    event.direction = static_cast<std::uint8_t>(direction);
+    // 只有一个写线程, head可以先读后写
+    // 释放栅栏保证: 读线程一旦读到本条写入的数据, 也一定能看到之前对head的更新, 从而发现该槽位已被覆盖
+    std::uint64_t seq = ring.head.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::uint64_t slot = (seq & (capacity - 1)) * 2;
+    ring.words[slot].store(static_cast<std::uint64_t>(timers.Now()), std::memory_order_relaxed);
+    ring.words[slot + 1].store(Pack(event), std::memory_order_relaxed);
+    ring.head.store(seq + 1, std::memory_order_release);
+}
+
+std::vector<FlightTrack> FlightRecorder::Snapshot() const
+{
+    std::vector<FlightTrack> tracks(rings.size());
+    for (size_t i = 0; i < rings.size(); ++i) {
+        const Ring& ring = *rings[i];
+        FlightTrack& track = tracks[i];
+        track.elevator_id = static_cast<int>(i) + 1;
+        std::uint64_t end = ring.head.load(std::memory_order_acquire);
+        std::uint64_t begin = end + 1 > capacity ? end + 1 - capacity : 0;
+        track.events.reserve(static_cast<size_t>(end - begin));
+        for (std::uint64_t seq = begin; seq < end; ++seq) {
+            std::uint64_t slot = (seq & (capacity - 1)) * 2;
+            track.events.push_back(Unpack(ring.words[slot].load(std::memory_order_relaxed),
+                ring.words[slot + 1].load(std::memory_order_relaxed)));
+        }
+        // 复制期间写线程可能已经覆盖了最旧的几条, 丢弃它们;
+        // 第after条可能正在写入, 它占用的槽位也视为已失效
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::uint64_t after = ring.head.load(std::memory_order_relaxed);
+        std::uint64_t valid_begin = after + 1 > capacity ? after + 1 - capacity : 0;
+        if (valid_begin > begin) {
+            size_t drop = static_cast<size_t>(std::min(valid_begin - begin, end - begin));
+            track.events.erase(track.events.begin(), track.events.begin() + drop);
+        }
+    }
+    return tracks;
+}
+
+// 文件格式: "ELFR" | 版本 | 电梯数, 之后每部电梯: 编号 | 记录数 | 记录(每条16字节)
+bool FlightRecorder::DumpToFile(const std::string& path) const
+{
+    std::vector<FlightTrack> tracks = Snapshot();
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::uint32_t header[2] = { FileVersion, static_cast<std::uint32_t>(tracks.size()) };
+    bool ok = std::fwrite(FileMagic, 1, sizeof(FileMagic), file) == sizeof(FileMagic)
+        && std::fwrite(header, sizeof(header), 1, file) == 1;
+    for (size_t i = 0; ok && i < tracks.size(); ++i) {
+        std::uint32_t track_header[2] = { static_cast<std::uint32_t>(tracks[i].elevator_id),
+            static_cast<std::uint32_t>(tracks[i].events.size()) };
+        ok = std::fwrite(track_header, sizeof(track_header), 1, file) == 1;
+        if (ok && !tracks[i].events.empty())
+            ok = std::fwrite(tracks[i].events.data(), sizeof(FlightEvent), tracks[i].events.size(), file) == tracks[i].events.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+bool FlightRecorder::ReadFile(const std::string& path, std::vector<FlightTrack>& tracks)
+{
+    tracks.clear();
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    char magic[4];
+    std::uint32_t header[2];
+    bool ok = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+        && std::memcmp(magic, FileMagic, sizeof(magic)) == 0
+        && std::fread(header, sizeof(header), 1, file) == 1
+        && header[0] == FileVersion;
+    for (std::uint32_t i = 0; ok && i < header[1]; ++i) {
+        std::uint32_t track_header[2];
+        ok = std::fread(track_header, sizeof(track_header), 1, file) == 1;
+        if (!ok) break;
+        FlightTrack track;
+        track.elevator_id = static_cast<int>(track_header[0]);
+        track.events.resize(track_header[1]);
+        if (!track.events.empty())
+            ok = std::fread(track.events.data(), sizeof(FlightEvent), track.events.size(), file) == track.events.size();
+        tracks.push_back(std::move(track));
+    }
+    std::fclose(file);
+    return ok;
+}
+
+void FlightRecorder::OnCarStateChanged(const ElevatorCar& car)
+{
+    ElevatorState state = car.GetState();
+    FlightEventType type = IsDoorState(state) ? FlightEventType::DoorPhase : FlightEventType::StateChange;
+    Record(car.GetElevatorID(), type, car.GetCurrentFloor(), state, car.GetDirection());
+}
+
+void FlightRecorder::OnCarFloorChanged(const ElevatorCar& car)
+{
+    Record(car.GetElevatorID(), FlightEventType::FloorPass, car.GetCurrentFloor(), car.GetState(), car.GetDirection());
+}
+
+void FlightRecorder::OnCarArrived(const ElevatorCar& car, int floor, ElevatorState state)
+{
+    Record(car.GetElevatorID(), FlightEventType::Stop, floor, state, car.GetDirection());
+}
+
+void FlightRecorder::OnCarAlarm(const ElevatorCar& car)
+{
+    Record(car.GetElevatorID(), FlightEventType::Alarm, car.GetCurrentFloor(), car.GetState(), car.GetDirection());
+    if (!alarm_dump_path.empty())
+        alarm_dump_ok.store(DumpToFile(alarm_dump_path), std::memory_order_release);
+}
+
+void FlightRecorder::OnCallAssigned(int elevator_id, int floor, Direction dir)
+{
+    Record(elevator_id, FlightEventType::CallAssigned, floor, ElevatorState::Idle, dir);
+}
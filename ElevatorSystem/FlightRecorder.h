@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ElevatorGroup.h"
+#include "TimerService.h"
+
+// 飞行记录事件类型
+enum class FlightEventType : std::uint8_t {
+    StateChange,  // 状态/方向变化(空闲、上行、下行)
+    FloorPass,    // 到达新楼层(经过或即将停靠)
+    Stop,         // 在某层停靠
+    DoorPhase,    // 开门中/已开门/关门中
+    CallAssigned, // 外部请求分配给本电梯
+    Alarm
+};
+
+// 一条记录16字节, 文件中按此布局直接存储(小端)
+struct FlightEvent {
+    std::int64_t time = 0;   // 虚拟时间(毫秒)
+    std::int32_t floor = 0;
+    FlightEventType type = FlightEventType::StateChange;
+    std::uint8_t state = 0;     // ElevatorState
+    std::uint8_t direction = 0; // Direction, CallAssigned时为请求方向
+    std::uint8_t reserved = 0;
+
+    ElevatorState GetState() const { return static_cast<ElevatorState>(state); }
+    Direction GetDirection() const { return static_cast<Direction>(direction); }
+    const char* TypeName() const;
+    std::string Describe() const; // 如"停靠 5层 开门中"
+};
+
+// 从文件读出的单部电梯记录, 按时间顺序
+struct FlightTrack {
+    int elevator_id = 0;
+    std::vector<FlightEvent> events;
+};
+
+// 飞行记录仪: 每部电梯一个固定容量的环形缓冲, 写满后覆盖最旧的记录
+// 记录只在模拟线程上发生, 每条记录是两次relaxed写和一次release写, 不加锁、不分配内存、不格式化
+// 导出可以在任意线程进行: 先复制再检查写指针, 复制过程中被覆盖的记录会被丢弃
+class FlightRecorder : public CarObserver, public GroupObserver
+{
+public:
+    FlightRecorder(int elevator_count, const TimerService& timers, int capacity_per_car = 4096);
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+public:
+    void Attach(ElevatorGroup& group);  // 观察电梯组及其所有电梯
+    void Detach(ElevatorGroup& group);
+    void Record(int elevator_id, FlightEventType type, int floor, ElevatorState state, Direction direction);
+    // 报警时在模拟线程上立即导出, 空为不导出; 在开始记录前设置
+    void SetAlarmDumpPath(const std::string& path) { alarm_dump_path = path; }
+    const std::string& GetAlarmDumpPath() const { return alarm_dump_path; }
+    bool LastAlarmDumpSucceeded() const { return alarm_dump_ok.load(std::memory_order_acquire); } // 任意线程调用
+
+    std::vector<FlightTrack> Snapshot() const; // 任意线程调用
+    bool DumpToFile(const std::string& path) const;
+    static bool ReadFile(const std::string& path, std::vector<FlightTrack>& tracks);
+
+    // CarObserver
+    void OnCarStateChanged(const ElevatorCar& car) override;
+    void OnCarFloorChanged(const ElevatorCar& car) override;
+    void OnCarArrived(const ElevatorCar& car, int floor, ElevatorState state) override;
+    void OnCarAlarm(const ElevatorCar& car) override;
+    // GroupObserver
+    void OnCallAssigned(int elevator_id, int floor, Direction dir) override;
+
+private:
+    struct Ring {
+        std::unique_ptr<std::atomic<std::uint64_t>[]> words; // 每条记录两个字: 时间, 打包的其余字段
+        alignas(64) std::atomic<std::uint64_t> head{ 0 };   // 已写入的记录总数
+    };
+    std::vector<std::unique_ptr<Ring>> rings;
+    const TimerService& timers;
+    const std::uint64_t capacity; // 2的幂
+    std::string alarm_dump_path;
+    std::atomic<bool> alarm_dump_ok{ false }; // 最近一次报警导出的结果
+};
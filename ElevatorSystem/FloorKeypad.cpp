@@ -0,0 +1,98 @@
+﻿#include "FloorKeypad.h"
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <algorithm>
+
+FloorKeypad::FloorKeypad(int floor_count, QWidget* parent)
+    : QWidget(parent), floor_count(floor_count), active(floor_count), served(floor_count)
+{
+    for (int floor = 0; floor < floor_count; ++floor)
+        served.Set(floor);
+    setMinimumSize(5 * (MinKeySize + Spacing), 2 * (MinKeySize + Spacing));
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+void FloorKeypad::SetActiveFloors(const FloorMask& targets)
+{
+    if (targets == active) return;
+    for (int w = 0; w < targets.WordCount() && w < active.WordCount(); ++w) {
+        std::uint64_t diff = targets.Word(w) ^ active.Word(w);
+        for (int bit = 0; diff; ++bit, diff >>= 1)
+            if (diff & 1) update(KeyRect(w * 64 + bit));
+    }
+    active = targets;
+}
+
+void FloorKeypad::SetServedFloors(const FloorMask& floors)
+{
+    if (floors == served || floors.Size() != floor_count) return;
+    served = floors;
+    update();
+}
+
+void FloorKeypad::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    UpdateGeometry();
+}
+
+void FloorKeypad::UpdateGeometry()
+{
+    // 从最大边长开始缩小, 直到全部按键放得下; 至少每行5个
+    const int w = std::max(width(), 1);
+    const int h = std::max(height(), 1);
+    for (key_size = MaxKeySize; key_size > MinKeySize; --key_size) {
+        columns = std::max(5, w / (key_size + Spacing));
+        int rows = (floor_count + columns - 1) / columns;
+        if (rows * (key_size + Spacing) <= h) break;
+    }
+    columns = std::max(5, w / (key_size + Spacing));
+}
+
+QRect FloorKeypad::KeyRect(int floor) const
+{
+    int step = key_size + Spacing;
+    return QRect((floor % columns) * step, (floor / columns) * step, key_size, key_size);
+}
+
+int FloorKeypad::KeyAt(const QPoint& pos) const
+{
+    int step = key_size + Spacing;
+    if (pos.x() < 0 || pos.y() < 0) return -1;
+    int col = pos.x() / step;
+    int row = pos.y() / step;
+    if (col >= columns || pos.x() % step >= key_size || pos.y() % step >= key_size) return -1;
+    int floor = row * columns + col;
+    return floor < floor_count ? floor : -1;
+}
+
+void FloorKeypad::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(this);
+    const QRect area = event->rect();
+    const int step = key_size + Spacing;
+    int first = std::max(0, area.top() / step) * columns;
+    int last = std::min(floor_count - 1, (area.bottom() / step + 1) * columns - 1);
+
+    QFont font = painter.font();
+    font.setPixelSize(std::max(8, key_size * 2 / 5));
+    painter.setFont(font);
+    for (int floor = first; floor <= last; ++floor) {
+        QRect key = KeyRect(floor);
+        if (!key.intersects(area)) continue;
+        const bool stops = served.Test(floor);
+        painter.setPen(QColor(102, 102, 102));
+        painter.setBrush(active.Test(floor) ? QColor(Qt::red) : stops ? QColor(Qt::white) : QColor(215, 215, 215));
+        painter.drawRoundedRect(key.adjusted(0, 0, -1, -1), 5, 5);
+        painter.setPen(stops ? QColor(Qt::black) : QColor(150, 150, 150));
+        painter.drawText(key, Qt::AlignCenter, QString::number(floor + 1));
+    }
+}
+
+void FloorKeypad::mousePressEvent(QMouseEvent* event)
+{
+    int floor = KeyAt(event->position().toPoint());
+    if (floor >= 0 && served.Test(floor) && !active.Test(floor))
+        emit FloorClicked(floor);
+}
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <QWidget>
+#include "FloorMask.h"
+
+// 电梯内的楼层按键面板, 所有按键由QPainter绘制, 按键大小随楼层数缩放以放入固定区域
+class FloorKeypad : public QWidget
+{
+    Q_OBJECT
+
+public:
+    FloorKeypad(int floor_count, QWidget* parent = nullptr);
+public:
+    void SetActiveFloors(const FloorMask& targets); // 已按下的楼层显示为红色, 只重绘变化的按键
+    void SetServedFloors(const FloorMask& floors);  // 分区时不停靠的楼层显示为灰色, 点击无效
+signals:
+    void FloorClicked(int floor);
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+private:
+    void UpdateGeometry(); // 按当前尺寸计算每行按键数和按键边长
+    QRect KeyRect(int floor) const;
+    int KeyAt(const QPoint& pos) const; // 没有按键返回-1
+
+private:
+    const int floor_count;
+    FloorMask active;
+    FloorMask served;
+    int columns = 5;
+    int key_size = 40;
+    static const int MaxKeySize = 40;
+    static const int MinKeySize = 14;
+    static const int Spacing = 3;
+};
@@ -0,0 +1,116 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 楼层位图: 每层一位, 容量在构造时按楼层数确定
+// 查找上方/下方最近的楼层使用硬件位扫描指令, 代价只与字数(楼层数/64)有关
+class FloorMask
+{
+public:
+    explicit FloorMask(int floor_count = 0) { Resize(floor_count); }
+public:
+    void Resize(int floor_count) {
+        size = floor_count;
+        words.assign((floor_count + 63) / 64, 0);
+    }
+    int Size() const { return size; }
+    int WordCount() const { return static_cast<int>(words.size()); }
+    std::uint64_t Word(int index) const { return words[index]; }
+
+    bool Test(int floor) const {
+        return (words[floor >> 6] >> (floor & 63)) & 1;
+    }
+    bool Set(int floor) { // 返回是否新置位
+        std::uint64_t bit = std::uint64_t(1) << (floor & 63);
+        std::uint64_t& word = words[floor >> 6];
+        bool was_set = (word & bit) != 0;
+        word |= bit;
+        return !was_set;
+    }
+    bool Reset(int floor) { // 返回原来是否置位
+        std::uint64_t bit = std::uint64_t(1) << (floor & 63);
+        std::uint64_t& word = words[floor >> 6];
+        bool was_set = (word & bit) != 0;
+        word &= ~bit;
+        return was_set;
+    }
+    void Clear() {
+        for (auto& word : words) word = 0;
+    }
+    bool operator==(const FloorMask& other) const { return size == other.size && words == other.words; }
+    bool operator!=(const FloorMask& other) const { return !(*this == other); }
+    bool Any() const {
+        for (auto word : words)
+            if (word) return true;
+        return false;
+    }
+    int Count() const {
+        int count = 0;
+        for (auto word : words) count += PopCount(word);
+        return count;
+    }
+
+    // 严格高于floor的最低置位楼层, 没有返回-1
+    int NextAbove(int floor) const {
+        int start = floor + 1;
+        if (start < 0) start = 0;
+        if (start >= size) return -1;
+        int index = start >> 6;
+        std::uint64_t word = words[index] & (~std::uint64_t(0) << (start & 63));
+        for (;;) {
+            if (word) return (index << 6) + LowestBit(word);
+            if (++index >= static_cast<int>(words.size())) return -1;
+            word = words[index];
+        }
+    }
+    // 严格低于floor的最高置位楼层, 没有返回-1
+    int NextBelow(int floor) const {
+        int end = floor - 1;
+        if (end >= size) end = size - 1;
+        if (end < 0) return -1;
+        int index = end >> 6;
+        int shift = 63 - (end & 63);
+        std::uint64_t word = words[index] & (~std::uint64_t(0) >> shift);
+        for (;;) {
+            if (word) return (index << 6) + HighestBit(word);
+            if (--index < 0) return -1;
+            word = words[index];
+        }
+    }
+    int First() const { return NextAbove(-1); }
+    int Last() const { return NextBelow(size); }
+
+    static int LowestBit(std::uint64_t word) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+    static int HighestBit(std::uint64_t word) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, word);
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(word);
+#endif
+    }
+    static int PopCount(std::uint64_t word) {
+#if defined(_MSC_VER)
+        return static_cast<int>(__popcnt64(word));
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+
+private:
+    int size = 0;
+    std::vector<std::uint64_t> words;
+};
@@ -0,0 +1,68 @@
+﻿#include "JointAssignment.h"
+#include <cstddef>
+#include <limits>
+
+const long long JointAssignment::Forbidden = 1LL << 50;
+
+std::vector<int> JointAssignment::Solve(const std::vector<long long>& costs, int rows, int cols)
+{
+    std::vector<int> result(rows, -1);
+    if (rows <= 0 || cols <= 0) return result;
+    // 算法要求行数不多于列数, 否则转置后求解
+    const bool transposed = rows > cols;
+    const int n = transposed ? cols : rows;
+    const int m = transposed ? rows : cols;
+    auto cost = [&](int i, int j) { return transposed ? costs[static_cast<size_t>(j) * cols + i] : costs[static_cast<size_t>(i) * cols + j]; };
+
+    // 势函数u/v使约简代价非负, 每次为一行沿最短增广路扩展匹配; 下标从1开始, 0为虚拟列
+    const long long inf = std::numeric_limits<long long>::max() / 4;
+    std::vector<long long> u(n + 1, 0), v(m + 1, 0), min_to(m + 1);
+    std::vector<int> match(m + 1, 0), way(m + 1, 0);
+    std::vector<char> used(m + 1);
+    for (int i = 1; i <= n; ++i) {
+        match[0] = i;
+        int j0 = 0;
+        min_to.assign(m + 1, inf);
+        used.assign(m + 1, 0);
+        do {
+            used[j0] = 1;
+            const int i0 = match[j0];
+            long long delta = inf;
+            int j1 = 0;
+            for (int j = 1; j <= m; ++j) {
+                if (used[j]) continue;
+                long long reduced = cost(i0 - 1, j - 1) - u[i0] - v[j];
+                if (reduced < min_to[j]) {
+                    min_to[j] = reduced;
+                    way[j] = j0;
+                }
+                if (min_to[j] < delta) {
+                    delta = min_to[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= m; ++j) {
+                if (used[j]) {
+                    u[match[j]] += delta;
+                    v[j] -= delta;
+                }
+                else {
+                    min_to[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (match[j0] != 0);
+        do {
+            const int j1 = way[j0];
+            match[j0] = match[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    for (int j = 1; j <= m; ++j) {
+        if (match[j] == 0 || cost(match[j] - 1, j - 1) >= Forbidden) continue;
+        if (transposed) result[j - 1] = match[j] - 1;
+        else result[match[j] - 1] = j - 1;
+    }
+    return result;
+}
@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include <vector>
+
+// 联合派梯: 一批外呼与电梯之间的代价矩阵作为指派问题求解(匈牙利算法, 复杂度O(n²m), n ≤ m为行列数中的较小者)
+// 每个外呼最多派给一部电梯, 每部电梯最多接一个外呼; 代价为Forbidden的组合不会出现在结果中
+class JointAssignment
+{
+public:
+    static const long long Forbidden;
+    // costs按行存放(rows × cols), 返回每行分到的列, 没有分到为-1; 总代价最小, 相同时结果确定
+    static std::vector<int> Solve(const std::vector<long long>& costs, int rows, int cols);
+};
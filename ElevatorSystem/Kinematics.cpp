@@ -0,0 +1,102 @@
+﻿#include "Kinematics.h"
+#include "ElevatorCar.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // 从静止加速到speed所需的时间: 先以jerk增加加速度, 达到acceleration后匀加速, 再以jerk减小加速度
+    // 速度不足以达到最大加速度时只有加加速度的两段
+    double AccelTime(const CarTiming& timing, double speed)
+    {
+        const double a = timing.acceleration;
+        const double j = timing.jerk;
+        if (speed >= a * a / j) return speed / a + a / j;
+        return 2.0 * std::sqrt(speed / j);
+    }
+
+    // 从静止出发、一直加速到额定速度再匀速运行时, t秒后的位移
+    double Position(const CarTiming& timing, double t)
+    {
+        const double v = timing.rated_speed;
+        const double a = timing.acceleration;
+        const double j = timing.jerk;
+        const double total = AccelTime(timing, v);
+        if (t >= total) return v * total / 2.0 + v * (t - total); // 加速段对称, 平均速度为v/2
+        const double jerk_time = std::min(a / j, total / 2.0);
+        const double peak = j * jerk_time;               // 实际达到的最大加速度
+        const double v1 = peak * jerk_time / 2.0;
+        const double s1 = j * jerk_time * jerk_time * jerk_time / 6.0;
+        if (t <= jerk_time) return j * t * t * t / 6.0;
+        const double flat = total - 2.0 * jerk_time;      // 匀加速段
+        if (t <= jerk_time + flat) {
+            const double tau = t - jerk_time;
+            return s1 + v1 * tau + peak * tau * tau / 2.0;
+        }
+        const double v2 = v1 + peak * flat;
+        const double s2 = s1 + v1 * flat + peak * flat * flat / 2.0;
+        const double tau = t - jerk_time - flat;
+        return s2 + v2 * tau + peak * tau * tau / 2.0 - j * tau * tau * tau / 6.0;
+    }
+
+    int ToMs(double seconds)
+    {
+        return static_cast<int>(std::lround(seconds * 1000.0));
+    }
+}
+
+MotionTable::MotionTable(const CarTiming& timing, int floor_count)
+    : floor_count(floor_count), move_ms(timing.move_ms),
+    kinematic(timing.rated_speed > 0 && timing.acceleration > 0 && timing.jerk > 0 && timing.floor_height > 0)
+{
+    if (!kinematic) return;
+    // 时间只与距离有关, 按楼层对建表后查询不再做任何浮点计算
+    run_ms.assign(static_cast<size_t>(floor_count) * floor_count, 0);
+    pass_ms.assign(static_cast<size_t>(floor_count) * floor_count, 0);
+    for (int from = 0; from < floor_count; ++from) {
+        for (int to = from + 1; to < floor_count; ++to) {
+            double distance = FloorPosition(timing, to) - FloorPosition(timing, from);
+            run_ms[Index(from, to)] = run_ms[Index(to, from)] = ToMs(RunSeconds(timing, distance));
+            pass_ms[Index(from, to)] = pass_ms[Index(to, from)] = ToMs(PassSeconds(timing, distance));
+        }
+    }
+}
+
+double MotionTable::FloorPosition(const CarTiming& timing, int floor)
+{
+    if (floor <= 0) return 0.0;
+    double lobby = timing.lobby_height > 0 ? timing.lobby_height : timing.floor_height;
+    return lobby + (floor - 1) * timing.floor_height;
+}
+
+double MotionTable::RunSeconds(const CarTiming& timing, double distance)
+{
+    // 加速到peak再对称减速停下, 位移为peak * AccelTime(peak); 距离足够时中间以额定速度匀速运行
+    const double v = timing.rated_speed;
+    if (distance <= 0) return 0.0;
+    const double full = v * AccelTime(timing, v);
+    if (distance >= full) return distance / v + AccelTime(timing, v);
+    // 位移随peak单调增加, 二分求出实际达到的最高速度
+    double low = 0.0, high = v;
+    for (int i = 0; i < 60; ++i) {
+        double mid = (low + high) / 2.0;
+        if (mid * AccelTime(timing, mid) < distance) low = mid;
+        else high = mid;
+    }
+    return 2.0 * AccelTime(timing, high);
+}
+
+double MotionTable::PassSeconds(const CarTiming& timing, double distance)
+{
+    if (distance <= 0) return 0.0;
+    const double v = timing.rated_speed;
+    const double total = AccelTime(timing, v);
+    const double accel_distance = v * total / 2.0;
+    if (distance >= accel_distance) return total + (distance - accel_distance) / v;
+    double low = 0.0, high = total;
+    for (int i = 0; i < 60; ++i) {
+        double mid = (low + high) / 2.0;
+        if (Position(timing, mid) < distance) low = mid;
+        else high = mid;
+    }
+    return high;
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct CarTiming;
+
+// 电梯运行时间表: 启动时按运行参数算好任意两层之间的时间, 电梯运行和派梯估算都只查表
+// rated_speed为0时按move_ms匀速逐层运行, 不建表; 否则按额定速度、加速度和加加速度(jerk)的S形曲线计算
+// 表只与运行参数和楼层数有关, 建好后只读, 同型号的电梯和其他线程上的前瞻优化可以共用一张
+class MotionTable
+{
+public:
+    MotionTable(const CarTiming& timing, int floor_count);
+public:
+    bool IsKinematic() const { return kinematic; }
+    int GetFloorCount() const { return floor_count; }
+    int RunTime(int from, int to) const {   // 从from静止出发, 在to停稳
+        return kinematic ? run_ms[Index(from, to)] : Distance(from, to) * move_ms;
+    }
+    int PassTime(int from, int to) const {  // 从from静止出发, 不减速经过to
+        return kinematic ? pass_ms[Index(from, to)] : Distance(from, to) * move_ms;
+    }
+    int ReversalTime() const { return kinematic ? 0 : move_ms; } // 换向要先停稳再起步; S形曲线的停稳已计入运行时间
+
+    // 单次运行的时间(秒), distance为米
+    static double RunSeconds(const CarTiming& timing, double distance);
+    static double PassSeconds(const CarTiming& timing, double distance);
+    static double FloorPosition(const CarTiming& timing, int floor); // 距1层地面的高度(米)
+private:
+    int Index(int from, int to) const { return from * floor_count + to; }
+    static int Distance(int from, int to) { return from < to ? to - from : from - to; }
+
+private:
+    int floor_count;
+    int move_ms;
+    bool kinematic;
+    std::vector<std::int32_t> run_ms;  // floor_count * floor_count
+    std::vector<std::int32_t> pass_ms;
+};
@@ -0,0 +1,138 @@
+﻿#include "Kpi.h"
+#include "Checkpoint.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+namespace {
+    const TimerService::Time HandlingWindowMs = 5 * 60 * 1000;
+
+    double Average(const std::vector<double>& values)
+    {
+        if (values.empty()) return 0.0;
+        return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    }
+}
+
+void KpiCollector::Clear()
+{
+    wait_times.clear();
+    journey_times.clear();
+    recent_alights.clear();
+    peak_delivered = 0;
+    rescue_delays.clear();
+}
+
+void KpiCollector::OnPassengerBoarded(const Passenger& passenger)
+{
+    wait_times.push_back(static_cast<double>(passenger.board_time - passenger.arrival_time));
+}
+
+void KpiCollector::OnPassengerAlighted(const Passenger& passenger)
+{
+    journey_times.push_back(static_cast<double>(passenger.alight_time - passenger.arrival_time));
+    // 送达时刻按虚拟时间递增; 以每次送达为窗口右端, 统计(t - 5min, t]内的人数, 其最大值即任意5分钟区间的最大值
+    TimerService::Time time = passenger.alight_time;
+    while (!recent_alights.empty() && recent_alights.front() <= time - HandlingWindowMs)
+        recent_alights.pop_front();
+    recent_alights.push_back(time);
+    peak_delivered = std::max<std::uint64_t>(peak_delivered, recent_alights.size());
+}
+
+void KpiCollector::OnCallRescued(int from_id, int to_id, int floor, Direction dir, TimerService::Time delayed_ms)
+{
+    rescue_delays.push_back(static_cast<double>(delayed_ms));
+}
+
+void KpiCollector::SaveState(CheckpointWriter& writer) const
+{
+    writer.Put(CheckpointTag("KPI "));
+    writer.PutVector(wait_times);
+    writer.PutVector(journey_times);
+    writer.PutVector(std::vector<TimerService::Time>(recent_alights.begin(), recent_alights.end()));
+    writer.Put(peak_delivered);
+    writer.PutVector(rescue_delays);
+}
+
+bool KpiCollector::LoadState(CheckpointReader& reader)
+{
+    std::vector<TimerService::Time> recent;
+    if (!reader.Expect(CheckpointTag("KPI ")) || !reader.GetVector(wait_times) || !reader.GetVector(journey_times)
+        || !reader.GetVector(recent))
+        return false;
+    recent_alights.assign(recent.begin(), recent.end());
+    peak_delivered = reader.Get<std::uint64_t>();
+    return reader.GetVector(rescue_delays);
+}
+
+double KpiCollector::Percentile(std::vector<double>& values, double percent)
+{
+    if (values.empty()) return 0.0;
+    // 最近秩法
+    size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * values.size()));
+    size_t index = rank == 0 ? 0 : rank - 1;
+    if (index >= values.size()) index = values.size() - 1;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+KpiReport KpiCollector::Report(const ElevatorGroup& group) const
+{
+    KpiReport report;
+    std::vector<double> waits = wait_times;
+    std::vector<double> journeys = journey_times;
+    report.passengers = journeys.size();
+    report.avg_wait_ms = Average(waits);
+    report.p95_wait_ms = Percentile(waits, 95);
+    report.p99_wait_ms = Percentile(waits, 99);
+    report.max_wait_ms = waits.empty() ? 0.0 : *std::max_element(waits.begin(), waits.end());
+    report.avg_journey_ms = Average(journeys);
+    report.p95_journey_ms = Percentile(journeys, 95);
+    report.p99_journey_ms = Percentile(journeys, 99);
+    report.handling_capacity_5min = peak_delivered;
+    report.rescued_calls = rescue_delays.size();
+    report.avg_rescue_delay_ms = Average(rescue_delays);
+    report.max_rescue_delay_ms = rescue_delays.empty() ? 0.0 : *std::max_element(rescue_delays.begin(), rescue_delays.end());
+
+    const DispatchStats& stats = group.GetDispatchStats();
+    report.decisions = stats.decisions;
+    report.decisions_per_second = stats.total_ns > 0 ? stats.decisions * 1e9 / stats.total_ns : 0.0;
+    return report;
+}
+
+std::string KpiReport::CsvHeader()
+{
+    return "passengers,avg_wait_ms,p95_wait_ms,p99_wait_ms,max_wait_ms,"
+        "avg_journey_ms,p95_journey_ms,p99_journey_ms,handling_capacity_5min,"
+        "rescued_calls,avg_rescue_delay_ms,max_rescue_delay_ms,"
+        "decisions,decisions_per_second,simulated_ms,wall_ms,events";
+}
+
+std::string KpiReport::ToCsv() const
+{
+    char text[512];
+    std::snprintf(text, sizeof(text), "%llu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%llu,%llu,%.1f,%.1f,%llu,%.0f,%lld,%.3f,%llu",
+        static_cast<unsigned long long>(passengers), avg_wait_ms, p95_wait_ms, p99_wait_ms, max_wait_ms,
+        avg_journey_ms, p95_journey_ms, p99_journey_ms, static_cast<unsigned long long>(handling_capacity_5min),
+        static_cast<unsigned long long>(rescued_calls), avg_rescue_delay_ms, max_rescue_delay_ms,
+        static_cast<unsigned long long>(decisions),
+        decisions_per_second, static_cast<long long>(simulated_ms), wall_ms, static_cast<unsigned long long>(events));
+    return text;
+}
+
+std::string KpiReport::ToJsonFields() const
+{
+    char text[1024];
+    std::snprintf(text, sizeof(text),
+        "\"passengers\":%llu,\"avg_wait_ms\":%.1f,\"p95_wait_ms\":%.1f,\"p99_wait_ms\":%.1f,\"max_wait_ms\":%.1f,"
+        "\"avg_journey_ms\":%.1f,\"p95_journey_ms\":%.1f,\"p99_journey_ms\":%.1f,\"handling_capacity_5min\":%llu,"
+        "\"rescued_calls\":%llu,\"avg_rescue_delay_ms\":%.1f,\"max_rescue_delay_ms\":%.1f,"
+        "\"decisions\":%llu,\"decisions_per_second\":%.0f,\"simulated_ms\":%lld,\"wall_ms\":%.3f,\"events\":%llu",
+        static_cast<unsigned long long>(passengers), avg_wait_ms, p95_wait_ms, p99_wait_ms, max_wait_ms,
+        avg_journey_ms, p95_journey_ms, p99_journey_ms, static_cast<unsigned long long>(handling_capacity_5min),
+        static_cast<unsigned long long>(rescued_calls), avg_rescue_delay_ms, max_rescue_delay_ms,
+        static_cast<unsigned long long>(decisions),
+        decisions_per_second, static_cast<long long>(simulated_ms), wall_ms, static_cast<unsigned long long>(events));
+    return text;
+}
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "ElevatorGroup.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// 电梯群控常用指标(时间单位: 毫秒)
+struct KpiReport {
+    std::uint64_t passengers = 0;       // 已送达乘客数
+    double avg_wait_ms = 0;             // 候梯时间: 到达候梯厅 -> 进入电梯
+    double p95_wait_ms = 0;
+    double p99_wait_ms = 0;
+    double max_wait_ms = 0;
+    double avg_journey_ms = 0;          // 行程时间: 到达候梯厅 -> 离开电梯
+    double p95_journey_ms = 0;
+    double p99_journey_ms = 0;
+    std::uint64_t handling_capacity_5min = 0; // 任意5分钟区间[t, t+5min)内的最大送达人数(滑动窗口, 不按整5分钟分桶)
+    std::uint64_t rescued_calls = 0;    // 从故障电梯改派的外呼数
+    double avg_rescue_delay_ms = 0;     // 外呼因故障耽搁的时间: 故障开始(或乘客到达) -> 改派
+    double max_rescue_delay_ms = 0;
+    std::uint64_t decisions = 0;        // 调度决策次数
+    double decisions_per_second = 0;    // 调度器每秒可做的决策数(按决策耗时计算)
+    std::int64_t simulated_ms = 0;      // 模拟的虚拟时长
+    double wall_ms = 0;                 // 实际耗时
+    std::uint64_t events = 0;           // 执行的事件数
+
+    static std::string CsvHeader();
+    std::string ToCsv() const;
+    std::string ToJsonFields() const; // 不含花括号, 便于和场景参数拼接
+};
+
+// 收集乘客的候梯/行程时间
+class KpiCollector : public GroupObserver
+{
+public:
+    KpiCollector() {}
+public:
+    void Clear();
+    void OnPassengerBoarded(const Passenger& passenger) override;
+    void OnPassengerAlighted(const Passenger& passenger) override;
+    void OnCallRescued(int from_id, int to_id, int floor, Direction dir, TimerService::Time delayed_ms) override;
+    KpiReport Report(const ElevatorGroup& group) const; // 汇总乘客相关指标和调度统计
+    void SaveState(CheckpointWriter& writer) const;
+    bool LoadState(CheckpointReader& reader);
+    static double Percentile(std::vector<double>& values, double percent); // 会对values排序
+private:
+    std::vector<double> wait_times;
+    std::vector<double> journey_times;
+    std::deque<TimerService::Time> recent_alights; // 最近5分钟内的送达时刻, 按时间递增
+    std::uint64_t peak_delivered = 0;              // 滑动窗口内送达人数的最大值
+    std::vector<double> rescue_delays;
+};
@@ -0,0 +1,151 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// 有界无锁队列(多生产者/多消费者), 每个槽位带序号, 生产者和消费者只在各自的位置上CAS
+// 容量取不小于capacity的2的幂; 队列满时TryPush返回false, 调用方自行决定丢弃或重试
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+public:
+    bool TryPush(const T& value)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // 满
+            }
+            else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 一次CAS占用连续的空槽位, 返回写入的个数; 队列剩余空间不足时只写入前面能放下的部分
+    size_t TryPushMany(const T* values, size_t count)
+    {
+        if (count == 0) return 0;
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t free = 0;
+            while (free < count && free <= mask) {
+                size_t sequence = cells[(pos + free) & mask].sequence.load(std::memory_order_acquire);
+                if (sequence != pos + free) break;
+                ++free;
+            }
+            if (free == 0) {
+                Cell& cell = cells[pos & mask];
+                std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<std::ptrdiff_t>(pos);
+                if (diff < 0) return 0; // 满
+                pos = tail.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (tail.compare_exchange_weak(pos, pos + free, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < free; ++i) {
+                    Cell& cell = cells[(pos + i) & mask];
+                    cell.value = values[i];
+                    cell.sequence.store(pos + i + 1, std::memory_order_release);
+                }
+                return free;
+            }
+        }
+    }
+
+    bool TryPop(T& value)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = cell.value;
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // 空
+            }
+            else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t Capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{ 0 };
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> tail{ 0 }; // 生产者和消费者的位置分处不同缓存行
+    alignas(64) std::atomic<size_t> head{ 0 };
+};
+
+// 三缓冲快照: 一个写线程反复发布完整状态, 一个读线程随时取最新发布的版本
+// 双方都不阻塞, 读到的总是某次完整发布的状态; 槽位对象反复复用, 稳定后不再分配内存
+template <typename T>
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer() {}
+    SnapshotBuffer(const SnapshotBuffer&) = delete;
+    SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+public:
+    // 写线程: 在WriteSlot()上修改, 然后Publish()
+    T& WriteSlot() { return slots[back]; }
+    void Publish()
+    {
+        unsigned previous = middle.exchange(back | FreshBit, std::memory_order_acq_rel);
+        back = previous & IndexMask;
+    }
+
+    // 读线程: 有新版本时换入, 返回当前持有的版本
+    const T& Read()
+    {
+        if (middle.load(std::memory_order_relaxed) & FreshBit) {
+            unsigned previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & IndexMask;
+        }
+        return slots[front];
+    }
+    bool HasFresh() const { return (middle.load(std::memory_order_relaxed) & FreshBit) != 0; }
+
+private:
+    static constexpr unsigned FreshBit = 4;
+    static constexpr unsigned IndexMask = 3;
+    T slots[3];
+    unsigned back = 0;                 // 只由写线程访问
+    alignas(64) std::atomic<unsigned> middle{ 1 }; // 交换区, 带"有新版本"标记
+    alignas(64) unsigned front = 2;    // 只由读线程访问
+};
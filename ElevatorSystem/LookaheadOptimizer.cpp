@@ -0,0 +1,277 @@
+﻿#include "LookaheadOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+    const int PollMs = 2; // 工作线程空闲时检查问题队列的间隔
+}
+
+std::uint64_t LookaheadOptimizer::NextRandom()
+{
+    // splitmix64, 与TrafficGenerator相同, 结果与平台无关
+    std::uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+double LookaheadOptimizer::NextUniform()
+{
+    return (NextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double LookaheadOptimizer::CarCost(const AssignmentProblem& problem, int car, const std::vector<int>& calls)
+{
+    const LookaheadCar& info = problem.cars[car];
+    stops.clear();
+    for (int floor : info.fixed_stops)
+        stops.emplace_back(floor, 0);
+    for (int call : calls)
+        stops.emplace_back(problem.calls[call].floor, problem.calls[call].age_ms);
+    if (stops.empty()) return 0.0;
+    std::sort(stops.begin(), stops.end());
+
+    // LOOK: 先沿当前方向走到最远的停靠层再折返; 空闲时上方有停靠则先上行(与DecideNextAction一致)
+    const CarTiming& timing = problem.timing;
+    const MotionTable& motion = *problem.motion;
+    const int pos = info.status.floor;
+    Direction dir = info.status.direction;
+    if (dir == Direction::None)
+        dir = stops.back().first > pos ? Direction::Up : Direction::Down;
+
+    double cost = 0.0;
+    long long time = info.status.busy_ms;
+    int at = pos;
+    int last_stop = -1; // 同一层的多个请求只停一次
+    auto visit = [&](const std::pair<int, TimerService::Time>& stop) {
+        if (stop.first != last_stop) {
+            if (last_stop >= 0) time += Dispatcher::DwellTime(timing);
+            time += motion.RunTime(at, stop.first);
+            at = stop.first;
+            last_stop = stop.first;
+        }
+        double wait_s = (stop.second + time) / 1000.0;
+        cost += wait_s * wait_s;
+    };
+
+    // 前方一段含当前楼层
+    const size_t split = dir == Direction::Up
+        ? std::lower_bound(stops.begin(), stops.end(), std::make_pair(pos, TimerService::Time(-1))) - stops.begin()
+        : std::upper_bound(stops.begin(), stops.end(), std::make_pair(pos, std::numeric_limits<TimerService::Time>::max())) - stops.begin();
+    if (dir == Direction::Up) {
+        for (size_t i = split; i < stops.size(); ++i) visit(stops[i]);
+        if (split > 0) time += motion.ReversalTime();
+        for (size_t i = split; i-- > 0;) visit(stops[i]);
+    }
+    else {
+        for (size_t i = split; i-- > 0;) visit(stops[i]);
+        if (split < stops.size()) time += motion.ReversalTime();
+        for (size_t i = split; i < stops.size(); ++i) visit(stops[i]);
+    }
+    return cost;
+}
+
+AssignmentPlan LookaheadOptimizer::Solve(const AssignmentProblem& problem, const LookaheadSettings& settings)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    AssignmentPlan plan;
+    plan.version = problem.version;
+    const int car_count = static_cast<int>(problem.cars.size());
+    const int call_count = static_cast<int>(problem.calls.size());
+
+    std::vector<int> assignment(call_count);
+    std::vector<std::vector<int>> per_car(car_count);
+    for (int i = 0; i < call_count; ++i) {
+        assignment[i] = problem.calls[i].car;
+        per_car[assignment[i]].push_back(i);
+    }
+    std::vector<double> car_cost(car_count);
+    double total = 0.0;
+    for (int car = 0; car < car_count; ++car) {
+        car_cost[car] = CarCost(problem, car, per_car[car]);
+        total += car_cost[car];
+    }
+    plan.cost_before = plan.cost_after = total;
+    if (call_count == 0) return plan;
+
+    // 初始温度取每个外呼平均代价的十分之一, 按几何级数在迭代上限内降到千分之一
+    std::vector<int> best = assignment;
+    double best_total = total;
+    double temperature = std::max(total / call_count * 0.1, 1e-6);
+    const double cooling = settings.max_iterations > 0 ? std::pow(1e-3, 1.0 / settings.max_iterations) : 1.0;
+    std::vector<int> from_calls;
+    std::vector<int> to_calls;
+    int iteration = 0;
+    for (; iteration < settings.max_iterations; ++iteration, temperature *= cooling) {
+        if (settings.max_ms > 0 && (iteration & 63) == 0 &&
+            std::chrono::duration<double, std::milli>(Clock::now() - start).count() > settings.max_ms)
+            break;
+        const int call = static_cast<int>(NextRandom() % call_count);
+        const std::vector<int>& candidates = problem.calls[call].candidates;
+        if (candidates.size() < 2) continue;
+        const int to = candidates[NextRandom() % candidates.size()];
+        const int from = assignment[call];
+        if (to == from) continue;
+
+        from_calls = per_car[from];
+        from_calls.erase(std::find(from_calls.begin(), from_calls.end(), call));
+        to_calls = per_car[to];
+        to_calls.push_back(call);
+        const double from_cost = CarCost(problem, from, from_calls);
+        const double to_cost = CarCost(problem, to, to_calls);
+        const double delta = from_cost + to_cost - car_cost[from] - car_cost[to];
+        if (delta > 0 && NextUniform() >= std::exp(-delta / temperature)) continue;
+
+        per_car[from].swap(from_calls);
+        per_car[to].swap(to_calls);
+        car_cost[from] = from_cost;
+        car_cost[to] = to_cost;
+        assignment[call] = to;
+        total += delta;
+        if (total < best_total) {
+            best_total = total;
+            best = assignment;
+        }
+    }
+    plan.iterations = iteration;
+    if (best_total > plan.cost_before * (1.0 - settings.min_gain)) return plan;
+
+    plan.cost_after = best_total;
+    for (int i = 0; i < call_count; ++i) {
+        if (best[i] == problem.calls[i].car) continue;
+        Reassignment move;
+        move.floor = problem.calls[i].floor;
+        move.dir = problem.calls[i].dir;
+        move.from_car = problem.calls[i].car;
+        move.to_car = best[i];
+        plan.moves.push_back(move);
+    }
+    return plan;
+}
+
+PeriodicReoptimizer::PeriodicReoptimizer(ElevatorGroup& group, TimerService& timers, const LookaheadSettings& settings, std::uint64_t seed)
+    : group(group), timers(timers), settings(settings), optimizer(seed)
+{
+    group.AddObserver(this);
+}
+
+PeriodicReoptimizer::~PeriodicReoptimizer()
+{
+    if (timer != TimerService::InvalidTimer)
+        timers.Cancel(timer);
+    group.RemoveObserver(this);
+}
+
+void PeriodicReoptimizer::OnCallAssigned(int elevator_id, int floor, Direction dir)
+{
+    // 有新外呼时启动周期, 外呼全部处理完后停止, 事件队列可以排空
+    if (settings.period_ms > 0 && timer == TimerService::InvalidTimer)
+        Schedule(settings.period_ms);
+}
+
+void PeriodicReoptimizer::Schedule(int delay_ms)
+{
+    due = timers.Now() + delay_ms;
+    timer = timers.Schedule(delay_ms, [this]() {
+        timer = TimerService::InvalidTimer;
+        Run();
+    });
+}
+
+void PeriodicReoptimizer::Run()
+{
+    group.BuildAssignmentProblem(problem);
+    if (problem.calls.empty()) return;
+    AssignmentPlan plan = optimizer.Solve(problem, settings);
+    ++runs;
+    moves += group.ApplyAssignmentPlan(plan);
+    if (timer == TimerService::InvalidTimer)
+        Schedule(settings.period_ms);
+}
+
+void PeriodicReoptimizer::SaveState(CheckpointWriter& writer) const
+{
+    writer.Put(CheckpointTag("LOOK"));
+    writer.Put(optimizer.GetRngState());
+    writer.Put(runs);
+    writer.Put(moves);
+    writer.Put(timer);
+    writer.Put(due);
+}
+
+bool PeriodicReoptimizer::LoadState(CheckpointReader& reader, std::vector<PendingTimer>& pending)
+{
+    if (!reader.Expect(CheckpointTag("LOOK"))) return false;
+    std::uint64_t rng_state = reader.Get<std::uint64_t>();
+    std::uint64_t loaded_runs = reader.Get<std::uint64_t>();
+    std::uint64_t loaded_moves = reader.Get<std::uint64_t>();
+    TimerService::TimerId saved_timer = reader.Get<TimerService::TimerId>();
+    TimerService::Time saved_due = reader.Get<TimerService::Time>();
+    if (!reader.Ok()) return false;
+
+    if (timer != TimerService::InvalidTimer) {
+        timers.Cancel(timer);
+        timer = TimerService::InvalidTimer;
+    }
+    optimizer.SetRngState(rng_state);
+    runs = loaded_runs;
+    moves = loaded_moves;
+    due = saved_due;
+    if (saved_timer != TimerService::InvalidTimer) {
+        pending.push_back(PendingTimer{ saved_timer, [this]() {
+            Schedule(static_cast<int>(due - timers.Now()));
+        } });
+    }
+    return true;
+}
+
+BackgroundOptimizer::BackgroundOptimizer(const LookaheadSettings& settings, std::uint64_t seed)
+    : settings(settings), optimizer(seed), problems(2), plans(2)
+{
+}
+
+BackgroundOptimizer::~BackgroundOptimizer()
+{
+    Stop();
+}
+
+void BackgroundOptimizer::Start()
+{
+    if (running.exchange(true)) return;
+    worker = std::thread([this]() { Run(); });
+}
+
+void BackgroundOptimizer::Stop()
+{
+    running.store(false, std::memory_order_release);
+    if (worker.joinable())
+        worker.join();
+}
+
+bool BackgroundOptimizer::Submit(const AssignmentProblem& problem)
+{
+    return problems.TryPush(problem);
+}
+
+bool BackgroundOptimizer::TryTakePlan(AssignmentPlan& plan)
+{
+    return plans.TryPop(plan);
+}
+
+void BackgroundOptimizer::Run()
+{
+    AssignmentProblem problem;
+    while (running.load(std::memory_order_acquire)) {
+        if (!problems.TryPop(problem)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(PollMs));
+            continue;
+        }
+        AssignmentPlan plan = optimizer.Solve(problem, settings);
+        // 没有改派的结果不必交回; 结果队列满时丢弃, 模拟线程下个周期会重新提交
+        if (!plan.moves.empty())
+            plans.TryPush(plan);
+    }
+}
@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Checkpoint.h"
+#include "Dispatcher.h"
+#include "ElevatorGroup.h"
+#include "LockFree.h"
+
+// 前瞻优化参数
+struct LookaheadSettings {
+    int period_ms = 1000;      // 两次优化之间的虚拟时间, 0为关闭
+    int max_iterations = 2000; // 每次优化的迭代上限
+    double max_ms = 0.0;       // 每次优化的真实时间上限, 0为不限; 只按迭代数限制时结果可复现
+    double min_gain = 0.02;    // 目标函数至少下降这个比例才改派, 避免外呼在电梯之间来回抖动
+};
+
+// 一个可以改派的外呼
+struct PendingCall {
+    int floor = 0;
+    Direction dir = Direction::None;
+    int car = 0;                   // 当前分配的电梯下标
+    TimerService::Time age_ms = 0; // 本层同方向最早到达的乘客已等待的时间
+    std::vector<int> candidates;   // 可以接手的电梯下标, 含当前电梯
+};
+
+// 优化时看到的一部电梯: 当前状态和不能改派的停靠(内选、已在别的电梯登记过的外呼)
+struct LookaheadCar {
+    CarStatus status;
+    std::vector<int> fixed_stops;
+};
+
+// 某一时刻全部外呼的分配问题, 由模拟线程生成, 可以复制到其他线程求解
+struct AssignmentProblem {
+    std::uint64_t version = 0; // ElevatorGroup::GetCallVersion, 外呼变化后结果作废
+    CarTiming timing;
+    std::shared_ptr<const MotionTable> motion; // 只读, 可以与模拟线程共用
+    std::vector<LookaheadCar> cars;
+    std::vector<PendingCall> calls;
+};
+
+struct Reassignment {
+    int floor = 0;
+    Direction dir = Direction::None;
+    int from_car = 0;
+    int to_car = 0;
+};
+
+struct AssignmentPlan {
+    std::uint64_t version = 0;
+    double cost_before = 0.0; // 目标函数: 各停靠预计完成时间(秒, 外呼含已等待时间)的平方和
+    double cost_after = 0.0;
+    int iterations = 0;
+    std::vector<Reassignment> moves; // 收益不足min_gain时为空
+};
+
+// 外呼分配的局部搜索(模拟退火): 每步把一个外呼改派给另一部候选电梯, 只重算涉及的两部电梯
+// 电梯按LOOK顺序依次经过所有停靠层, 逐站累加出预计到达时间; 以平方和为目标, 优先压低长时间候梯
+class LookaheadOptimizer
+{
+public:
+    explicit LookaheadOptimizer(std::uint64_t seed = 1) : rng_state(seed) {}
+public:
+    AssignmentPlan Solve(const AssignmentProblem& problem, const LookaheadSettings& settings);
+    double CarCost(const AssignmentProblem& problem, int car, const std::vector<int>& calls);
+    std::uint64_t GetRngState() const { return rng_state; }
+    void SetRngState(std::uint64_t state) { rng_state = state; }
+private:
+    std::uint64_t NextRandom();
+    double NextUniform(); // [0, 1)
+private:
+    std::uint64_t rng_state;
+    std::vector<std::pair<int, TimerService::Time>> stops; // CarCost复用的(楼层, 已等待时间)
+};
+
+// 无界面模拟: 有外呼时每period_ms在模拟线程上同步优化一次
+// 只按迭代数限制, 与事件调度器使用同一虚拟时钟, 结果可复现并可存入检查点
+class PeriodicReoptimizer : public GroupObserver
+{
+public:
+    PeriodicReoptimizer(ElevatorGroup& group, TimerService& timers, const LookaheadSettings& settings, std::uint64_t seed);
+    ~PeriodicReoptimizer();
+    PeriodicReoptimizer(const PeriodicReoptimizer&) = delete;
+    PeriodicReoptimizer& operator=(const PeriodicReoptimizer&) = delete;
+public:
+    std::uint64_t GetRunCount() const { return runs; }
+    std::uint64_t GetMoveCount() const { return moves; }
+
+    void SaveState(CheckpointWriter& writer) const;
+    bool LoadState(CheckpointReader& reader, std::vector<PendingTimer>& pending);
+
+    // GroupObserver
+    void OnCallAssigned(int elevator_id, int floor, Direction dir) override;
+private:
+    void Schedule(int delay_ms);
+    void Run();
+
+private:
+    ElevatorGroup& group;
+    TimerService& timers;
+    const LookaheadSettings settings;
+    LookaheadOptimizer optimizer;
+    AssignmentProblem problem; // 每次复用
+    TimerService::TimerId timer = TimerService::InvalidTimer;
+    TimerService::Time due = 0;
+    std::uint64_t runs = 0;
+    std::uint64_t moves = 0;
+};
+
+// 在独立线程上求解: 模拟线程提交问题, 工作线程在max_ms内求解后交回结果, 两边互不阻塞
+// 问题和结果各经一个无锁队列整体传递; 模拟线程取回结果后一次应用, 外呼已变化(版本不符)的结果直接丢弃
+class BackgroundOptimizer
+{
+public:
+    BackgroundOptimizer(const LookaheadSettings& settings, std::uint64_t seed);
+    ~BackgroundOptimizer();
+    BackgroundOptimizer(const BackgroundOptimizer&) = delete;
+    BackgroundOptimizer& operator=(const BackgroundOptimizer&) = delete;
+public:
+    void Start();
+    void Stop();
+    const LookaheadSettings& GetSettings() const { return settings; }
+    bool Submit(const AssignmentProblem& problem); // 求解跟不上(队列满)时返回false
+    bool TryTakePlan(AssignmentPlan& plan);
+private:
+    void Run();
+
+private:
+    const LookaheadSettings settings;
+    LookaheadOptimizer optimizer; // 只在工作线程上使用
+    BoundedQueue<AssignmentProblem> problems;
+    BoundedQueue<AssignmentPlan> plans;
+    std::thread worker;
+    std::atomic<bool> running{ false };
+};
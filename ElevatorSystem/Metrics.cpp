@@ -0,0 +1,326 @@
+﻿#include "Metrics.h"
+#include <cstdio>
+
+namespace {
+    // 直方图导出的le边界为2的幂减1, 与桶边界对齐, 计数精确
+    std::uint64_t PowerMinusOne(int exponent)
+    {
+        return exponent >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << exponent) - 1;
+    }
+
+    // labels为空或如car="1", 输出时加上花括号
+    void AppendValue(std::string& text, const char* name, const std::string& labels, double value)
+    {
+        char line[256];
+        if (labels.empty())
+            std::snprintf(line, sizeof(line), "%s %.9g\n", name, value);
+        else
+            std::snprintf(line, sizeof(line), "%s{%s} %.9g\n", name, labels.c_str(), value);
+        text += line;
+    }
+
+    void AppendHeader(std::string& text, const char* name, const char* type, const char* help)
+    {
+        text += "# HELP ";
+        text += name;
+        text += ' ';
+        text += help;
+        text += "\n# TYPE ";
+        text += name;
+        text += ' ';
+        text += type;
+        text += '\n';
+    }
+
+    std::string CarLabel(int elevator_id)
+    {
+        char label[32];
+        std::snprintf(label, sizeof(label), "car=\"%d\"", elevator_id);
+        return label;
+    }
+}
+
+void LogHistogram::Clear()
+{
+    for (auto& bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+}
+
+int LogHistogram::BucketOf(std::uint64_t value)
+{
+    // 0~3各占一个桶; 之后每个[2^e, 2^(e+1))区间按次高两位分为4个子桶
+    if (value < SubBuckets) return static_cast<int>(value);
+    int exponent = FloorMask::HighestBit(value);
+    int sub = static_cast<int>((value >> (exponent - 2)) & (SubBuckets - 1));
+    return SubBuckets * (exponent - 1) + sub;
+}
+
+std::uint64_t LogHistogram::BucketUpper(int bucket)
+{
+    if (bucket < SubBuckets) return static_cast<std::uint64_t>(bucket);
+    int exponent = bucket / SubBuckets + 1;
+    std::uint64_t width = std::uint64_t(1) << (exponent - 2);
+    std::uint64_t lower = static_cast<std::uint64_t>(SubBuckets + bucket % SubBuckets) << (exponent - 2);
+    return lower + (width - 1);
+}
+
+std::uint64_t LogHistogram::CountAtMost(std::uint64_t value) const
+{
+    std::uint64_t total = 0;
+    for (int b = 0; b < BucketCount && BucketUpper(b) <= value; ++b)
+        total += buckets[b].load(std::memory_order_relaxed);
+    return total;
+}
+
+std::uint64_t LogHistogram::Percentile(double percent) const
+{
+    std::uint64_t total = Count();
+    if (total == 0) return 0;
+    std::uint64_t rank = static_cast<std::uint64_t>(percent / 100.0 * total);
+    if (rank >= total) rank = total - 1;
+    std::uint64_t seen = 0;
+    for (int b = 0; b < BucketCount; ++b) {
+        seen += buckets[b].load(std::memory_order_relaxed);
+        if (seen > rank) return BucketUpper(b);
+    }
+    return BucketUpper(BucketCount - 1);
+}
+
+MetricsCollector::MetricsCollector(int elevator_count, int floor_count, const TimerService& timers)
+    : timers(timers), hall_pressed_at(static_cast<size_t>(floor_count) * 2, -1)
+{
+    for (int i = 0; i < elevator_count; ++i)
+        cars.emplace_back(new CarMetrics());
+}
+
+void MetricsCollector::Attach(ElevatorGroup& group)
+{
+    Touch();
+    for (int i = 0; i < group.GetElevatorCount() && i < static_cast<int>(cars.size()); ++i) {
+        const ElevatorCar& car = group.GetCar(i);
+        CarMetrics& metrics = *cars[i];
+        metrics.state = car.GetState();
+        metrics.idle_since.store(metrics.state == ElevatorState::Idle ? timers.Now() : -1, std::memory_order_relaxed);
+        group.GetCar(i).AddObserver(this);
+    }
+    group.AddObserver(this);
+}
+
+void MetricsCollector::Detach(ElevatorGroup& group)
+{
+    for (int i = 0; i < group.GetElevatorCount(); ++i)
+        group.GetCar(i).RemoveObserver(this);
+    group.RemoveObserver(this);
+}
+
+void MetricsCollector::Touch()
+{
+    last_time.store(timers.Now(), std::memory_order_relaxed);
+}
+
+void MetricsCollector::OnCarStateChanged(const ElevatorCar& car)
+{
+    int index = car.GetElevatorID() - 1;
+    if (index < 0 || index >= static_cast<int>(cars.size())) return;
+    Touch();
+    CarMetrics& metrics = *cars[index];
+    ElevatorState state = car.GetState();
+    TimerService::Time now = timers.Now();
+
+    // 运行中由上行变为下行(或反之)计为一次换向, 回到空闲后重新开始
+    Direction dir = car.GetDirection();
+    if (dir != Direction::None) {
+        if (metrics.heading != Direction::None && dir != metrics.heading)
+            metrics.reversals.store(metrics.reversals.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        metrics.heading = dir;
+    }
+    if (state == ElevatorState::Opening && metrics.state != ElevatorState::Opening)
+        metrics.door_cycles.store(metrics.door_cycles.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // 一次行程: 离开空闲到回到空闲
+    if (state == ElevatorState::Idle && metrics.state != ElevatorState::Idle) {
+        metrics.idle_since.store(now, std::memory_order_relaxed);
+        metrics.trips.store(metrics.trips.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        metrics.stops_per_trip.Record(metrics.trip_stops);
+        metrics.heading = Direction::None;
+    }
+    else if (state != ElevatorState::Idle && metrics.state == ElevatorState::Idle) {
+        std::int64_t since = metrics.idle_since.load(std::memory_order_relaxed);
+        if (since >= 0)
+            metrics.idle_ms.store(metrics.idle_ms.load(std::memory_order_relaxed) + (now - since), std::memory_order_relaxed);
+        metrics.idle_since.store(-1, std::memory_order_relaxed);
+        metrics.trip_stops = 0;
+    }
+    metrics.state = state;
+}
+
+void MetricsCollector::OnCarArrived(const ElevatorCar& car, int floor, ElevatorState state)
+{
+    int index = car.GetElevatorID() - 1;
+    if (index < 0 || index >= static_cast<int>(cars.size())) return;
+    CarMetrics& metrics = *cars[index];
+    metrics.stops.store(metrics.stops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    metrics.trip_stops++;
+}
+
+void MetricsCollector::OnHallCallChanged(int floor, Direction dir, bool active)
+{
+    size_t slot = static_cast<size_t>(floor) * 2 + (dir == Direction::Down ? 1 : 0);
+    if (slot >= hall_pressed_at.size()) return;
+    Touch();
+    TimerService::Time now = timers.Now();
+    if (active) {
+        hall_pressed_at[slot] = now;
+        hall_calls.store(hall_calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    else if (hall_pressed_at[slot] >= 0) {
+        hall_wait_ms.Record(static_cast<std::uint64_t>(now - hall_pressed_at[slot]));
+        hall_pressed_at[slot] = -1;
+    }
+}
+
+void MetricsCollector::OnPassengerBoarded(const Passenger& passenger)
+{
+    passenger_wait_ms.Record(static_cast<std::uint64_t>(passenger.board_time - passenger.arrival_time));
+}
+
+void MetricsCollector::OnPassengerAlighted(const Passenger& passenger)
+{
+    passenger_ride_ms.Record(static_cast<std::uint64_t>(passenger.alight_time - passenger.board_time));
+}
+
+void MetricsCollector::OnDispatchDecision(std::uint64_t elapsed_ns)
+{
+    decision_ns.Record(elapsed_ns);
+}
+
+void MetricsCollector::OnCarBypassed(const ElevatorCar& car, int floor)
+{
+    int index = car.GetElevatorID() - 1;
+    if (index < 0 || index >= static_cast<int>(cars.size())) return;
+    CarMetrics& metrics = *cars[index];
+    metrics.full_bypasses.store(metrics.full_bypasses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void MetricsCollector::OnCallRescued(int from_id, int to_id, int floor, Direction dir, TimerService::Time delayed_ms)
+{
+    int index = from_id - 1;
+    if (index < 0 || index >= static_cast<int>(cars.size())) return;
+    CarMetrics& metrics = *cars[index];
+    metrics.rescued_calls.store(metrics.rescued_calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    rescue_delay_ms.Record(static_cast<std::uint64_t>(delayed_ms));
+}
+
+void MetricsCollector::AppendHistogram(std::string& text, const char* name, const std::string& labels, const LogHistogram& histogram,
+    int first_exponent, int last_exponent, double unit) const
+{
+    // 先读总数再读各桶: 读取期间新增的记录只会让各桶的和略大于count, +Inf取两者较大值保持单调
+    std::string bucket_name = std::string(name) + "_bucket";
+    std::string prefix = labels.empty() ? std::string() : labels + ",";
+    std::uint64_t count = histogram.Count();
+    double sum = histogram.Sum() * unit;
+    std::uint64_t cumulative = 0;
+    char le[96];
+    for (int exponent = first_exponent; exponent <= last_exponent; ++exponent) {
+        std::uint64_t bound = PowerMinusOne(exponent);
+        cumulative = histogram.CountAtMost(bound);
+        std::snprintf(le, sizeof(le), "%sle=\"%.9g\"", prefix.c_str(), bound * unit);
+        AppendValue(text, bucket_name.c_str(), le, static_cast<double>(cumulative));
+    }
+    if (count < cumulative) count = cumulative;
+    std::snprintf(le, sizeof(le), "%sle=\"+Inf\"", prefix.c_str());
+    AppendValue(text, bucket_name.c_str(), le, static_cast<double>(count));
+    AppendValue(text, (std::string(name) + "_sum").c_str(), labels, sum);
+    AppendValue(text, (std::string(name) + "_count").c_str(), labels, static_cast<double>(count));
+}
+
+std::string MetricsCollector::FormatPrometheus() const
+{
+    std::string text;
+    text.reserve(16 * 1024 + cars.size() * 1024);
+    std::int64_t now = last_time.load(std::memory_order_relaxed);
+
+    AppendHeader(text, "elevator_sim_time_seconds", "gauge", "Virtual time of the last observed event.");
+    AppendValue(text, "elevator_sim_time_seconds", "", now / 1000.0);
+    AppendHeader(text, "elevator_hall_calls_total", "counter", "Hall buttons pressed.");
+    AppendValue(text, "elevator_hall_calls_total", "", static_cast<double>(hall_calls.load(std::memory_order_relaxed)));
+
+    // 毫秒直方图: 0.127s ~ 70min; 决策耗时: 63ns ~ 67ms
+    AppendHeader(text, "elevator_hall_call_wait_seconds", "histogram", "Time from hall button press until a car answers it.");
+    AppendHistogram(text, "elevator_hall_call_wait_seconds", "", hall_wait_ms, 7, 22, 1e-3);
+    AppendHeader(text, "elevator_passenger_wait_seconds", "histogram", "Time from arrival at the landing until boarding.");
+    AppendHistogram(text, "elevator_passenger_wait_seconds", "", passenger_wait_ms, 7, 22, 1e-3);
+    AppendHeader(text, "elevator_passenger_ride_seconds", "histogram", "Time from boarding until alighting.");
+    AppendHistogram(text, "elevator_passenger_ride_seconds", "", passenger_ride_ms, 7, 22, 1e-3);
+    AppendHeader(text, "elevator_dispatch_decision_seconds", "histogram", "Wall-clock latency of one dispatcher decision.");
+    AppendHistogram(text, "elevator_dispatch_decision_seconds", "", decision_ns, 6, 26, 1e-9);
+    AppendHeader(text, "elevator_call_rescue_delay_seconds", "histogram", "Time a hall call sat on a faulty car before it was reassigned.");
+    AppendHistogram(text, "elevator_call_rescue_delay_seconds", "", rescue_delay_ms, 7, 22, 1e-3);
+
+    struct Counter {
+        const char* name;
+        const char* help;
+        std::atomic<std::uint64_t> CarMetrics::* field;
+    };
+    const Counter counters[] = {
+        { "elevator_car_door_cycles_total", "Door open/close cycles.", &CarMetrics::door_cycles },
+        { "elevator_car_stops_total", "Stops at a landing.", &CarMetrics::stops },
+        { "elevator_car_trips_total", "Trips from leaving idle until idle again.", &CarMetrics::trips },
+        { "elevator_car_reversals_total", "Direction reversals while in service.", &CarMetrics::reversals },
+        { "elevator_car_rescued_calls_total", "Hall calls moved off the car after an alarm, stall or removal from service.", &CarMetrics::rescued_calls },
+        { "elevator_car_full_bypasses_total", "Landings with a hall call passed without stopping because the car was full.", &CarMetrics::full_bypasses },
+    };
+    for (const Counter& counter : counters) {
+        AppendHeader(text, counter.name, "counter", counter.help);
+        for (size_t i = 0; i < cars.size(); ++i)
+            AppendValue(text, counter.name, CarLabel(static_cast<int>(i) + 1),
+                static_cast<double>(((*cars[i]).*counter.field).load(std::memory_order_relaxed)));
+    }
+
+    // 两个字段分别读取, 恰逢空闲状态切换时可能少算一个时段, 下一次导出即恢复
+    AppendHeader(text, "elevator_car_idle_ratio", "gauge", "Share of virtual time the car has been idle.");
+    for (size_t i = 0; i < cars.size(); ++i) {
+        std::int64_t idle = cars[i]->idle_ms.load(std::memory_order_relaxed);
+        std::int64_t since = cars[i]->idle_since.load(std::memory_order_relaxed);
+        if (since >= 0 && now > since) idle += now - since;
+        AppendValue(text, "elevator_car_idle_ratio", CarLabel(static_cast<int>(i) + 1),
+            now > 0 ? static_cast<double>(idle) / now : 1.0);
+    }
+
+    AppendHeader(text, "elevator_car_stops_per_trip", "histogram", "Stops made during one trip.");
+    for (size_t i = 0; i < cars.size(); ++i)
+        AppendHistogram(text, "elevator_car_stops_per_trip", CarLabel(static_cast<int>(i) + 1),
+            cars[i]->stops_per_trip, 0, 7, 1.0);
+    return text;
+}
+
+MetricsCollector::CarCounters MetricsCollector::GetCarCounters(int index) const
+{
+    CarCounters counters;
+    if (index < 0 || index >= static_cast<int>(cars.size())) return counters;
+    const CarMetrics& metrics = *cars[index];
+    counters.door_cycles = metrics.door_cycles.load(std::memory_order_relaxed);
+    counters.stops = metrics.stops.load(std::memory_order_relaxed);
+    counters.trips = metrics.trips.load(std::memory_order_relaxed);
+    counters.reversals = metrics.reversals.load(std::memory_order_relaxed);
+    counters.full_bypasses = metrics.full_bypasses.load(std::memory_order_relaxed);
+    return counters;
+}
+
+bool MetricsCollector::WriteFile(const std::string& path) const
+{
+    std::string text = FormatPrometheus();
+    std::string temp = path + ".tmp";
+    FILE* file = std::fopen(temp.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    if (std::fclose(file) != 0 || !ok) return false;
+    // Windows下rename不覆盖已有文件
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(path.c_str());
+        return std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+    return true;
+}
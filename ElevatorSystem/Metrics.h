@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ElevatorGroup.h"
+#include "TimerService.h"
+
+// 对数分桶直方图: 每个2的幂区间再等分为4个子桶, 相对误差不超过25%, 覆盖整个64位范围
+// 桶数组大小固定, 记录时只做三次relaxed原子写, 不加锁、不分配内存; 单线程写入, 任意线程读取
+class LogHistogram
+{
+public:
+    static const int SubBuckets = 4;
+    static const int BucketCount = SubBuckets * 64;
+
+    LogHistogram() { Clear(); }
+    LogHistogram(const LogHistogram&) = delete;
+    LogHistogram& operator=(const LogHistogram&) = delete;
+public:
+    void Record(std::uint64_t value) {
+        Add(buckets[BucketOf(value)], 1);
+        Add(count, 1);
+        Add(sum, value);
+    }
+    void Clear();
+    std::uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    std::uint64_t Sum() const { return sum.load(std::memory_order_relaxed); }
+    std::uint64_t CountAtMost(std::uint64_t value) const; // value为2的幂减1时精确
+    std::uint64_t Percentile(double percent) const;       // 返回所在桶的上界
+
+    static int BucketOf(std::uint64_t value);
+    static std::uint64_t BucketUpper(int bucket); // 桶内最大值
+private:
+    // 只有一个写线程, 不需要原子的读-改-写
+    static void Add(std::atomic<std::uint64_t>& counter, std::uint64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, BucketCount> buckets;
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> sum;
+};
+
+// 电梯组运行指标, 作为观察者挂在模拟线程上, 计数和直方图都在构造时分配好
+// 导出为Prometheus文本格式, 时间单位换算为秒
+class MetricsCollector : public CarObserver, public GroupObserver
+{
+public:
+    struct CarCounters {
+        std::uint64_t door_cycles = 0;
+        std::uint64_t stops = 0;
+        std::uint64_t trips = 0;
+        std::uint64_t reversals = 0;
+        std::uint64_t full_bypasses = 0;
+        bool operator==(const CarCounters& other) const {
+            return door_cycles == other.door_cycles && stops == other.stops && trips == other.trips
+                && reversals == other.reversals && full_bypasses == other.full_bypasses;
+        }
+    };
+    MetricsCollector(int elevator_count, int floor_count, const TimerService& timers);
+    MetricsCollector(const MetricsCollector&) = delete;
+    MetricsCollector& operator=(const MetricsCollector&) = delete;
+public:
+    void Attach(ElevatorGroup& group); // 观察电梯组及其所有电梯
+    void Detach(ElevatorGroup& group);
+
+    // 以下任意线程调用
+    std::string FormatPrometheus() const;
+    bool WriteFile(const std::string& path) const; // 先写临时文件再替换, 读取方不会看到写了一半的文件
+    CarCounters GetCarCounters(int index) const;   // index从0开始
+
+    // CarObserver
+    void OnCarStateChanged(const ElevatorCar& car) override;
+    void OnCarArrived(const ElevatorCar& car, int floor, ElevatorState state) override;
+    void OnCarBypassed(const ElevatorCar& car, int floor) override;
+    // GroupObserver
+    void OnHallCallChanged(int floor, Direction dir, bool active) override;
+    void OnPassengerBoarded(const Passenger& passenger) override;
+    void OnPassengerAlighted(const Passenger& passenger) override;
+    void OnDispatchDecision(std::uint64_t elapsed_ns) override;
+    void OnCallRescued(int from_id, int to_id, int floor, Direction dir, TimerService::Time delayed_ms) override;
+
+private:
+    struct CarMetrics {
+        std::atomic<std::uint64_t> door_cycles{ 0 };
+        std::atomic<std::uint64_t> stops{ 0 };
+        std::atomic<std::uint64_t> trips{ 0 };
+        std::atomic<std::uint64_t> reversals{ 0 };
+        std::atomic<std::uint64_t> rescued_calls{ 0 }; // 故障时从本电梯改派走的外呼
+        std::atomic<std::uint64_t> full_bypasses{ 0 }; // 满载经过有外呼的楼层
+        std::atomic<std::int64_t> idle_ms{ 0 };     // 已结束的空闲时段之和
+        std::atomic<std::int64_t> idle_since{ 0 };  // 当前空闲时段的开始时间, 不在空闲时为-1
+        LogHistogram stops_per_trip;
+        // 以下只在模拟线程上访问
+        ElevatorState state = ElevatorState::Idle;
+        Direction heading = Direction::None; // 最近一次的运行方向
+        std::uint64_t trip_stops = 0;
+    };
+    void Touch(); // 记录观察到的最新虚拟时间
+    void AppendHistogram(std::string& text, const char* name, const std::string& labels, const LogHistogram& histogram,
+        int first_exponent, int last_exponent, double unit) const;
+
+private:
+    const TimerService& timers;
+    std::vector<std::unique_ptr<CarMetrics>> cars;
+    std::vector<TimerService::Time> hall_pressed_at; // 每层上/下两个, -1为未按下
+    std::atomic<std::int64_t> last_time{ 0 };
+    std::atomic<std::uint64_t> hall_calls{ 0 };
+    LogHistogram hall_wait_ms;
+    LogHistogram passenger_wait_ms;
+    LogHistogram passenger_ride_ms;
+    LogHistogram decision_ns;
+    LogHistogram rescue_delay_ms;
+};
@@ -0,0 +1,66 @@
+﻿#include "MetricsServer.h"
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+namespace {
+    const qint64 MaxRequestBytes = 8 * 1024; // 只需要请求行, 过长的请求直接断开
+}
+
+MetricsServer::MetricsServer(const MetricsCollector& metrics, QObject* parent)
+    : QObject(parent), metrics(metrics), server(new QTcpServer(this))
+{
+    connect(server, &QTcpServer::newConnection, this, &MetricsServer::OnNewConnection);
+}
+
+bool MetricsServer::Listen(quint16 port)
+{
+    return server->listen(QHostAddress::LocalHost, port);
+}
+
+void MetricsServer::Close()
+{
+    server->close();
+}
+
+quint16 MetricsServer::GetPort() const
+{
+    return server->serverPort();
+}
+
+void MetricsServer::OnNewConnection()
+{
+    while (QTcpSocket* socket = server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [=]() { OnReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void MetricsServer::OnReadyRead(QTcpSocket* socket)
+{
+    // 等请求头收齐再应答, 每个连接只处理一个请求
+    if (socket->bytesAvailable() > MaxRequestBytes) {
+        socket->abort();
+        return;
+    }
+    QByteArray request = socket->peek(socket->bytesAvailable());
+    if (!request.contains("\r\n\r\n") && !request.contains("\n\n")) return;
+    socket->readAll();
+
+    QList<QByteArray> parts = request.left(request.indexOf('\n')).trimmed().split(' ');
+    QByteArray status = "200 OK";
+    QByteArray body;
+    if (parts.size() < 2 || parts[0] != "GET")
+        status = "405 Method Not Allowed";
+    else if (parts[1] != "/metrics" && !parts[1].startsWith("/metrics?"))
+        status = "404 Not Found";
+    else
+        body = QByteArray::fromStdString(metrics.FormatPrometheus());
+
+    QByteArray response = "HTTP/1.1 " + status + "\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n" + body;
+    socket->write(response);
+    socket->disconnectFromHost();
+}
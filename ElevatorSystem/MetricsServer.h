@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <QObject>
+#include "Metrics.h"
+
+class QTcpServer;
+class QTcpSocket;
+
+// 只监听本机回环地址的HTTP端点, GET /metrics返回Prometheus文本格式的指标
+// 在界面线程上运行, 指标由模拟线程写入、这里只读, 不会阻塞模拟
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    MetricsServer(const MetricsCollector& metrics, QObject* parent = nullptr);
+public:
+    bool Listen(quint16 port = DefaultPort);
+    void Close(); // 释放端口, 下一次模拟可以重新监听
+    quint16 GetPort() const;
+    static const quint16 DefaultPort = 9464;
+private:
+    void OnNewConnection();
+    void OnReadyRead(QTcpSocket* socket);
+
+private:
+    const MetricsCollector& metrics;
+    QTcpServer* server;
+};
@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include <cstdint>
+#include "TimerService.h"
+
+// 乘客: 在origin层呼梯, 前往destination层
+struct Passenger {
+    std::uint64_t id = 0;
+    int origin = 0;
+    int destination = 0;
+    TimerService::Time arrival_time = 0; // 到达候梯厅
+    TimerService::Time board_time = -1;  // 进入电梯
+    TimerService::Time alight_time = -1; // 离开电梯
+    int elevator_id = 0;                 // 乘坐的电梯, 0表示尚未上梯
+    int assigned_car = 0;                // 目的层派梯时分配的电梯, 0表示可乘任意电梯
+    int transfer_floor = -1;             // 分区时没有电梯直达, 需要换乘的楼层; -1表示直达
+
+    int LegDestination() const { return transfer_floor >= 0 ? transfer_floor : destination; } // 当前这一程的目的层
+};
@@ -0,0 +1,225 @@
+﻿#include "ShaftView.h"
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <algorithm>
+
+namespace {
+    QColor CarColor(const CarSnapshot& car)
+    {
+        // 停用或停滞的电梯显示为灰色, 报警优先
+        if ((car.out_of_service || car.stalled) && car.state != ElevatorState::Warning)
+            return QColor(160, 160, 160);
+        switch (car.state) {
+        case ElevatorState::Up:
+        case ElevatorState::Down: return QColor(135, 206, 235);
+        case ElevatorState::Opening:
+        case ElevatorState::Open:
+        case ElevatorState::Closing: return QColor(255, 190, 90);
+        case ElevatorState::Warning: return QColor(230, 60, 60);
+        default: return QColor(144, 238, 144);
+        }
+    }
+}
+
+ShaftView::ShaftView(int elevator_count, int floor_count, bool destination_dispatch, QWidget* parent)
+    : QWidget(parent), elevator_count(elevator_count), floor_count(floor_count),
+    destination_dispatch(destination_dispatch), assigned_car(floor_count, 0),
+    served(ZonePlan::Make(ZoningMode::None, elevator_count, floor_count, 1).served)
+{
+    shown.cars.resize(elevator_count);
+    for (auto& car : shown.cars)
+        car.targets.Resize(floor_count);
+    shown.hall_buttons.resize(floor_count);
+    setFixedSize(sizeHint());
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+QSize ShaftView::sizeHint() const
+{
+    return QSize(LabelWidth + HallWidth + elevator_count * ShaftWidth, floor_count * RowHeight);
+}
+
+int ShaftView::FloorAt(int y) const
+{
+    int row = std::clamp(y / RowHeight, 0, floor_count - 1);
+    return floor_count - 1 - row;
+}
+
+int ShaftView::CarAt(int x) const
+{
+    int offset = x - LabelWidth - HallWidth;
+    if (offset < 0) return -1;
+    int car = offset / ShaftWidth;
+    return car < elevator_count ? car : -1;
+}
+
+QRect ShaftView::CellRect(int car, int floor) const
+{
+    return QRect(LabelWidth + HallWidth + car * ShaftWidth, RowTop(floor), ShaftWidth, RowHeight);
+}
+
+QRect ShaftView::HallRect(int floor) const
+{
+    return QRect(0, RowTop(floor), LabelWidth + HallWidth, RowHeight);
+}
+
+void ShaftView::ApplySnapshot(const GroupSnapshot& snapshot)
+{
+    if (snapshot.version == shown.version) return;
+    for (int i = 0; i < elevator_count && i < static_cast<int>(snapshot.cars.size()); ++i) {
+        const CarSnapshot& next = snapshot.cars[i];
+        CarSnapshot& car = shown.cars[i];
+        if (next.floor != car.floor) {
+            update(CellRect(i, car.floor));
+            update(CellRect(i, next.floor));
+        }
+        else if (next.state != car.state || next.direction != car.direction ||
+            next.out_of_service != car.out_of_service || next.stalled != car.stalled) {
+            update(CellRect(i, next.floor));
+        }
+        if (next.targets != car.targets) {
+            // 按字比较, 只有变化的楼层才重绘
+            for (int w = 0; w < next.targets.WordCount() && w < car.targets.WordCount(); ++w) {
+                std::uint64_t diff = next.targets.Word(w) ^ car.targets.Word(w);
+                for (int bit = 0; diff; ++bit, diff >>= 1)
+                    if (diff & 1) update(CellRect(i, w * 64 + bit));
+            }
+        }
+        car.floor = next.floor;
+        car.state = next.state;
+        car.direction = next.direction;
+        car.targets = next.targets;
+        car.out_of_service = next.out_of_service;
+        car.stalled = next.stalled;
+    }
+    for (int floor = 0; floor < floor_count && floor < static_cast<int>(snapshot.hall_buttons.size()); ++floor) {
+        const FloorButtonState& next = snapshot.hall_buttons[floor];
+        FloorButtonState& hall = shown.hall_buttons[floor];
+        if (next.upPressed != hall.upPressed || next.downPressed != hall.downPressed) {
+            hall = next;
+            update(HallRect(floor));
+        }
+    }
+    shown.version = snapshot.version;
+    shown.now = snapshot.now;
+}
+
+void ShaftView::SetAssignedCar(int floor, int car)
+{
+    if (floor < 0 || floor >= floor_count) return;
+    assigned_car[floor] = car;
+    update(HallRect(floor));
+}
+
+void ShaftView::SetServedFloors(int car, const FloorMask& floors)
+{
+    if (car < 0 || car >= elevator_count || served[car] == floors) return;
+    served[car] = floors;
+    update(QRect(LabelWidth + HallWidth + car * ShaftWidth, 0, ShaftWidth, floor_count * RowHeight));
+}
+
+void ShaftView::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(this);
+    const QRect area = event->rect();
+    int top_floor = FloorAt(area.top());
+    int bottom_floor = FloorAt(area.bottom());
+    int first_car = std::max(0, (area.left() - LabelWidth - HallWidth) / ShaftWidth);
+    int last_car = std::min(elevator_count - 1, (area.right() - LabelWidth - HallWidth) / ShaftWidth);
+
+    painter.fillRect(area, Qt::white);
+    for (int floor = top_floor; floor >= bottom_floor; --floor) {
+        if (area.left() < LabelWidth + HallWidth)
+            PaintHall(painter, floor);
+        for (int car = first_car; car <= last_car; ++car)
+            PaintCell(painter, car, floor);
+    }
+}
+
+void ShaftView::PaintHall(QPainter& painter, int floor)
+{
+    QRect rect = HallRect(floor);
+    painter.setPen(QColor(153, 153, 153));
+    painter.fillRect(QRect(rect.left(), rect.top(), LabelWidth, RowHeight), QColor(173, 216, 230));
+    painter.drawLine(rect.bottomLeft(), rect.bottomRight());
+    painter.setPen(Qt::black);
+    painter.drawText(QRect(rect.left(), rect.top(), LabelWidth, RowHeight), Qt::AlignCenter, QString::number(floor + 1));
+
+    const int x = rect.left() + LabelWidth;
+    if (destination_dispatch) {
+        if (assigned_car[floor] > 0) {
+            painter.setPen(Qt::red);
+            painter.drawText(QRect(x, rect.top(), HallWidth, RowHeight), Qt::AlignCenter,
+                QString("%1号").arg(assigned_car[floor]));
+        }
+        return;
+    }
+    const FloorButtonState& hall = shown.hall_buttons[floor];
+    const int half = HallWidth / 2;
+    if (floor != floor_count - 1) {
+        QRect up(x + 2, rect.top() + 2, half - 4, RowHeight - 4);
+        painter.setPen(QColor(102, 102, 102));
+        painter.setBrush(hall.upPressed ? QColor(Qt::red) : QColor(Qt::white));
+        painter.drawRoundedRect(up, 6, 6);
+        painter.drawText(up, Qt::AlignCenter, "↑");
+    }
+    if (floor != 0) {
+        QRect down(x + half + 2, rect.top() + 2, half - 4, RowHeight - 4);
+        painter.setPen(QColor(102, 102, 102));
+        painter.setBrush(hall.downPressed ? QColor(Qt::red) : QColor(Qt::white));
+        painter.drawRoundedRect(down, 6, 6);
+        painter.drawText(down, Qt::AlignCenter, "↓");
+    }
+    painter.setBrush(Qt::NoBrush);
+}
+
+void ShaftView::PaintCell(QPainter& painter, int car, int floor)
+{
+    QRect rect = CellRect(car, floor);
+    painter.fillRect(rect, served[car].Test(floor) ? QColor(245, 245, 245) : QColor(215, 215, 215));
+    painter.setPen(QColor(204, 204, 204));
+    painter.drawLine(rect.topLeft(), rect.bottomLeft());
+    painter.drawLine(rect.bottomLeft(), rect.bottomRight());
+
+    const CarSnapshot& snapshot = shown.cars[car];
+    if (snapshot.floor == floor) {
+        QRect body = rect.adjusted(3, 2, -3, -2);
+        painter.fillRect(body, CarColor(snapshot));
+        painter.setPen(QColor(68, 68, 68));
+        painter.drawRect(body);
+        const char* mark = snapshot.direction == Direction::Up ? "▲" : snapshot.direction == Direction::Down ? "▼" : "";
+        painter.drawText(body, Qt::AlignCenter, QString::fromUtf8(mark));
+    }
+    else if (snapshot.targets.Test(floor)) {
+        // 内选楼层
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::red);
+        painter.drawEllipse(rect.center(), 4, 4);
+        painter.setBrush(Qt::NoBrush);
+    }
+}
+
+void ShaftView::mousePressEvent(QMouseEvent* event)
+{
+    const QPoint pos = event->position().toPoint();
+    if (pos.y() < 0 || pos.y() >= floor_count * RowHeight) return;
+    const int floor = FloorAt(pos.y());
+    const int car = CarAt(pos.x());
+    if (car >= 0) {
+        if (served[car].Test(floor))
+            emit CarCallClicked(car, floor);
+        return;
+    }
+    if (pos.x() < LabelWidth) return;
+    if (destination_dispatch) {
+        emit FloorClicked(floor);
+        return;
+    }
+    if (pos.x() < LabelWidth + HallWidth / 2) {
+        if (floor != floor_count - 1) emit HallCallClicked(floor, Direction::Up);
+    }
+    else if (floor != 0) {
+        emit HallCallClicked(floor, Direction::Down);
+    }
+}
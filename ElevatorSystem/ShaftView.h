@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <QWidget>
+#include <vector>
+#include <Utilities.h>
+#include "SimulationThread.h"
+
+class QPainter;
+
+// 楼宇井道视图: 左侧为各层候梯厅按钮, 右侧每列一部电梯, 显示轿厢位置和内选楼层
+// 全部内容由QPainter绘制, 不为楼层或电梯创建子控件; 点击位置换算为(楼层, 电梯)
+// 只重绘发生变化的格子, 绘制时只遍历可见区域内的行和列
+class ShaftView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    ShaftView(int elevator_count, int floor_count, bool destination_dispatch, QWidget* parent = nullptr);
+public:
+    void ApplySnapshot(const GroupSnapshot& snapshot);
+    void SetAssignedCar(int floor, int car); // 目的层派梯结果, car从1开始
+    void SetServedFloors(int car, const FloorMask& floors); // 分区时不停靠的格子显示为灰色, 点击无效
+    QSize sizeHint() const override;
+signals:
+    void HallCallClicked(int floor, Direction dir);
+    void CarCallClicked(int car, int floor); // car从0开始
+    void FloorClicked(int floor);            // 目的层派梯模式下点击候梯厅
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+private:
+    int RowTop(int floor) const { return (floor_count - 1 - floor) * RowHeight; } // 顶层在最上方
+    int FloorAt(int y) const;
+    int CarAt(int x) const;                                      // 不在井道列返回-1
+    QRect CellRect(int car, int floor) const;
+    QRect HallRect(int floor) const;
+    void PaintHall(QPainter& painter, int floor);
+    void PaintCell(QPainter& painter, int car, int floor);
+
+public:
+    static const int RowHeight = 22;
+    static const int LabelWidth = 34;   // 楼层号
+    static const int HallWidth = 40;    // 上/下行按钮(目的层派梯时为分配结果)
+    static const int ShaftWidth = 26;
+private:
+    const int elevator_count;
+    const int floor_count;
+    const bool destination_dispatch;
+    GroupSnapshot shown;           // 当前显示的状态
+    std::vector<int> assigned_car; // 各层最近一次目的层派梯结果, 0为无
+    std::vector<FloorMask> served; // 各电梯的服务楼层
+};
@@ -0,0 +1,316 @@
+﻿#include "SharedTelemetry.h"
+#include <algorithm>
+#include <new>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    static_assert(sizeof(TelemetryHeader) == 64, "TelemetryHeader的布局是协议的一部分");
+    static_assert(sizeof(TelemetryCar) == 64, "TelemetryCar的布局是协议的一部分");
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free
+        && std::atomic<std::uint8_t>::is_always_lock_free, "跨进程共享的原子变量必须无锁");
+    static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t), "位图按u64数组读写");
+
+    const std::uint8_t OutOfServiceFlag = 1;
+    const std::uint8_t StalledFlag = 2;
+
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    std::atomic<std::uint64_t>* Masks(TelemetryCar& car)
+    {
+        return reinterpret_cast<std::atomic<std::uint64_t>*>(&car + 1);
+    }
+
+    const std::atomic<std::uint64_t>* Masks(const TelemetryCar& car)
+    {
+        return reinterpret_cast<const std::atomic<std::uint64_t>*>(&car + 1);
+    }
+
+    template <typename T>
+    void Store(std::atomic<T>& field, T value)
+    {
+        field.store(value, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    T Load(const std::atomic<T>& field)
+    {
+        return field.load(std::memory_order_relaxed);
+    }
+}
+
+#if defined(_WIN32)
+bool SharedMemory::Create(const std::string& name, size_t bytes)
+{
+    Close();
+    path = "Local\\" + name;
+    unsigned long long size64 = bytes;
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), path.c_str());
+    if (!mapping) return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) { // 另一个进程正在使用同名对象
+        CloseHandle(mapping);
+        return false;
+    }
+    data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!data) {
+        CloseHandle(mapping);
+        return false;
+    }
+    handle = mapping;
+    size = bytes;
+    owner = true;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name)
+{
+    Close();
+    path = "Local\\" + name;
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path.c_str());
+    if (!mapping) return false;
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (!data || VirtualQuery(data, &info, sizeof(info)) == 0) {
+        Close();
+        CloseHandle(mapping);
+        return false;
+    }
+    handle = mapping;
+    size = info.RegionSize;
+    return true;
+}
+
+void SharedMemory::Close()
+{
+    if (data) UnmapViewOfFile(data);
+    if (handle) CloseHandle(static_cast<HANDLE>(handle)); // 最后一个句柄关闭后对象随之消失
+    data = nullptr;
+    handle = nullptr;
+    size = 0;
+    owner = false;
+}
+#else
+bool SharedMemory::Create(const std::string& name, size_t bytes)
+{
+    Close();
+    path = "/" + name;
+    shm_unlink(path.c_str()); // 上次异常退出留下的对象
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return false;
+    void* mapped = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+        mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // 映射保持有效
+    if (mapped == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        return false;
+    }
+    data = mapped;
+    size = bytes;
+    owner = true;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name)
+{
+    Close();
+    path = "/" + name;
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    data = mapped;
+    size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void SharedMemory::Close()
+{
+    if (data) munmap(data, size);
+    if (owner) shm_unlink(path.c_str()); // 已映射的读者继续可读, 新读者打不开
+    data = nullptr;
+    size = 0;
+    owner = false;
+}
+#endif
+
+const char* const TelemetryWriter::DefaultName = "elevator-telemetry";
+
+bool TelemetryWriter::Open(const std::string& name, int elevator_count, int floor_count)
+{
+    Close();
+    mask_words = (floor_count + 63) / 64;
+    size_t stride = AlignUp(sizeof(TelemetryCar) + 3 * mask_words * sizeof(std::uint64_t), 64);
+    if (!memory.Create(name, sizeof(TelemetryHeader) + elevator_count * stride)) return false;
+
+    // 映射的内容已清零, 这里开始各原子变量的生存期
+    char* base = static_cast<char*>(memory.Data());
+    TelemetryHeader* header = new (base) TelemetryHeader();
+    for (int i = 0; i < elevator_count; ++i) {
+        TelemetryCar* car = new (base + sizeof(TelemetryHeader) + i * stride) TelemetryCar();
+        std::atomic<std::uint64_t>* words = Masks(*car);
+        for (int w = 0; w < 3 * mask_words; ++w)
+            new (words + w) std::atomic<std::uint64_t>(0);
+    }
+    header->version = TelemetryHeader::LayoutVersion;
+    header->car_count = static_cast<std::uint32_t>(elevator_count);
+    header->floor_count = static_cast<std::uint32_t>(floor_count);
+    header->mask_words = static_cast<std::uint32_t>(mask_words);
+    header->car_offset = sizeof(TelemetryHeader);
+    header->car_stride = static_cast<std::uint32_t>(stride);
+    header->magic.store(TelemetryHeader::Magic, std::memory_order_release);
+
+    current = Shadow();
+    current.masks.assign(3 * mask_words, 0);
+    shadows.assign(elevator_count, current); // 与current交换使用, 位图长度相同
+    return true;
+}
+
+TelemetryCar& TelemetryWriter::Car(int index) const
+{
+    const TelemetryHeader& header = Header();
+    return *reinterpret_cast<TelemetryCar*>(static_cast<char*>(memory.Data()) + header.car_offset + index * header.car_stride);
+}
+
+void TelemetryWriter::Publish(const ElevatorGroup& group, const MetricsCollector& metrics, TimerService::Time now)
+{
+    if (!IsOpen()) return;
+    int count = std::min(group.GetElevatorCount(), static_cast<int>(shadows.size()));
+    for (int i = 0; i < count; ++i) {
+        const ElevatorCar& car = group.GetCar(i);
+        const CarHealth& health = group.GetHealth(i);
+        current.valid = true;
+        current.floor = car.GetCurrentFloor();
+        current.state = static_cast<std::uint8_t>(car.GetState());
+        current.direction = static_cast<std::uint8_t>(car.GetDirection());
+        current.flags = static_cast<std::uint8_t>((health.out_of_service ? OutOfServiceFlag : 0) | (health.stalled ? StalledFlag : 0));
+        current.load = car.GetLoad();
+        current.counters = metrics.GetCarCounters(i);
+        const FloorMask* masks[3] = { &car.GetInternalTargets(), &car.GetExternalRequests(Direction::Up),
+            &car.GetExternalRequests(Direction::Down) };
+        for (int m = 0; m < 3; ++m)
+            for (int w = 0; w < mask_words; ++w)
+                current.masks[m * mask_words + w] = w < masks[m]->WordCount() ? masks[m]->Word(w) : 0;
+
+        Shadow& shadow = shadows[i];
+        if (shadow.valid && shadow.floor == current.floor && shadow.state == current.state
+            && shadow.direction == current.direction && shadow.flags == current.flags && shadow.load == current.load
+            && shadow.counters == current.counters && shadow.masks == current.masks)
+            continue;
+        std::swap(shadow, current);
+
+        // seqlock: 奇数期间读者重试; 前一个release屏障保证读者看到新数据时也看到奇数序号
+        TelemetryCar& block = Car(i);
+        std::uint32_t sequence = Load(block.sequence);
+        Store(block.sequence, sequence + 1);
+        std::atomic_thread_fence(std::memory_order_release);
+        Store<std::int32_t>(block.floor, shadow.floor);
+        Store(block.state, shadow.state);
+        Store(block.direction, shadow.direction);
+        Store(block.flags, shadow.flags);
+        Store<std::int32_t>(block.load, shadow.load);
+        Store<std::int64_t>(block.updated_ms, now);
+        Store(block.door_cycles, shadow.counters.door_cycles);
+        Store(block.stops, shadow.counters.stops);
+        Store(block.trips, shadow.counters.trips);
+        Store(block.reversals, shadow.counters.reversals);
+        Store(block.full_bypasses, shadow.counters.full_bypasses);
+        std::atomic<std::uint64_t>* words = Masks(block);
+        for (int w = 0; w < 3 * mask_words; ++w)
+            Store(words[w], shadow.masks[w]);
+        block.sequence.store(sequence + 2, std::memory_order_release);
+    }
+    TelemetryHeader& header = Header();
+    Store<std::int64_t>(header.now_ms, now);
+    Store<std::uint64_t>(header.publishes, Load(header.publishes) + 1);
+}
+
+bool TelemetryReader::Open(const std::string& name)
+{
+    if (!memory.Open(name) || memory.Size() < sizeof(TelemetryHeader)) {
+        Close();
+        return false;
+    }
+    const TelemetryHeader& header = Header();
+    if (header.magic.load(std::memory_order_acquire) != TelemetryHeader::Magic || header.version != TelemetryHeader::LayoutVersion
+        || header.car_stride < sizeof(TelemetryCar) + 3 * header.mask_words * sizeof(std::uint64_t)
+        || header.car_offset + static_cast<size_t>(header.car_count) * header.car_stride > memory.Size()) {
+        Close();
+        return false;
+    }
+    car_count = static_cast<int>(header.car_count);
+    floor_count = static_cast<int>(header.floor_count);
+    mask_words = static_cast<int>(header.mask_words);
+    car_offset = header.car_offset;
+    car_stride = header.car_stride;
+    return true;
+}
+
+TimerService::Time TelemetryReader::GetNow() const
+{
+    return memory.Data() ? Load(Header().now_ms) : 0;
+}
+
+std::uint64_t TelemetryReader::GetPublishCount() const
+{
+    return memory.Data() ? Load(Header().publishes) : 0;
+}
+
+bool TelemetryReader::Read(int index, TelemetryCarState& state, int max_retries) const
+{
+    if (!memory.Data() || index < 0 || index >= car_count) return false;
+    const TelemetryCar& block = *reinterpret_cast<const TelemetryCar*>(
+        static_cast<const char*>(memory.Data()) + car_offset + index * car_stride);
+    const std::atomic<std::uint64_t>* words = Masks(block);
+    state.internal_targets.resize(mask_words);
+    state.up_requests.resize(mask_words);
+    state.down_requests.resize(mask_words);
+
+    for (int attempt = 0; attempt < max_retries; ++attempt) {
+        std::uint32_t before = block.sequence.load(std::memory_order_acquire);
+        if (before & 1) continue; // 正在写
+        state.floor = Load(block.floor);
+        std::uint8_t flags = Load(block.flags);
+        state.state = static_cast<ElevatorState>(Load(block.state));
+        state.direction = static_cast<Direction>(Load(block.direction));
+        state.out_of_service = (flags & OutOfServiceFlag) != 0;
+        state.stalled = (flags & StalledFlag) != 0;
+        state.load = Load(block.load);
+        state.updated_ms = Load(block.updated_ms);
+        state.counters.door_cycles = Load(block.door_cycles);
+        state.counters.stops = Load(block.stops);
+        state.counters.trips = Load(block.trips);
+        state.counters.reversals = Load(block.reversals);
+        state.counters.full_bypasses = Load(block.full_bypasses);
+        for (int w = 0; w < mask_words; ++w) {
+            state.internal_targets[w] = Load(words[w]);
+            state.up_requests[w] = Load(words[mask_words + w]);
+            state.down_requests[w] = Load(words[2 * mask_words + w]);
+        }
+        // 数据读完后再确认序号没变, acquire屏障保证上面的读不会排到这次读之后
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (block.sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Metrics.h"
+#include "TimerService.h"
+#include "Utilities.h"
+
+// 命名共享内存的映射: Linux上为POSIX共享内存(/dev/shm下的对象), Windows上为分页文件支持的文件映射
+class SharedMemory
+{
+public:
+    SharedMemory() {}
+    ~SharedMemory() { Close(); }
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+public:
+    bool Create(const std::string& name, size_t size); // 读写映射, 内容清零; 同名的旧对象先删除, 已映射它的读者不受影响
+    bool Open(const std::string& name);                 // 只读映射已有的对象
+    void Close();                                       // 创建者关闭时同时删除名字
+    void* Data() const { return data; }
+    size_t Size() const { return size; }
+private:
+    void* data = nullptr;
+    size_t size = 0;
+    std::string path;
+    bool owner = false;
+    void* handle = nullptr; // Windows的映射句柄
+};
+
+// 共享内存中的遥测布局, 整数均为本机字节序, 各字段按自然边界对齐:
+//   TelemetryHeader(64字节) | 每部电梯一块, 每块car_stride字节(64字节对齐):
+//     TelemetryCar(64字节) | 内选位图 | 上行外呼位图 | 下行外呼位图, 每个位图mask_words个u64, 第f层为第f/64个字的第f%64位
+// 每块各有一个seqlock: 写入前sequence加1(奇数表示正在写), 写完再加1; 读者前后两次读到相同的偶数即为一致的数据
+// 只有模拟线程写入, 读者只读映射, 不加锁, 任意多个进程可以同时读
+struct TelemetryHeader {
+    static const std::uint32_t Magic = 0x54564C45; // "ELVT"
+    static const std::uint32_t LayoutVersion = 1;
+    std::atomic<std::uint32_t> magic;     // 其余字段填好后最后写入
+    std::uint32_t version;
+    std::uint32_t car_count;
+    std::uint32_t floor_count;
+    std::uint32_t mask_words;
+    std::uint32_t car_offset;             // 第一块的偏移
+    std::uint32_t car_stride;
+    std::uint32_t reserved;
+    std::atomic<std::int64_t> now_ms;     // 最近一次发布的虚拟时间
+    std::atomic<std::uint64_t> publishes; // 发布次数
+    std::uint8_t padding[16];
+};
+
+struct TelemetryCar {
+    std::atomic<std::uint32_t> sequence;
+    std::atomic<std::int32_t> floor;
+    std::atomic<std::uint8_t> state;      // ElevatorState的序号
+    std::atomic<std::uint8_t> direction;  // Direction的序号
+    std::atomic<std::uint8_t> flags;      // 1停用 2卡滞
+    std::atomic<std::uint8_t> reserved;
+    std::atomic<std::int32_t> load;       // 轿厢内人数
+    std::atomic<std::int64_t> updated_ms; // 本块最近一次更新的虚拟时间
+    std::atomic<std::uint64_t> door_cycles;
+    std::atomic<std::uint64_t> stops;
+    std::atomic<std::uint64_t> trips;
+    std::atomic<std::uint64_t> reversals;
+    std::atomic<std::uint64_t> full_bypasses;
+};
+
+// 读者取出的一部电梯的一致状态, 位图按楼层数复用, 稳定后不再分配内存
+struct TelemetryCarState {
+    int floor = 0;
+    ElevatorState state = ElevatorState::Idle;
+    Direction direction = Direction::None;
+    bool out_of_service = false;
+    bool stalled = false;
+    int load = 0;
+    TimerService::Time updated_ms = 0;
+    MetricsCollector::CarCounters counters;
+    std::vector<std::uint64_t> internal_targets;
+    std::vector<std::uint64_t> up_requests;
+    std::vector<std::uint64_t> down_requests;
+};
+
+// 写端, 由模拟线程持有: 每次发布只重写状态有变化的电梯块, 不分配内存、不做系统调用
+class TelemetryWriter
+{
+public:
+    static const char* const DefaultName;
+    TelemetryWriter() {}
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+public:
+    bool Open(const std::string& name, int elevator_count, int floor_count);
+    void Close() { memory.Close(); shadows.clear(); }
+    bool IsOpen() const { return memory.Data() != nullptr; }
+    void Publish(const ElevatorGroup& group, const MetricsCollector& metrics, TimerService::Time now);
+private:
+    // 上次写入的内容, 用于跳过没有变化的电梯
+    struct Shadow {
+        bool valid = false;
+        int floor = 0;
+        std::uint8_t state = 0;
+        std::uint8_t direction = 0;
+        std::uint8_t flags = 0;
+        int load = 0;
+        MetricsCollector::CarCounters counters;
+        std::vector<std::uint64_t> masks; // 内选 | 上行外呼 | 下行外呼
+    };
+    TelemetryHeader& Header() const { return *static_cast<TelemetryHeader*>(memory.Data()); }
+    TelemetryCar& Car(int index) const;
+
+private:
+    SharedMemory memory;
+    std::vector<Shadow> shadows;
+    Shadow current; // 每次复用
+    int mask_words = 0;
+};
+
+// 读端, 供监控面板、记录程序等其他进程使用
+class TelemetryReader
+{
+public:
+    bool Open(const std::string& name = TelemetryWriter::DefaultName); // 布局版本不符或尚未写好时返回false
+    void Close() { memory.Close(); }
+    int GetCarCount() const { return car_count; }
+    int GetFloorCount() const { return floor_count; }
+    TimerService::Time GetNow() const;
+    std::uint64_t GetPublishCount() const;
+    // 取index号电梯(从0开始)的一致状态; 连续max_retries次遇到写入中途时返回false
+    bool Read(int index, TelemetryCarState& state, int max_retries = 1000) const;
+private:
+    const TelemetryHeader& Header() const { return *static_cast<const TelemetryHeader*>(memory.Data()); }
+
+private:
+    SharedMemory memory;
+    int car_count = 0;
+    int floor_count = 0;
+    int mask_words = 0;
+    size_t car_offset = 0;
+    size_t car_stride = 0;
+};
@@ -0,0 +1,192 @@
+﻿#include "Simulation.h"
+#include "Checkpoint.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    void SaveConfig(CheckpointWriter& writer, const SimulationConfig& config)
+    {
+        writer.Put(CheckpointTag("CONF"));
+        writer.Put<std::int32_t>(config.elevator_count);
+        writer.Put<std::int32_t>(config.floor_count);
+        writer.Put(config.profile);
+        writer.Put(config.passengers_per_minute);
+        writer.Put(config.duration_ms);
+        writer.Put(config.seed);
+        writer.Put(config.dispatch_mode);
+        writer.Put<std::int32_t>(config.timing.move_ms);
+        writer.Put<std::int32_t>(config.timing.open_ms);
+        writer.Put<std::int32_t>(config.timing.stay_open_ms);
+        writer.Put<std::int32_t>(config.timing.close_ms);
+        writer.Put<std::int32_t>(config.timing.alarm_ms);
+        writer.Put<std::int32_t>(config.timing.capacity);
+        writer.Put<std::int32_t>(config.timing.transfer_ms);
+        writer.Put(config.timing.rated_speed);
+        writer.Put(config.timing.acceleration);
+        writer.Put(config.timing.jerk);
+        writer.Put(config.timing.floor_height);
+        writer.Put(config.timing.lobby_height);
+        writer.Put(config.zoning);
+        writer.Put<std::int32_t>(config.banks);
+        writer.Put<std::int32_t>(config.lookahead_ms);
+        writer.Put<std::int32_t>(config.lookahead_iterations);
+        writer.Put<std::int32_t>(config.batch_window_ms);
+    }
+
+    bool LoadConfig(CheckpointReader& reader, SimulationConfig& config)
+    {
+        if (!reader.Expect(CheckpointTag("CONF"))) return false;
+        config.elevator_count = reader.Get<std::int32_t>();
+        config.floor_count = reader.Get<std::int32_t>();
+        config.profile = reader.Get<TrafficProfile>();
+        config.passengers_per_minute = reader.Get<double>();
+        config.duration_ms = reader.Get<TimerService::Time>();
+        config.seed = reader.Get<std::uint64_t>();
+        config.dispatch_mode = reader.Get<DispatchMode>();
+        config.timing.move_ms = reader.Get<std::int32_t>();
+        config.timing.open_ms = reader.Get<std::int32_t>();
+        config.timing.stay_open_ms = reader.Get<std::int32_t>();
+        config.timing.close_ms = reader.Get<std::int32_t>();
+        config.timing.alarm_ms = reader.Get<std::int32_t>();
+        config.timing.capacity = reader.Get<std::int32_t>();
+        config.timing.transfer_ms = reader.Get<std::int32_t>();
+        config.timing.rated_speed = reader.Get<double>();
+        config.timing.acceleration = reader.Get<double>();
+        config.timing.jerk = reader.Get<double>();
+        config.timing.floor_height = reader.Get<double>();
+        config.timing.lobby_height = reader.Get<double>();
+        config.zoning = reader.Get<ZoningMode>();
+        config.banks = reader.Get<std::int32_t>();
+        config.lookahead_ms = reader.Get<std::int32_t>();
+        config.lookahead_iterations = reader.Get<std::int32_t>();
+        config.batch_window_ms = reader.Get<std::int32_t>();
+        return reader.Ok();
+    }
+
+    LookaheadSettings LookaheadFor(const SimulationConfig& config)
+    {
+        LookaheadSettings settings;
+        settings.period_ms = config.lookahead_ms;
+        settings.max_iterations = config.lookahead_iterations;
+        return settings; // 不限真实时间, 结果可复现
+    }
+
+    bool SameConfig(const SimulationConfig& a, const SimulationConfig& b)
+    {
+        return a.elevator_count == b.elevator_count && a.floor_count == b.floor_count
+            && a.profile == b.profile && a.passengers_per_minute == b.passengers_per_minute
+            && a.duration_ms == b.duration_ms && a.seed == b.seed && a.dispatch_mode == b.dispatch_mode
+            && a.timing.move_ms == b.timing.move_ms && a.timing.open_ms == b.timing.open_ms
+            && a.timing.stay_open_ms == b.timing.stay_open_ms && a.timing.close_ms == b.timing.close_ms
+            && a.timing.alarm_ms == b.timing.alarm_ms && a.timing.capacity == b.timing.capacity
+            && a.timing.transfer_ms == b.timing.transfer_ms && a.timing.rated_speed == b.timing.rated_speed
+            && a.timing.acceleration == b.timing.acceleration && a.timing.jerk == b.timing.jerk
+            && a.timing.floor_height == b.timing.floor_height && a.timing.lobby_height == b.timing.lobby_height
+            && a.zoning == b.zoning && a.banks == b.banks
+            && a.lookahead_ms == b.lookahead_ms && a.lookahead_iterations == b.lookahead_iterations
+            && a.batch_window_ms == b.batch_window_ms;
+    }
+}
+
+Simulation::Simulation(const SimulationConfig& config)
+    : config(config),
+    group(config.elevator_count, config.floor_count, scheduler, config.timing),
+    traffic(config.floor_count, config.profile, config.passengers_per_minute, config.duration_ms, config.seed),
+    driver(group, scheduler, traffic),
+    reoptimizer(group, scheduler, LookaheadFor(config), config.seed)
+{
+    group.SetDispatchMode(config.dispatch_mode);
+    group.SetBatchWindow(config.batch_window_ms);
+    group.ApplyZonePlan(ZonePlan::Make(config.zoning, config.elevator_count, config.floor_count, config.banks));
+    group.AddObserver(&kpi);
+}
+
+Simulation::~Simulation()
+{
+    if (recorder)
+        recorder->Detach(group);
+}
+
+void Simulation::EnableFlightRecorder(const std::string& alarm_dump_path)
+{
+    if (!recorder) {
+        recorder.reset(new FlightRecorder(config.elevator_count, scheduler));
+        recorder->Attach(group);
+    }
+    recorder->SetAlarmDumpPath(alarm_dump_path);
+}
+
+KpiReport Simulation::Run()
+{
+    auto start = std::chrono::steady_clock::now();
+    Start();
+    scheduler.RunAll();
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    KpiReport report = kpi.Report(group);
+    report.simulated_ms = scheduler.Now();
+    report.wall_ms = wall_ms;
+    report.events = scheduler.ExecutedCount();
+    return report;
+}
+
+void Simulation::RunUntil(TimerService::Time time)
+{
+    Start();
+    scheduler.RunUntil(time);
+}
+
+void Simulation::Start()
+{
+    if (started) return;
+    started = true;
+    driver.Start();
+}
+
+// 检查点内容: 配置 | 时钟 | 电梯组 | 交通流 | 指标
+// 各模块的待执行定时只保存编号和到期时间, 恢复时按原编号顺序重新调度
+bool Simulation::SaveCheckpoint(const std::string& path) const
+{
+    CheckpointWriter writer;
+    SaveConfig(writer, config);
+    writer.Put(CheckpointTag("SIM "));
+    writer.Put(scheduler.Now());
+    writer.Put(scheduler.ExecutedCount());
+    writer.Put(started);
+    group.SaveState(writer);
+    if (!driver.SaveState(writer)) return false;
+    kpi.SaveState(writer);
+    reoptimizer.SaveState(writer);
+    return writer.SaveToFile(path);
+}
+
+bool Simulation::LoadCheckpoint(const std::string& path)
+{
+    CheckpointReader reader;
+    SimulationConfig saved;
+    if (!CheckpointReader::LoadFile(path, reader) || !LoadConfig(reader, saved) || !SameConfig(saved, config))
+        return false;
+    if (!reader.Expect(CheckpointTag("SIM "))) return false;
+    TimerService::Time now = reader.Get<TimerService::Time>();
+    std::uint64_t executed = reader.Get<std::uint64_t>();
+    bool was_started = reader.Get<bool>();
+    if (!reader.Ok()) return false;
+
+    scheduler.Restore(now, executed);
+    std::vector<PendingTimer> pending;
+    if (!group.LoadState(reader, pending) || !driver.LoadState(reader, pending) || !kpi.LoadState(reader)
+        || !reoptimizer.LoadState(reader, pending) || !reader.AtEnd())
+        return false;
+    std::sort(pending.begin(), pending.end(),
+        [](const PendingTimer& a, const PendingTimer& b) { return a.id < b.id; });
+    for (const PendingTimer& timer : pending)
+        timer.resume();
+    started = was_started;
+    return true;
+}
+
+bool Simulation::ReadCheckpointConfig(const std::string& path, SimulationConfig& config)
+{
+    CheckpointReader reader;
+    return CheckpointReader::LoadFile(path, reader) && LoadConfig(reader, config);
+}
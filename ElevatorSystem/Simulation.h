@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "ElevatorGroup.h"
+#include "EventScheduler.h"
+#include "FlightRecorder.h"
+#include "Kpi.h"
+#include "LookaheadOptimizer.h"
+#include "Workload.h"
+
+// 一次无界面模拟的参数
+struct SimulationConfig {
+    // 命令行接受的上限: 交通流的OD矩阵为楼层数²个double(两份), 1000层约16MB
+    static const int MaxFloorCount = 1000;
+    static const int MaxElevatorCount = 256;
+
+    int elevator_count = 5;
+    int floor_count = 20;
+    TrafficProfile profile = TrafficProfile::UpPeak;
+    double passengers_per_minute = 10.0;
+    TimerService::Time duration_ms = 3600 * 1000; // 乘客到达的时间段, 之后运行到全部送达
+    std::uint64_t seed = 1;
+    DispatchMode dispatch_mode = DispatchMode::Collective;
+    CarTiming timing;
+    ZoningMode zoning = ZoningMode::None;
+    int banks = 1; // ZoningMode::Banks的分组数
+    int lookahead_ms = 0;            // >0时按此周期重新优化外呼分配(仅集选控制)
+    int lookahead_iterations = 2000; // 每次优化的迭代上限
+    int batch_window_ms = 0;         // >0时同一窗口内的外呼联合派梯(仅集选控制)
+};
+
+// 无界面模拟: 事件调度器 + 电梯组 + 交通流 + 指标收集
+// 相同配置的模拟结果逐位相同; 检查点保存全部状态, 恢复后继续运行与不中断运行的结果一致
+class Simulation
+{
+public:
+    explicit Simulation(const SimulationConfig& config);
+    ~Simulation();
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+public:
+    KpiReport Run(); // 从当前状态运行到事件队列为空
+    void RunUntil(TimerService::Time time); // 快进到虚拟时间time
+    bool SaveCheckpoint(const std::string& path) const;
+    bool LoadCheckpoint(const std::string& path); // 配置必须与保存时一致, 失败后本对象应丢弃
+    // 开启飞行记录, 报警时立即导出到alarm_dump_path; 在Run之前调用. 记录不属于检查点, 恢复后从空记录开始
+    void EnableFlightRecorder(const std::string& alarm_dump_path);
+    const FlightRecorder* GetFlightRecorder() const { return recorder.get(); }
+    static bool ReadCheckpointConfig(const std::string& path, SimulationConfig& config); // 用于按检查点构造模拟
+    const SimulationConfig& GetConfig() const { return config; }
+    EventScheduler& GetScheduler() { return scheduler; }
+    ElevatorGroup& GetGroup() { return group; }
+    KpiCollector& GetKpi() { return kpi; }
+    const PeriodicReoptimizer& GetReoptimizer() const { return reoptimizer; }
+private:
+    void Start(); // 首次运行时开始注入乘客
+private:
+    SimulationConfig config;
+    EventScheduler scheduler;
+    ElevatorGroup group;
+    TrafficGenerator traffic;
+    WorkloadDriver driver;
+    KpiCollector kpi;
+    PeriodicReoptimizer reoptimizer;
+    std::unique_ptr<FlightRecorder> recorder; // 默认不开启, 批量模拟不承担记录开销
+    bool started = false;
+};
@@ -1,10 +1,15 @@
 ﻿#include "SimulationMainWindow.h"
 #include <ElevatorDisplayWindow.h>
-#include <QButtonGroup>
 #include <QMessageBox>
 #include <QDebug>
 #include <climits>
 
+namespace {
+    const int MetricsDumpMs = 10000;
+    const char* MetricsFile = "metrics.prom";
+    const char* FlightRecorderFile = "flight_recorder.bin";
+}
+
 SimulationMainWindow::SimulationMainWindow(ElevatorSystem* elevatorSystem, QWidget* parent)
     : QWidget(parent, Qt::Window), elevatorSystem(elevatorSystem)
 {
@@ -12,6 +17,13 @@ SimulationMainWindow::SimulationMainWindow(ElevatorSystem* elevatorSystem, QWidg
     Init(elevatorSystem->GetElevatorCount(), elevatorSystem->GetFloorCount());
 }
 
+SimulationMainWindow::~SimulationMainWindow()
+{
+    // 先停止模拟线程, 再销毁读取快照的电梯面板
+    simulation->Stop();
+    delete elevatorWindow;
+}
+
 void SimulationMainWindow::Init(int elevator_count, int floor_count)
 {
     setWindowTitle("电梯模拟器 Elevator Simulator");
@@ -20,268 +32,169 @@ void SimulationMainWindow::Init(int elevator_count, int floor_count)
     this->setFixedSize(window_width, window_height);
     move(1200, 300);
 
-    floorButtonStates.resize(floor_count);
-    for (auto& state : floorButtonStates) {
-        state.upPressed = false;
-        state.downPressed = false;
-        state.upDirection = Direction::None;
-        state.downDirection = Direction::None;
-    }
+    simulation.reset(new SimulationThread(elevator_count, floor_count));
+    simulation->SetDispatchMode(elevatorSystem->IsDestinationDispatch() ? DispatchMode::Destination : DispatchMode::Collective);
+    simulation->SetZonePlan(ZonePlan::Make(elevatorSystem->GetZoning(), elevator_count, floor_count, ElevatorSystem::BankCount));
     InitWidget();
     CreateElevatorWinodws();
+
+    // 报警时由模拟线程当场导出飞行记录, 不依赖报警通知能否到达界面
+    simulation->SetAlarmDumpPath(FlightRecorderFile);
+
+    // 各电梯的状态同时发布到共享内存, 本机的监控和记录进程用TelemetryReader直接读取
+    if (!simulation->ExportTelemetry())
+        qDebug() << "telemetry shared memory unavailable:" << TelemetryWriter::DefaultName;
+
+    // 模拟线程以真实时间1倍速运行, 界面每16ms取一次最新快照
+    simulation->Start();
+    frame_timer = new QTimer(this);
+    frame_timer->setTimerType(Qt::PreciseTimer);
+    connect(frame_timer, &QTimer::timeout, this, &SimulationMainWindow::RefreshFrame);
+    frame_timer->start(16);
+
+    // 指标经本机HTTP端点和定期导出的文件提供给监控面板, 两者都只读模拟线程维护的计数
+    metrics_server = new MetricsServer(simulation->GetMetrics(), this);
+    if (!metrics_server->Listen())
+        qDebug() << "metrics endpoint unavailable on port" << MetricsServer::DefaultPort;
+    // 外部系统经本机控制端口直接向模拟线程提交命令, 与界面按钮走同一条命令队列
+    control_server = new ControlServer(*simulation, this);
+    if (!control_server->Listen())
+        qDebug() << "control endpoint unavailable on port" << ControlServer::DefaultPort << "and socket" << ControlServer::DefaultName;
+    metrics_timer = new QTimer(this);
+    connect(metrics_timer, &QTimer::timeout, this, [=]() { simulation->GetMetrics().WriteFile(MetricsFile); });
+    metrics_timer->start(MetricsDumpMs);
+    connect(this, &SimulationMainWindow::windowClosed, this, [=]() {
+        metrics_timer->stop();
+        metrics_server->Close();
+        control_server->Close();
+    });
+}
+
+void SimulationMainWindow::RefreshFrame()
+{
+    const GroupSnapshot& snapshot = simulation->ReadSnapshot();
+    if (snapshot.version != shown_version) {
+        shown_version = snapshot.version;
+        shaft_view->ApplySnapshot(snapshot);
+        elevatorWindow->ApplySnapshot(snapshot);
+    }
+    SimEvent event;
+    while (simulation->PollEvent(event)) {
+        if (event.type == SimEvent::Type::Alarm)
+            OnCarAlarm(event.car);
+        else if (event.type == SimEvent::Type::DestinationAssigned)
+            OnDestinationAssigned(event);
+    }
+}
+
+void SimulationMainWindow::PostHallCall(int floor, Direction dir)
+{
+    SimCommand command;
+    command.type = SimCommand::Type::HallCall;
+    command.floor = floor;
+    command.dir = dir;
+    simulation->Post(command);
 }
 
 void SimulationMainWindow::InitWidget()
 {
-    QScrollArea* mainScrollArea = new QScrollArea(this);
-    QWidget* containerWidget = new QWidget(mainScrollArea);
-    QVBoxLayout* containerLayout = new QVBoxLayout(containerWidget);
-    containerLayout->setAlignment(Qt::AlignTop);
+    const bool destination_dispatch = elevatorSystem->IsDestinationDispatch();
+    int top = 0;
+    if (destination_dispatch) {
+        // 目的层派梯: 点击楼层选择出发层, 输入目的层后呼梯, 分配结果显示在楼层旁
+        QWidget* callWidget = new QWidget(this);
+        QHBoxLayout* callLayout = new QHBoxLayout(callWidget);
+        callLayout->setContentsMargins(10, 5, 10, 5);
+        origin_box = new QSpinBox(callWidget);
+        origin_box->setRange(1, elevatorSystem->GetFloorCount());
+        origin_box->setPrefix("从 ");
+        dest_box = new QSpinBox(callWidget);
+        dest_box->setRange(1, elevatorSystem->GetFloorCount());
+        dest_box->setValue(elevatorSystem->GetFloorCount());
+        dest_box->setPrefix("到 ");
+        QPushButton* go_button = new QPushButton("呼梯", callWidget);
+        connect(go_button, &QPushButton::clicked, this, [=]() {
+            SimCommand command;
+            command.type = SimCommand::Type::Passenger;
+            command.floor = origin_box->value() - 1;
+            command.target = dest_box->value() - 1;
+            simulation->Post(command);
+        });
+        assignment_label = new QLabel(callWidget);
+        callLayout->addWidget(origin_box);
+        callLayout->addWidget(dest_box);
+        callLayout->addWidget(go_button);
+        callLayout->addWidget(assignment_label, 1);
+        callWidget->setGeometry(0, 0, window_width, 40);
+        top = 40;
+    }
 
     stop_simulation_btn = new QPushButton("停止模拟", this);
     stop_simulation_btn->setGeometry(window_width / 2 - 50, window_height - 50, 100, 40);
     connect(stop_simulation_btn, &QPushButton::clicked, this, &SimulationMainWindow::close);
     connect(this, &SimulationMainWindow::windowClosed, elevatorSystem, &ElevatorSystem::HandleSimulationClosed);
 
-    // 电梯楼层标签
-    QWidget* elevatorWidget = new QWidget(containerWidget);
-    QGridLayout* elevatorLayout = new QGridLayout(elevatorWidget);
-    elevatorLayout->setSpacing(10);
-    elevator_floor_labels = new QLabel[elevatorSystem->GetElevatorCount()];
-    for (int i = 0; i < elevatorSystem->GetElevatorCount(); ++i) {
-        int row = i / 5;
-        int col = i % 5;
-
-        QLabel* elevator_label = new QLabel(QString("电梯 %1").arg(i + 1), elevatorWidget);
-        elevator_label->setFixedSize(60, 30);
-        elevator_label->setAlignment(Qt::AlignCenter);
-        elevator_label->setStyleSheet("background-color: lightblue; border: 1px solid black;");
-        elevatorLayout->addWidget(elevator_label, row * 2, col);
-
-        elevator_floor_labels[i].setParent(elevatorWidget);
-        elevator_floor_labels[i].setFixedSize(60, 30);
-        elevator_floor_labels[i].setAlignment(Qt::AlignCenter);
-        elevator_floor_labels[i].setStyleSheet("background-color: lightgreen; border: 1px solid black; color: red; border-radius: 10px;");
-        elevator_floor_labels[i].setText(QString::number(1));
-        elevatorLayout->addWidget(&elevator_floor_labels[i], row * 2 + 1, col);
-    }
-
-    // 楼层按钮
-    QWidget* floorWidget = new QWidget(containerWidget);
-    QGridLayout* floorLayout = new QGridLayout(floorWidget);
-    floorLayout->setSpacing(10);
-    for (int i = 0; i < elevatorSystem->GetFloorCount(); ++i) {
-        int row = i / 5;
-        int col = i % 5;
-
-        QLabel* floor_label = new QLabel(QString("楼层 %1").arg(i + 1), floorWidget);
-        floor_label->setFixedSize(60, 30);
-        floor_label->setAlignment(Qt::AlignCenter);
-        floor_label->setStyleSheet("background-color: lightblue; border: 1px solid black;");
-        floorLayout->addWidget(floor_label, row * 2, col);
-
-        QWidget* buttonContainer = new QWidget(floorWidget);
-        QHBoxLayout* buttonLayout = new QHBoxLayout(buttonContainer);
-        buttonLayout->setContentsMargins(0, 0, 0, 0);
-        buttonLayout->setSpacing(3);
-
-        QPushButton* up_button;
-		if (i != elevatorSystem->GetFloorCount() - 1) {
-			up_button = new QPushButton("↑", buttonContainer);
-			up_button->setObjectName(QString("up_%1").arg(i));
-			up_button->setFixedSize(30, 20);
-			up_button->setStyleSheet(
-				"QPushButton {"
-				"   background-color: white;"
-				"   border: 1px solid #666;"
-				"   border-radius: 10px;"
-				"}"
-				"QPushButton:disabled { background-color: red; }"
-			);
-			connect(up_button, &QPushButton::clicked, this, [=]() {
-				if (!HasElevatorStoppedAtFloor(i)) {
-					up_button->setDisabled(true);
-                    floorButtonStates[i].upPressed = true;
-                    floorButtonStates[i].upDirection = Direction::Up;
-				}
-                AssignExternalRequests(i, Direction::Up);
-			});
-			buttonLayout->addWidget(up_button);
-		}
-        
-        QPushButton* down_button;
-        if (i != 0) {
-            down_button = new QPushButton("↓", buttonContainer);
-            down_button->setObjectName(QString("down_%1").arg(i));
-            down_button->setFixedSize(30, 20);
-            down_button->setStyleSheet(
-                "QPushButton {"
-                "   background-color: white;"
-                "   border: 1px solid #666;"
-                "   border-radius: 10px;"
-                "}"
-                "QPushButton:disabled { background-color: red; }"
-            );
-            connect(down_button, &QPushButton::clicked, this, [=]() {
-                if (!HasElevatorStoppedAtFloor(i)) {
-                    down_button->setDisabled(true);
-                    floorButtonStates[i].downPressed = true;
-                    floorButtonStates[i].downDirection = Direction::Down;
-                }
-                AssignExternalRequests(i, Direction::Down);
-            });
-            buttonLayout->addWidget(down_button);
-        }
-        
-
-        buttonContainer->setLayout(buttonLayout);
-        floorLayout->addWidget(buttonContainer, row * 2 + 1, col);
+    // 楼层和井道整体由一个画布绘制, 控件数量与楼层数、电梯数无关
+    QScrollArea* mainScrollArea = new QScrollArea(this);
+    shaft_view = new ShaftView(elevatorSystem->GetElevatorCount(), elevatorSystem->GetFloorCount(), destination_dispatch);
+    for (int car = 0; car < simulation->GetElevatorCount(); ++car)
+        shaft_view->SetServedFloors(car, simulation->GetServedFloors(car));
+    connect(shaft_view, &ShaftView::HallCallClicked, this, &SimulationMainWindow::PostHallCall);
+    connect(shaft_view, &ShaftView::CarCallClicked, this, [=](int car, int floor) {
+        SimCommand command;
+        command.type = SimCommand::Type::CarCall;
+        command.car = car;
+        command.floor = floor;
+        simulation->Post(command);
+    });
+    if (destination_dispatch) {
+        connect(shaft_view, &ShaftView::FloorClicked, this, [=](int floor) {
+            origin_box->setValue(floor + 1);
+        });
     }
-    floorLayout->setVerticalSpacing(5);
-
-    containerLayout->addWidget(elevatorWidget);
-    containerLayout->addWidget(floorWidget);
-
-    mainScrollArea->setWidget(containerWidget);
-    mainScrollArea->setWidgetResizable(true);
-    mainScrollArea->setGeometry(0, 0, window_width, window_height - 60);
-
-    connect(this, &SimulationMainWindow::windowClosed, elevatorSystem, &ElevatorSystem::HandleSimulationClosed);
+    mainScrollArea->setWidget(shaft_view);
+    mainScrollArea->setGeometry(0, top, window_width, window_height - 60 - top);
+    // 窗口显示、滚动范围确定后再滚到底层
+    QTimer::singleShot(0, mainScrollArea, [=]() {
+        mainScrollArea->verticalScrollBar()->setValue(mainScrollArea->verticalScrollBar()->maximum());
+    });
 }
 
 void SimulationMainWindow::CreateElevatorWinodws()
 {
-    ElevatorDisplayWindow* elevatorWindow = new ElevatorDisplayWindow(
+    elevatorWindow = new ElevatorDisplayWindow(
         elevatorSystem->GetElevatorCount(),
         elevatorSystem->GetFloorCount(),
-        elevator_floor_labels,
         this
     );
-    for (auto& elevator : elevators) {
-        connect(elevator, &Elevator::FloorArrived, this, &SimulationMainWindow::HandleFloorArrived);
-        connect(elevator, &Elevator::AlarmTriggered, this, [=](int id) { // 监听报警
-            QMessageBox::warning(
-                this,
-                "电梯报警",
-                QString("电梯 %1 触发紧急报警！").arg(id)
-            );
-        });
-    }
     connect(this, &SimulationMainWindow::windowClosed, elevatorWindow, &ElevatorDisplayWindow::HandleSimulationClosed);
     elevatorWindow->show();
 }
 
 void SimulationMainWindow::CaculateWindowSize(int elevator_count, int floor_count)
 {
-    int elevator_rows = elevator_count / 5;
-    if (elevator_count % 5 != 0) {
-        elevator_rows++;
-    }
-    int floor_rows = (floor_count / 5) * 2;
-    if (floor_count % 5 != 0) {
-        floor_rows += 2;
+    int view_width = ShaftView::LabelWidth + ShaftView::HallWidth + elevator_count * ShaftView::ShaftWidth;
+    window_width = std::min(std::max(20 + 5 * 80, view_width + 30), 1000);
+    window_height = 100 + floor_count * ShaftView::RowHeight;
+    if (elevatorSystem->IsDestinationDispatch()) {
+        window_height += 40;
     }
-    window_width = 20 + 5 * 80;
-    window_height = 100 + elevator_rows * 80 + floor_rows * 40;
-    window_height = std::min(window_height, 500);
+    window_height = std::min(window_height, 700);
     setMinimumSize(window_width, window_height);
 }
 
-void SimulationMainWindow::SetElevatorFloor(int id, int floor)
-{
-    if (id < 1 || id > elevatorSystem->GetElevatorCount()) {
-        qDebug() << "电梯ID不合法";
-        return;
-    }
-    elevator_floor_labels[id - 1].setText(QString::number(floor));
-    elevator_floor_labels[id - 1].repaint();
-}
-
-void SimulationMainWindow::AssignExternalRequests(int floor, Direction dir)
+void SimulationMainWindow::OnCarAlarm(int elevator_id)
 {
-    Elevator* best = nullptr;
-    int min_distance = INT_MAX;
-
-    // 1. 优先空闲电梯
-    for (auto& elevator : elevators) {
-        if (elevator->GetState() == ElevatorState::Idle) {
-            int dist = abs(elevator->GetCurrentFloor() - floor);
-            if (dist < min_distance) {
-				qDebug() << "电梯" << elevator->GetElevatorID() << "空闲，距离" << dist;
-                min_distance = dist;
-                best = elevator;
-            }
-        }
-    }
-    // 2. 否则找同方向顺路电梯
-    if (!best) {
-        int dist = INT_MAX;
-        for (auto& elevator : elevators) {
-            if (elevator->GetState() == ElevatorState::Up && dir == Direction::Up &&
-                elevator->GetCurrentFloor() <= floor) {
-				int d = abs(elevator->GetCurrentFloor() - floor);
-				if (d < dist) {
-					dist = d;
-					best = elevator;
-				}
-            }
-            if (elevator->GetState() == ElevatorState::Down && dir == Direction::Down &&
-                elevator->GetCurrentFloor() >= floor) {
-				int d = abs(elevator->GetCurrentFloor() - floor);
-                if (d < dist) {
-                    dist = d;
-                    best = elevator;
-                }
-            }
-        }
+    // 飞行记录已在报警发生时由模拟线程导出, 这里只提示文件位置
+    QString message = QString("电梯 %1 触发紧急报警！").arg(elevator_id);
+    if (simulation->LastAlarmDumpSucceeded()) {
+        message += QString("\n运行记录已保存到 %1").arg(QString::fromStdString(simulation->GetAlarmDumpPath()));
     }
-    // 3. 否则找最合适的
-    if (!best && !elevators.empty()) {
-        best = elevators.front();
-    }
-    if (best)
-        best->AddExternalRequest(floor, dir);
+    QMessageBox::warning(this, "电梯报警", message);
 }
 
-void SimulationMainWindow::ScheduleElevator(int request_floor, Direction dir)
+void SimulationMainWindow::OnDestinationAssigned(const SimEvent& event)
 {
-    AssignExternalRequests(request_floor, dir);
+    shaft_view->SetAssignedCar(event.floor, event.car);
+    assignment_label->setText(QString("%1层前往%2层请乘坐%3号电梯").arg(event.floor + 1).arg(event.target + 1).arg(event.car));
 }
-
-void SimulationMainWindow::HandleFloorArrived(int floor, ElevatorState elevatorDirection)
-{
-    if (floor < 0 || floor >= floorButtonStates.size()) return;
-
-    FloorButtonState& state = floorButtonStates[floor];
-
-    // 检查上按钮是否需要恢复
-    if (state.upPressed && state.upDirection == Direction::Up) {
-        QPushButton* upBtn = findChild<QPushButton*>(QString("up_%1").arg(floor));
-        if (upBtn) {
-            upBtn->setDisabled(false);
-            state.upPressed = false;
-            state.upDirection = Direction::None;
-        }
-    }
-    // 检查下按钮是否需要恢复
-    if (state.downPressed && state.downDirection == Direction::Down) {
-        QPushButton* downBtn = findChild<QPushButton*>(QString("down_%1").arg(floor));
-        if (downBtn) {
-            downBtn->setDisabled(false);
-            state.downPressed = false;
-            state.downDirection = Direction::None;
-        }
-    }
-}
-
-bool SimulationMainWindow::HasElevatorStoppedAtFloor(int floor)
-{
-    for (auto& elevator : elevators) {
-        if (elevator->GetCurrentFloor() == floor &&
-            (elevator->GetState() == ElevatorState::Idle ||
-                elevator->GetState() == ElevatorState::Open)) {
-            return true;
-        }
-    }
-    return false;
-}
\ No newline at end of file
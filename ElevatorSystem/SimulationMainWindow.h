@@ -4,17 +4,20 @@
 #include <qpushbutton.h>
 #include <qlabel.h>
 #include <QScrollArea>
+#include <QSpinBox>
+#include <QScrollBar>
 #include <ElevatorSystem.h>
 #include <Elevator.h>
 #include <vector>
+#include <memory>
 #include <Utilities.h>
+#include <QTimer>
+#include "ControlServer.h"
+#include "MetricsServer.h"
+#include "ShaftView.h"
+#include "SimulationThread.h"
 
-struct FloorButtonState {
-    bool upPressed = false;
-    bool downPressed = false;
-    Direction upDirection = Direction::None;
-    Direction downDirection = Direction::None;
-};
+class ElevatorDisplayWindow;
 
 class SimulationMainWindow : public QWidget
 {
@@ -22,7 +25,7 @@ class SimulationMainWindow : public QWidget
 
 public:
     SimulationMainWindow(ElevatorSystem* elevatorSystem, QWidget* parent = nullptr);
-    ~SimulationMainWindow() {}
+    ~SimulationMainWindow();
 private:
     Ui::SimulationMainWindowClass ui;
 private:
@@ -34,24 +37,28 @@ private:
         QWidget::closeEvent(event);
     }
     void CaculateWindowSize(int elevator_count, int floor_count);
-    void ScheduleElevator(int request_floor, Direction dir);
-    void HandleFloorArrived(int floor, ElevatorState elevatorDirection);
-    bool HasElevatorStoppedAtFloor(int floor);
-    void AssignExternalRequests(int floor, Direction dir);
+    void RefreshFrame(); // 每帧读取模拟线程的快照和通知
+    void PostHallCall(int floor, Direction dir);
+    void OnCarAlarm(int elevator_id);
+    void OnDestinationAssigned(const SimEvent& event);
 signals:
     void windowClosed();
 public:
-    void SetElevatorFloor(int id, int floor);
-    void AddElevator(Elevator* elevator) {
-        elevators.push_back(elevator);
-    }
+    SimulationThread& GetSimulation() { return *simulation; }
 private:
     QPushButton* stop_simulation_btn;
     ElevatorSystem* elevatorSystem;
-    QLabel* elevator_floor_labels; // 数组指针
-    QButtonGroup* elevator_buttons; // 电梯按钮组(上，下)
-    std::vector<Elevator*> elevators; // 电梯对象数组
-    std::vector<FloorButtonState> floorButtonStates; // 楼层按钮状态数组
+    ShaftView* shaft_view = nullptr; // 楼层按钮和井道画布
+    QSpinBox* origin_box = nullptr;  // 目的层派梯: 出发层
+    QSpinBox* dest_box = nullptr;    // 目的层派梯: 目的层
+    QLabel* assignment_label = nullptr;
+    ElevatorDisplayWindow* elevatorWindow = nullptr;
+    std::unique_ptr<SimulationThread> simulation; // 在独立线程上运行的电梯组
+    QTimer* frame_timer = nullptr;                // 逐帧刷新界面
+    std::uint64_t shown_version = 0;              // 已显示的快照版本
+    MetricsServer* metrics_server = nullptr;      // 本机Prometheus端点
+    ControlServer* control_server = nullptr;      // 本机控制端口, 外部系统经此呼梯和查询状态
+    QTimer* metrics_timer = nullptr;              // 定期导出指标文件
 private:
     int window_width;
     int window_height;
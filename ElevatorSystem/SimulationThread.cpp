@@ -0,0 +1,225 @@
+﻿#include "SimulationThread.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    const int PollMs = 2;             // 空闲时检查命令队列的间隔
+    const size_t CommandCapacity = 16384; // 控制端口一次读入的命令可达数千条
+    const size_t EventCapacity = 1024;
+
+    // 界面模拟按真实时间运行, 每次优化限时5ms, 不要求可复现
+    LookaheadSettings GuiLookahead()
+    {
+        LookaheadSettings settings;
+        settings.period_ms = 1000;
+        settings.max_iterations = 20000;
+        settings.max_ms = 5.0;
+        return settings;
+    }
+}
+
+SimulationThread::SimulationThread(int elevator_count, int floor_count, const CarTiming& timing)
+    : elevator_count(elevator_count), floor_count(floor_count),
+    served_floors(ZonePlan::Make(ZoningMode::None, elevator_count, floor_count, 1).served),
+    group(elevator_count, floor_count, scheduler, timing), recorder(elevator_count, scheduler),
+    metrics(elevator_count, floor_count, scheduler), optimizer(GuiLookahead(), 1),
+    commands(CommandCapacity), events(EventCapacity)
+{
+    group.AddObserver(this);
+    recorder.Attach(group);
+    metrics.Attach(group);
+    Publish(); // 启动前界面也能读到初始状态
+}
+
+SimulationThread::~SimulationThread()
+{
+    Stop();
+    metrics.Detach(group);
+    recorder.Detach(group);
+    group.RemoveObserver(this);
+}
+
+void SimulationThread::SetDispatchMode(DispatchMode mode)
+{
+    if (!IsRunning())
+        group.SetDispatchMode(mode);
+}
+
+void SimulationThread::SetZonePlan(const ZonePlan& plan)
+{
+    if (IsRunning()) return;
+    group.ApplyZonePlan(plan);
+    for (size_t i = 0; i < served_floors.size() && i < plan.served.size(); ++i)
+        served_floors[i] = plan.served[i];
+}
+
+void SimulationThread::SetAlarmDumpPath(const std::string& path)
+{
+    if (!IsRunning())
+        recorder.SetAlarmDumpPath(path);
+}
+
+bool SimulationThread::ExportTelemetry(const std::string& name)
+{
+    if (IsRunning() || !telemetry.Open(name, elevator_count, floor_count)) return false;
+    telemetry.Publish(group, metrics, scheduler.Now());
+    return true;
+}
+
+void SimulationThread::Start()
+{
+    if (running.exchange(true)) return;
+    optimizer.Start();
+    worker = std::thread([this]() { Run(); });
+}
+
+void SimulationThread::Stop()
+{
+    running.store(false, std::memory_order_release);
+    if (worker.joinable())
+        worker.join();
+    optimizer.Stop();
+}
+
+bool SimulationThread::Post(const SimCommand& command)
+{
+    return commands.TryPush(command);
+}
+
+size_t SimulationThread::Post(const SimCommand* batch, size_t count)
+{
+    return commands.TryPushMany(batch, count);
+}
+
+void SimulationThread::Run()
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point base_wall = Clock::now();
+    TimerService::Time base_virtual = scheduler.Now();
+    double scale = time_scale.load(std::memory_order_relaxed);
+
+    while (running.load(std::memory_order_acquire)) {
+        Clock::time_point now = Clock::now();
+        double new_scale = time_scale.load(std::memory_order_relaxed);
+        if (new_scale != scale) {
+            // 倍速变化时以当前时刻为新的起点, 虚拟时钟保持连续
+            base_virtual = scheduler.Now();
+            base_wall = now;
+            scale = new_scale;
+        }
+        double elapsed_ms = std::chrono::duration<double, std::milli>(now - base_wall).count();
+        TimerService::Time target = base_virtual + static_cast<TimerService::Time>(elapsed_ms * scale);
+
+        // 先把时钟推进到当前时刻, 命令在当前虚拟时间生效
+        bool changed = scheduler.RunUntil(target) > 0;
+        SimCommand command;
+        while (commands.TryPop(command)) {
+            Apply(command);
+            changed = true;
+        }
+        if (Reoptimize()) changed = true;
+        if (changed) {
+            scheduler.RunUntil(target); // 命令产生的零延迟事件
+            Publish();
+        }
+
+        // 睡到下一个事件, 但不超过PollMs, 保证命令的响应延迟
+        double wait_ms = PollMs;
+        TimerService::Time next = scheduler.NextEventTime();
+        if (next >= 0 && scale > 0)
+            wait_ms = std::min(wait_ms, std::max(0.0, (next - target) / scale));
+        if (wait_ms > 0)
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(wait_ms));
+    }
+}
+
+bool SimulationThread::Reoptimize()
+{
+    // 取回的结果整体应用, 外呼在求解期间有变化的直接丢弃; 然后按周期提交新的问题
+    bool changed = false;
+    AssignmentPlan plan;
+    while (optimizer.TryTakePlan(plan))
+        changed = group.ApplyAssignmentPlan(plan) > 0 || changed;
+    if (scheduler.Now() >= next_lookahead) {
+        next_lookahead = scheduler.Now() + optimizer.GetSettings().period_ms;
+        group.BuildAssignmentProblem(lookahead_problem);
+        if (!lookahead_problem.calls.empty())
+            optimizer.Submit(lookahead_problem);
+    }
+    return changed;
+}
+
+void SimulationThread::Apply(const SimCommand& command)
+{
+    bool car_valid = command.car >= 0 && command.car < elevator_count;
+    switch (command.type) {
+    case SimCommand::Type::HallCall:
+        group.PressHallButton(command.floor, command.dir);
+        break;
+    case SimCommand::Type::CarCall:
+        if (car_valid) group.GetCar(command.car).AddInternalTarget(command.floor);
+        break;
+    case SimCommand::Type::OpenDoor:
+        if (car_valid) group.GetCar(command.car).OpenDoor();
+        break;
+    case SimCommand::Type::CloseDoor:
+        if (car_valid) group.GetCar(command.car).CloseDoor();
+        break;
+    case SimCommand::Type::Alarm:
+        if (car_valid) group.GetCar(command.car).TriggerAlarm();
+        break;
+    case SimCommand::Type::Passenger:
+        group.AddPassenger(command.floor, command.target);
+        break;
+    case SimCommand::Type::Service:
+        group.SetOutOfService(command.car, command.target != 0);
+        break;
+    }
+}
+
+void SimulationThread::Publish()
+{
+    // 写槽位是两次之前发布的旧数据, 每次都完整覆盖; 尺寸不变时不会分配内存
+    GroupSnapshot& snapshot = snapshots.WriteSlot();
+    snapshot.version = ++version;
+    snapshot.now = scheduler.Now();
+    snapshot.cars.resize(elevator_count);
+    for (int i = 0; i < elevator_count; ++i) {
+        const ElevatorCar& car = group.GetCar(i);
+        CarSnapshot& out = snapshot.cars[i];
+        out.floor = car.GetCurrentFloor();
+        out.state = car.GetState();
+        out.direction = car.GetDirection();
+        out.targets = car.GetInternalTargets();
+        out.out_of_service = group.GetHealth(i).out_of_service;
+        out.stalled = group.GetHealth(i).stalled;
+    }
+    snapshot.hall_buttons = group.GetFloorButtonStates();
+    snapshots.Publish();
+    telemetry.Publish(group, metrics, scheduler.Now());
+}
+
+void SimulationThread::PushEvent(const SimEvent& event)
+{
+    // 界面长时间不取时丢弃, 模拟线程不等待
+    if (!events.TryPush(event))
+        dropped_events.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SimulationThread::OnCarAlarm(int elevator_id)
+{
+    SimEvent event;
+    event.type = SimEvent::Type::Alarm;
+    event.car = elevator_id;
+    PushEvent(event);
+}
+
+void SimulationThread::OnDestinationAssigned(const Passenger& passenger)
+{
+    SimEvent event;
+    event.type = SimEvent::Type::DestinationAssigned;
+    event.car = passenger.assigned_car;
+    event.floor = passenger.origin;
+    event.target = passenger.destination;
+    PushEvent(event);
+}
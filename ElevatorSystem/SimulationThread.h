@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "ElevatorGroup.h"
+#include "EventScheduler.h"
+#include "FlightRecorder.h"
+#include "FloorMask.h"
+#include "LockFree.h"
+#include "LookaheadOptimizer.h"
+#include "Metrics.h"
+#include "SharedTelemetry.h"
+
+// 界面 -> 模拟线程的命令
+struct SimCommand {
+    enum class Type : std::uint8_t {
+        HallCall,  // floor层dir方向的外部按钮
+        CarCall,   // car号电梯内按下floor层
+        OpenDoor,
+        CloseDoor,
+        Alarm,
+        Passenger, // 乘客从floor层前往target层(目的层派梯)
+        Service    // car号电梯停用(target为1)或恢复服务(target为0)
+    };
+    Type type = Type::HallCall;
+    Direction dir = Direction::None;
+    int car = 0;    // 电梯下标(从0开始)
+    int floor = 0;
+    int target = 0;
+};
+
+// 模拟线程 -> 界面的一次性通知
+struct SimEvent {
+    enum class Type : std::uint8_t {
+        Alarm,              // car号电梯报警
+        DestinationAssigned // floor层前往target层的乘客分配到car号电梯
+    };
+    Type type = Type::Alarm;
+    int car = 0;    // 电梯编号(从1开始)
+    int floor = 0;
+    int target = 0;
+};
+
+// 单部电梯的状态快照
+struct CarSnapshot {
+    int floor = 0;
+    ElevatorState state = ElevatorState::Idle;
+    Direction direction = Direction::None;
+    FloorMask targets; // 电梯内已按下的楼层
+    bool out_of_service = false;
+    bool stalled = false; // 有外呼却长时间没有进展, 外呼已改派
+};
+
+// 整个电梯组的状态快照, 由模拟线程整体发布
+struct GroupSnapshot {
+    std::uint64_t version = 0;
+    TimerService::Time now = 0;
+    std::vector<CarSnapshot> cars;
+    std::vector<FloorButtonState> hall_buttons;
+};
+
+// 在独立线程上按真实时间推进模拟, 界面线程和模拟线程互不阻塞:
+// 命令经无锁队列进入模拟线程, 状态经三缓冲快照发布给界面, 报警等通知经另一个无锁队列返回
+// 电梯之间共享乘客和派梯状态, 整个电梯组作为一个分片在同一线程上运行, 结果与单线程一致
+class SimulationThread : public GroupObserver
+{
+public:
+    SimulationThread(int elevator_count, int floor_count, const CarTiming& timing = CarTiming());
+    ~SimulationThread();
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+public:
+    void SetDispatchMode(DispatchMode mode); // 只能在Start之前调用
+    void SetZonePlan(const ZonePlan& plan);  // 只能在Start之前调用
+    void SetAlarmDumpPath(const std::string& path); // 只能在Start之前调用, 报警时模拟线程立即导出飞行记录
+    bool ExportTelemetry(const std::string& name = TelemetryWriter::DefaultName); // 只能在Start之前调用, 之后每次发布快照时同步写入共享内存
+    void Start();
+    void Stop();
+    bool IsRunning() const { return running.load(std::memory_order_relaxed); }
+    void SetTimeScale(double scale) { time_scale.store(scale, std::memory_order_relaxed); }
+
+    int GetElevatorCount() const { return elevator_count; }
+    int GetFloorCount() const { return floor_count; }
+    const FloorMask& GetServedFloors(int car) const { return served_floors[car]; } // 启动后不再改变, 任意线程可读
+
+    // 任意线程调用; 队列满时返回false
+    bool Post(const SimCommand& command);
+    // 批量提交, 返回进入队列的条数; 队列满时只提交前面的部分, 其余由调用方稍后重试
+    size_t Post(const SimCommand* batch, size_t count);
+    // 以下只能由同一个读线程(界面线程)调用
+    const GroupSnapshot& ReadSnapshot() { return snapshots.Read(); }
+    bool PollEvent(SimEvent& event) { return events.TryPop(event); }
+
+    std::uint64_t GetDroppedEventCount() const { return dropped_events.load(std::memory_order_relaxed); }
+    // 任意线程调用, 不打断模拟线程
+    bool DumpFlightRecorder(const std::string& path) const { return recorder.DumpToFile(path); }
+    const std::string& GetAlarmDumpPath() const { return recorder.GetAlarmDumpPath(); } // 启动后不再改变
+    bool LastAlarmDumpSucceeded() const { return recorder.LastAlarmDumpSucceeded(); }
+    const MetricsCollector& GetMetrics() const { return metrics; } // 可在任意线程导出
+
+    // GroupObserver, 在模拟线程上调用
+    void OnCarAlarm(int elevator_id) override;
+    void OnDestinationAssigned(const Passenger& passenger) override;
+private:
+    void Run();
+    void Apply(const SimCommand& command);
+    bool Reoptimize(); // 返回是否改派了外呼
+    void Publish();
+    void PushEvent(const SimEvent& event);
+
+private:
+    const int elevator_count;
+    const int floor_count;
+    std::vector<FloorMask> served_floors; // 各电梯的服务楼层, 界面线程据此灰显不停靠的楼层
+    EventScheduler scheduler;
+    ElevatorGroup group;
+    FlightRecorder recorder; // 始终开启
+    MetricsCollector metrics;
+    TelemetryWriter telemetry; // 未调用ExportTelemetry时不写
+    BackgroundOptimizer optimizer;          // 前瞻优化在自己的线程上求解
+    AssignmentProblem lookahead_problem;    // 每次复用
+    TimerService::Time next_lookahead = 0;
+    BoundedQueue<SimCommand> commands;
+    BoundedQueue<SimEvent> events;
+    SnapshotBuffer<GroupSnapshot> snapshots;
+    std::thread worker;
+    std::atomic<bool> running{ false };
+    std::atomic<double> time_scale{ 1.0 };
+    std::atomic<std::uint64_t> dropped_events{ 0 };
+    std::uint64_t version = 0;
+};
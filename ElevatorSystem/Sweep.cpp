@@ -0,0 +1,162 @@
+﻿#include "Sweep.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+namespace {
+    // 双侧95%的t分布临界值, 下标为自由度; 自由度超过30时按正态分布近似
+    double StudentT95(int dof)
+    {
+        static const double table[] = { 0.0,
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+        if (dof <= 0) return 0.0;
+        if (dof <= 30) return table[dof];
+        return 1.960;
+    }
+
+    // 单次模拟的开销估计(乘客数 × 楼层数), 大任务先提交, 缩短最后的拖尾
+    double EstimatedCost(const SimulationConfig& config)
+    {
+        return config.passengers_per_minute * config.duration_ms / 60000.0 * config.floor_count;
+    }
+}
+
+std::vector<SimulationConfig> SweepGrid::Expand() const
+{
+    std::vector<SimulationConfig> configs;
+    for (int floors : floor_counts)
+        for (int cars : elevator_counts)
+            for (int move : move_ms)
+                for (int stay : stay_open_ms)
+                    for (double rate : passengers_per_minute)
+                        for (TrafficProfile profile : profiles)
+                            for (DispatchMode mode : modes) {
+                                SimulationConfig config;
+                                config.floor_count = floors;
+                                config.elevator_count = cars;
+                                config.timing.move_ms = move;
+                                config.timing.stay_open_ms = stay;
+                                config.passengers_per_minute = rate;
+                                config.profile = profile;
+                                config.dispatch_mode = mode;
+                                config.duration_ms = duration_ms;
+                                config.seed = base_seed;
+                                configs.push_back(config);
+                            }
+    return configs;
+}
+
+MetricSummary MetricSummary::From(const std::vector<double>& samples)
+{
+    MetricSummary summary;
+    if (samples.empty()) return summary;
+    double n = static_cast<double>(samples.size());
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+    if (samples.size() < 2) return summary;
+    double squares = 0.0;
+    for (double value : samples)
+        squares += (value - summary.mean) * (value - summary.mean);
+    summary.stddev = std::sqrt(squares / (n - 1));
+    summary.ci95 = StudentT95(static_cast<int>(samples.size()) - 1) * summary.stddev / std::sqrt(n);
+    return summary;
+}
+
+std::vector<SweepResult> SweepRunner::Run(const SweepGrid& grid)
+{
+    std::vector<SimulationConfig> configs = grid.Expand();
+    const int replications = std::max(1, grid.replications);
+    std::vector<KpiReport> reports(configs.size() * replications);
+
+    // 任务下标 = 网格点 * replications + 重复序号
+    std::vector<size_t> order(reports.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return EstimatedCost(configs[a / replications]) > EstimatedCost(configs[b / replications]);
+    });
+    for (size_t task : order) {
+        pool.Submit([&configs, &reports, task, replications]() {
+            SimulationConfig config = configs[task / replications];
+            config.seed += static_cast<std::uint64_t>(task % replications);
+            Simulation simulation(config);
+            reports[task] = simulation.Run();
+        });
+    }
+    pool.Wait();
+    simulations += reports.size();
+
+    std::vector<SweepResult> results;
+    results.reserve(configs.size());
+    std::vector<double> avg_wait, p95_wait, p99_wait, avg_journey, capacity;
+    for (size_t i = 0; i < configs.size(); ++i) {
+        avg_wait.clear();
+        p95_wait.clear();
+        p99_wait.clear();
+        avg_journey.clear();
+        capacity.clear();
+        SweepResult result;
+        result.config = configs[i];
+        result.replications = replications;
+        for (int r = 0; r < replications; ++r) {
+            const KpiReport& report = reports[i * replications + r];
+            avg_wait.push_back(report.avg_wait_ms);
+            p95_wait.push_back(report.p95_wait_ms);
+            p99_wait.push_back(report.p99_wait_ms);
+            avg_journey.push_back(report.avg_journey_ms);
+            capacity.push_back(static_cast<double>(report.handling_capacity_5min));
+            result.wall_ms += report.wall_ms;
+        }
+        result.avg_wait_ms = MetricSummary::From(avg_wait);
+        result.p95_wait_ms = MetricSummary::From(p95_wait);
+        result.p99_wait_ms = MetricSummary::From(p99_wait);
+        result.avg_journey_ms = MetricSummary::From(avg_journey);
+        result.handling_capacity_5min = MetricSummary::From(capacity);
+        results.push_back(result);
+    }
+    return results;
+}
+
+std::string SweepResult::CsvHeader()
+{
+    return "floors,cars,move_ms,stay_open_ms,passengers_per_minute,profile,mode,replications,"
+        "avg_wait_ms,avg_wait_ci95,p95_wait_ms,p95_wait_ci95,p99_wait_ms,p99_wait_ci95,"
+        "avg_journey_ms,avg_journey_ci95,handling_capacity_5min,handling_capacity_ci95,wall_ms";
+}
+
+std::string SweepResult::ToCsv() const
+{
+    char text[512];
+    std::snprintf(text, sizeof(text),
+        "%d,%d,%d,%d,%.2f,%s,%s,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f,%.1f",
+        config.floor_count, config.elevator_count, config.timing.move_ms, config.timing.stay_open_ms,
+        config.passengers_per_minute, TrafficGenerator::ProfileName(config.profile),
+        ElevatorGroup::ModeName(config.dispatch_mode), replications,
+        avg_wait_ms.mean, avg_wait_ms.ci95, p95_wait_ms.mean, p95_wait_ms.ci95, p99_wait_ms.mean, p99_wait_ms.ci95,
+        avg_journey_ms.mean, avg_journey_ms.ci95, handling_capacity_5min.mean, handling_capacity_5min.ci95, wall_ms);
+    return text;
+}
+
+std::string SweepResult::ToJson() const
+{
+    char text[1024];
+    std::snprintf(text, sizeof(text),
+        "{\"floors\":%d,\"cars\":%d,\"move_ms\":%d,\"stay_open_ms\":%d,\"passengers_per_minute\":%.2f,"
+        "\"profile\":\"%s\",\"mode\":\"%s\",\"replications\":%d,"
+        "\"avg_wait_ms\":{\"mean\":%.1f,\"stddev\":%.1f,\"ci95\":%.1f},"
+        "\"p95_wait_ms\":{\"mean\":%.1f,\"stddev\":%.1f,\"ci95\":%.1f},"
+        "\"p99_wait_ms\":{\"mean\":%.1f,\"stddev\":%.1f,\"ci95\":%.1f},"
+        "\"avg_journey_ms\":{\"mean\":%.1f,\"stddev\":%.1f,\"ci95\":%.1f},"
+        "\"handling_capacity_5min\":{\"mean\":%.2f,\"stddev\":%.2f,\"ci95\":%.2f},\"wall_ms\":%.1f}",
+        config.floor_count, config.elevator_count, config.timing.move_ms, config.timing.stay_open_ms,
+        config.passengers_per_minute, TrafficGenerator::ProfileName(config.profile),
+        ElevatorGroup::ModeName(config.dispatch_mode), replications,
+        avg_wait_ms.mean, avg_wait_ms.stddev, avg_wait_ms.ci95,
+        p95_wait_ms.mean, p95_wait_ms.stddev, p95_wait_ms.ci95,
+        p99_wait_ms.mean, p99_wait_ms.stddev, p99_wait_ms.ci95,
+        avg_journey_ms.mean, avg_journey_ms.stddev, avg_journey_ms.ci95,
+        handling_capacity_5min.mean, handling_capacity_5min.stddev, handling_capacity_5min.ci95, wall_ms);
+    return text;
+}
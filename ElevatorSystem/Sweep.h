@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Simulation.h"
+
+class ThreadPool;
+
+// 参数扫描网格: 各维度取值的笛卡尔积, 每个组合运行replications次不同种子的模拟
+struct SweepGrid {
+    std::vector<int> elevator_counts = { 4 };
+    std::vector<int> floor_counts = { 20 };
+    std::vector<int> move_ms = { 600 };          // 每层运行时间(速度)
+    std::vector<int> stay_open_ms = { 2000 };    // 开门停留时间
+    std::vector<double> passengers_per_minute = { 10.0 };
+    std::vector<TrafficProfile> profiles = { TrafficProfile::UpPeak };
+    std::vector<DispatchMode> modes = { DispatchMode::Collective };
+    int replications = 10;
+    std::uint64_t base_seed = 1;
+    TimerService::Time duration_ms = 3600 * 1000;
+
+    std::vector<SimulationConfig> Expand() const; // 展开为各组合的配置(seed为base_seed)
+};
+
+// 某项指标在多次重复中的统计: 均值、标准差和95%置信区间半宽(t分布)
+struct MetricSummary {
+    double mean = 0;
+    double stddev = 0;
+    double ci95 = 0;
+
+    static MetricSummary From(const std::vector<double>& samples);
+};
+
+// 一个网格点的汇总结果
+struct SweepResult {
+    SimulationConfig config;
+    int replications = 0;
+    MetricSummary avg_wait_ms;
+    MetricSummary p95_wait_ms;
+    MetricSummary p99_wait_ms;
+    MetricSummary avg_journey_ms;
+    MetricSummary handling_capacity_5min;
+    double wall_ms = 0; // 各次重复的实际耗时之和
+
+    static std::string CsvHeader();
+    std::string ToCsv() const;
+    std::string ToJson() const;
+};
+
+// 在线程池上并行运行整个网格; 每次重复是一个独立任务, 结果写入预先分配的位置, 运行中不加锁
+// 第r次重复在所有网格点上使用相同的种子(公共随机数), 便于比较不同参数
+class SweepRunner
+{
+public:
+    explicit SweepRunner(ThreadPool& pool) : pool(pool) {}
+public:
+    std::vector<SweepResult> Run(const SweepGrid& grid);
+    std::uint64_t GetSimulationCount() const { return simulations; }
+private:
+    ThreadPool& pool;
+    std::uint64_t simulations = 0;
+};
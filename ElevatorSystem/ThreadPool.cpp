@@ -0,0 +1,106 @@
+﻿#include "ThreadPool.h"
+
+namespace {
+    // 当前线程所属的线程池及其队列下标, 非工作线程为nullptr
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local unsigned current_index = 0;
+}
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+    if (thread_count == 0)
+        thread_count = std::thread::hardware_concurrency();
+    if (thread_count == 0)
+        thread_count = 1;
+    queues.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i)
+        queues.emplace_back(new WorkQueue());
+    threads.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i)
+        threads.emplace_back([this, i]() { WorkerLoop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    unsigned index = current_pool == this ? current_index
+        : next_queue.fetch_add(1, std::memory_order_relaxed) % static_cast<unsigned>(queues.size());
+    unfinished.fetch_add(1, std::memory_order_relaxed);
+    {
+        // 与WorkerLoop中的等待条件在同一把锁下修改, 避免丢失唤醒;
+        // 先计数再入队, 计数不会因为任务被立即取走而出现负数
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(idle_mutex);
+    done.wait(lock, [this]() { return unfinished.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::PopLocal(unsigned index, std::function<void()>& task)
+{
+    WorkQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::Steal(unsigned index, std::function<void()>& task)
+{
+    // 从下一个队列开始轮询, 各线程的窃取起点错开
+    const unsigned count = static_cast<unsigned>(queues.size());
+    for (unsigned k = 1; k < count; ++k) {
+        WorkQueue& victim = *queues[(index + k) % count];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned index)
+{
+    current_pool = this;
+    current_index = index;
+    std::function<void()> task;
+    for (;;) {
+        if (PopLocal(index, task) || Steal(index, task)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+            if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(idle_mutex);
+                done.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        // try_lock窃取可能因竞争失败, 还有任务时不睡眠而是重试
+        if (queued.load(std::memory_order_acquire) > 0) continue;
+        if (stopping) return;
+        wake.wait(lock, [this]() { return stopping || queued.load(std::memory_order_acquire) > 0; });
+    }
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池: 每个工作线程有自己的任务队列, 从队尾取自己的任务,
+// 空闲时从其他线程的队头窃取, 适合大量相互独立、耗时不均的任务(例如批量模拟)
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned thread_count = 0); // 0表示使用全部硬件线程
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+public:
+    void Submit(std::function<void()> task); // 在工作线程内提交时放入本线程队列, 否则轮流分配
+    void Wait();                             // 等待所有已提交的任务完成
+    unsigned GetThreadCount() const { return static_cast<unsigned>(threads.size()); }
+    std::uint64_t GetStealCount() const { return steals.load(std::memory_order_relaxed); }
+private:
+    // 按缓存行对齐, 避免相邻队列的锁互相干扰
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    void WorkerLoop(unsigned index);
+    bool PopLocal(unsigned index, std::function<void()>& task);
+    bool Steal(unsigned index, std::function<void()>& task);
+
+private:
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> queued{ 0 };    // 队列中尚未被取走的任务数
+    std::atomic<std::size_t> unfinished{ 0 }; // 已提交但尚未执行完的任务数
+    std::atomic<unsigned> next_queue{ 0 };
+    std::atomic<std::uint64_t> steals{ 0 };
+    bool stopping = false;
+    std::mutex idle_mutex;
+    std::condition_variable wake;  // 有新任务或退出
+    std::condition_variable done;  // 全部任务完成
+};
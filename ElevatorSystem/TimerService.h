@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+
+// 定时服务接口: 电梯核心逻辑只通过它推进时间, 不直接依赖QTimer
+class TimerService
+{
+public:
+    using TimerId = std::uint64_t;
+    using Time = std::int64_t; // 虚拟时间, 毫秒
+    static constexpr TimerId InvalidTimer = 0;
+
+    virtual ~TimerService() {}
+    virtual TimerId Schedule(int delay_ms, std::function<void()> callback) = 0; // delay_ms后执行一次
+    virtual void Cancel(TimerId id) = 0;                                         // 取消尚未执行的定时
+    virtual Time Now() const = 0;                                                // 当前时间
+};
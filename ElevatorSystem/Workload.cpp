@@ -0,0 +1,376 @@
+﻿#include "Workload.h"
+#include "Checkpoint.h"
+#include "ElevatorGroup.h"
+#include "EventScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    const char FaultCodes[] = "AOI"; // 轨迹中的故障类型, 按CarFault的顺序
+}
+
+TrafficGenerator::TrafficGenerator(int floor_count, TrafficProfile profile, double passengers_per_minute,
+    TimerService::Time duration_ms, std::uint64_t seed)
+    : floor_count(floor_count), rate_per_ms(passengers_per_minute / 60000.0),
+    duration(duration_ms), rng_state(seed)
+{
+    SetOriginDestinationMatrix(ProfileMatrix(floor_count, profile));
+}
+
+void TrafficGenerator::SetOriginDestinationMatrix(const std::vector<double>& weights)
+{
+    cumulative.assign(static_cast<size_t>(floor_count) * floor_count, 0.0);
+    double sum = 0.0;
+    for (size_t i = 0; i < cumulative.size() && i < weights.size(); ++i) {
+        int origin = static_cast<int>(i / floor_count);
+        int destination = static_cast<int>(i % floor_count);
+        if (origin != destination && weights[i] > 0.0)
+            sum += weights[i];
+        cumulative[i] = sum;
+    }
+}
+
+std::vector<double> TrafficGenerator::ProfileMatrix(int floor_count, TrafficProfile profile)
+{
+    // 1层(下标0)为大堂, 三类流量: 进入(大堂->楼上)、离开(楼上->大堂)、层间
+    double incoming = 0.0, outgoing = 0.0, inter = 0.0;
+    switch (profile) {
+    case TrafficProfile::UpPeak:     incoming = 0.85; outgoing = 0.05; inter = 0.10; break;
+    case TrafficProfile::DownPeak:   incoming = 0.05; outgoing = 0.85; inter = 0.10; break;
+    case TrafficProfile::Lunch:      incoming = 0.40; outgoing = 0.40; inter = 0.20; break;
+    case TrafficProfile::InterFloor: incoming = 0.0;  outgoing = 0.0;  inter = 1.0;  break;
+    }
+    std::vector<double> weights(static_cast<size_t>(floor_count) * floor_count, 0.0);
+    if (floor_count < 2) return weights;
+    double upper = floor_count - 1;
+    double pairs = upper * (upper - 1);
+    for (int o = 0; o < floor_count; ++o) {
+        for (int d = 0; d < floor_count; ++d) {
+            if (o == d) continue;
+            double& w = weights[static_cast<size_t>(o) * floor_count + d];
+            if (profile == TrafficProfile::InterFloor)
+                w = 1.0;
+            else if (o == 0)
+                w = incoming / upper;
+            else if (d == 0)
+                w = outgoing / upper;
+            else if (pairs > 0)
+                w = inter / pairs;
+        }
+    }
+    return weights;
+}
+
+const char* TrafficGenerator::ProfileName(TrafficProfile profile)
+{
+    switch (profile) {
+    case TrafficProfile::UpPeak: return "up-peak";
+    case TrafficProfile::DownPeak: return "down-peak";
+    case TrafficProfile::Lunch: return "lunch";
+    case TrafficProfile::InterFloor: return "inter-floor";
+    }
+    return "unknown";
+}
+
+bool TrafficGenerator::ParseProfile(const std::string& name, TrafficProfile& profile)
+{
+    const TrafficProfile all[] = { TrafficProfile::UpPeak, TrafficProfile::DownPeak,
+        TrafficProfile::Lunch, TrafficProfile::InterFloor };
+    for (TrafficProfile p : all) {
+        if (name == ProfileName(p)) {
+            profile = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t TrafficGenerator::NextRandom()
+{
+    // splitmix64, 结果与平台和标准库实现无关
+    std::uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+double TrafficGenerator::NextUniform()
+{
+    return (NextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool TrafficGenerator::Next(CallRecord& record)
+{
+    if (rate_per_ms <= 0.0 || cumulative.empty() || cumulative.back() <= 0.0) return false;
+
+    // 泊松过程: 到达间隔服从指数分布
+    clock += -std::log(1.0 - NextUniform()) / rate_per_ms;
+    if (clock > static_cast<double>(duration)) return false;
+
+    double pick = NextUniform() * cumulative.back();
+    size_t index = std::upper_bound(cumulative.begin(), cumulative.end(), pick) - cumulative.begin();
+    if (index >= cumulative.size()) index = cumulative.size() - 1;
+
+    record.time = static_cast<TimerService::Time>(clock);
+    record.type = CallType::Passenger;
+    record.floor = static_cast<int>(index / floor_count);
+    record.target = static_cast<int>(index % floor_count);
+    record.dir = record.target > record.floor ? Direction::Up : Direction::Down;
+    record.elevator_id = 0;
+    return true;
+}
+
+bool TrafficGenerator::SaveState(CheckpointWriter& writer) const
+{
+    writer.Put(CheckpointTag("TGEN"));
+    writer.Put(clock);
+    writer.Put(rng_state);
+    writer.PutVector(cumulative);
+    return true;
+}
+
+bool TrafficGenerator::LoadState(CheckpointReader& reader)
+{
+    if (!reader.Expect(CheckpointTag("TGEN"))) return false;
+    double loaded_clock = reader.Get<double>();
+    std::uint64_t loaded_state = reader.Get<std::uint64_t>();
+    std::vector<double> loaded_cumulative;
+    if (!reader.GetVector(loaded_cumulative) || loaded_cumulative.size() != cumulative.size())
+        return reader.Fail();
+    clock = loaded_clock;
+    rng_state = loaded_state;
+    cumulative.swap(loaded_cumulative);
+    return true;
+}
+
+TraceReader::TraceReader(const std::string& path)
+    : buffer(1 << 20)
+{
+    // 大缓冲区顺序读取, 文件大小不影响内存占用
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(path);
+}
+
+bool TraceReader::Next(CallRecord& record)
+{
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (line.empty() || line[0] == '#' || line[0] == '\r') continue;
+        if (ParseLine(line, record)) return true;
+        ++skipped;
+    }
+    return false;
+}
+
+bool TraceReader::SaveState(CheckpointWriter& writer) const
+{
+    // tellg需要非const的流; 读完后位置为-1, 恢复时直接定位到末尾
+    std::ifstream& stream = const_cast<std::ifstream&>(file);
+    writer.Put(CheckpointTag("TRCE"));
+    writer.Put<std::int64_t>(stream.good() ? static_cast<std::int64_t>(stream.tellg()) : -1);
+    writer.Put(line_number);
+    writer.Put(skipped);
+    return IsOpen();
+}
+
+bool TraceReader::LoadState(CheckpointReader& reader)
+{
+    if (!reader.Expect(CheckpointTag("TRCE"))) return false;
+    std::int64_t position = reader.Get<std::int64_t>();
+    std::uint64_t lines = reader.Get<std::uint64_t>();
+    std::uint64_t bad = reader.Get<std::uint64_t>();
+    if (!reader.Ok() || !IsOpen()) return reader.Fail();
+    file.clear();
+    if (position >= 0)
+        file.seekg(position);
+    else
+        file.seekg(0, std::ios::end);
+    if (!file) return reader.Fail();
+    line_number = lines;
+    skipped = bad;
+    return true;
+}
+
+bool TraceReader::ParseLine(const std::string& line, CallRecord& record)
+{
+    const char* p = line.c_str();
+    char* end = nullptr;
+    long long time = std::strtoll(p, &end, 10);
+    if (end == p || *end != ',') return false;
+    p = end + 1;
+    char type = *p++;
+    if (*p != ',') return false;
+    ++p;
+    long first = std::strtol(p, &end, 10);
+    if (end == p || *end != ',') return false;
+    p = end + 1;
+
+    record.time = time;
+    switch (type) {
+    case 'P': {
+        long target = std::strtol(p, &end, 10);
+        if (end == p) return false;
+        record.type = CallType::Passenger;
+        record.floor = static_cast<int>(first);
+        record.target = static_cast<int>(target);
+        record.dir = target > first ? Direction::Up : Direction::Down;
+        record.elevator_id = 0;
+        return true;
+    }
+    case 'H':
+        if (*p != 'U' && *p != 'D') return false;
+        record.type = CallType::Hall;
+        record.floor = static_cast<int>(first);
+        record.target = 0;
+        record.dir = *p == 'U' ? Direction::Up : Direction::Down;
+        record.elevator_id = 0;
+        return true;
+    case 'C': {
+        long target = std::strtol(p, &end, 10);
+        if (end == p) return false;
+        record.type = CallType::Car;
+        record.elevator_id = static_cast<int>(first);
+        record.floor = 0;
+        record.target = static_cast<int>(target);
+        record.dir = Direction::None;
+        return true;
+    }
+    case 'F': {
+        const char* kind = *p ? std::strchr(FaultCodes, *p) : nullptr;
+        if (!kind) return false;
+        record.type = CallType::Fault;
+        record.elevator_id = static_cast<int>(first);
+        record.floor = 0;
+        record.target = static_cast<int>(kind - FaultCodes);
+        record.dir = Direction::None;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+TraceWriter::TraceWriter(const std::string& path)
+    : file(path)
+{
+}
+
+void TraceWriter::Write(const CallRecord& record)
+{
+    file << FormatLine(record) << '\n';
+}
+
+std::string TraceWriter::FormatLine(const CallRecord& record)
+{
+    char text[96];
+    switch (record.type) {
+    case CallType::Passenger:
+        std::snprintf(text, sizeof(text), "%lld,P,%d,%d", static_cast<long long>(record.time), record.floor, record.target);
+        break;
+    case CallType::Hall:
+        std::snprintf(text, sizeof(text), "%lld,H,%d,%c", static_cast<long long>(record.time), record.floor,
+            record.dir == Direction::Up ? 'U' : 'D');
+        break;
+    case CallType::Car:
+        std::snprintf(text, sizeof(text), "%lld,C,%d,%d", static_cast<long long>(record.time), record.elevator_id, record.target);
+        break;
+    case CallType::Fault:
+        std::snprintf(text, sizeof(text), "%lld,F,%d,%c", static_cast<long long>(record.time), record.elevator_id,
+            FaultCodes[record.target]);
+        break;
+    }
+    return text;
+}
+
+WorkloadDriver::WorkloadDriver(ElevatorGroup& group, EventScheduler& scheduler, CallSource& source)
+    : group(group), scheduler(scheduler), source(source)
+{
+}
+
+void WorkloadDriver::Start()
+{
+    finished = false;
+    ScheduleNext();
+}
+
+void WorkloadDriver::ScheduleNext()
+{
+    if (!source.Next(next_record)) {
+        finished = true;
+        return;
+    }
+    ScheduleRecord();
+}
+
+void WorkloadDriver::ScheduleRecord()
+{
+    next_timer = scheduler.ScheduleAt(next_record.time, [this]() {
+        next_timer = TimerService::InvalidTimer;
+        Inject(next_record);
+        ScheduleNext();
+    });
+}
+
+bool WorkloadDriver::SaveState(CheckpointWriter& writer) const
+{
+    writer.Put(CheckpointTag("DRV "));
+    writer.Put(injected);
+    writer.Put(finished);
+    writer.Put(next_timer);
+    writer.Put(next_record.time);
+    writer.Put(next_record.type);
+    writer.Put<std::int32_t>(next_record.floor);
+    writer.Put<std::int32_t>(next_record.target);
+    writer.Put(next_record.dir);
+    writer.Put<std::int32_t>(next_record.elevator_id);
+    return source.SaveState(writer);
+}
+
+bool WorkloadDriver::LoadState(CheckpointReader& reader, std::vector<PendingTimer>& pending)
+{
+    if (!reader.Expect(CheckpointTag("DRV "))) return false;
+    injected = reader.Get<std::uint64_t>();
+    finished = reader.Get<bool>();
+    TimerService::TimerId timer = reader.Get<TimerService::TimerId>();
+    next_record.time = reader.Get<TimerService::Time>();
+    next_record.type = reader.Get<CallType>();
+    next_record.floor = reader.Get<std::int32_t>();
+    next_record.target = reader.Get<std::int32_t>();
+    next_record.dir = reader.Get<Direction>();
+    next_record.elevator_id = reader.Get<std::int32_t>();
+    if (!reader.Ok() || !source.LoadState(reader)) return false;
+
+    next_timer = TimerService::InvalidTimer;
+    if (timer != TimerService::InvalidTimer) {
+        pending.push_back(PendingTimer{ timer, [this]() { ScheduleRecord(); } });
+    }
+    return true;
+}
+
+void WorkloadDriver::Inject(const CallRecord& record)
+{
+    if (recorder) recorder->Write(record);
+    ++injected;
+    switch (record.type) {
+    case CallType::Passenger:
+        group.AddPassenger(record.floor, record.target);
+        break;
+    case CallType::Hall:
+        group.PressHallButton(record.floor, record.dir);
+        break;
+    case CallType::Car:
+        if (record.elevator_id >= 1 && record.elevator_id <= group.GetElevatorCount())
+            group.GetCar(record.elevator_id - 1).AddInternalTarget(record.target);
+        break;
+    case CallType::Fault:
+        if (record.elevator_id < 1 || record.elevator_id > group.GetElevatorCount()) break;
+        if (static_cast<CarFault>(record.target) == CarFault::Alarm)
+            group.GetCar(record.elevator_id - 1).TriggerAlarm();
+        else
+            group.SetOutOfService(record.elevator_id - 1, static_cast<CarFault>(record.target) == CarFault::OutOfService);
+        break;
+    }
+}
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Utilities.h"
+#include "TimerService.h"
+
+class ElevatorGroup;
+class EventScheduler;
+class CheckpointWriter;
+class CheckpointReader;
+struct PendingTimer;
+
+// 一条呼梯记录
+enum class CallType {
+    Passenger, // 乘客: floor层 -> target层
+    Hall,      // 楼层外部按钮: floor层, dir方向
+    Car,       // 电梯内按钮: elevator_id号电梯, 目标target层
+    Fault      // 故障注入: elevator_id号电梯, target为CarFault
+};
+
+enum class CarFault {
+    Alarm,        // 触发报警
+    OutOfService, // 停用
+    InService     // 恢复服务
+};
+
+struct CallRecord {
+    TimerService::Time time = 0;
+    CallType type = CallType::Passenger;
+    int floor = 0;
+    int target = 0;
+    Direction dir = Direction::None;
+    int elevator_id = 0;
+};
+
+// 呼梯记录来源, 按时间顺序逐条拉取, 不要求整体载入内存
+class CallSource
+{
+public:
+    virtual ~CallSource() {}
+    virtual bool Next(CallRecord& record) = 0; // 没有更多记录时返回false
+    // 检查点: 保存读取位置, 恢复后Next()从同一条记录继续; 不支持的来源返回false
+    virtual bool SaveState(CheckpointWriter& writer) const { return false; }
+    virtual bool LoadState(CheckpointReader& reader) { return false; }
+};
+
+// 标准交通模式
+enum class TrafficProfile {
+    UpPeak,    // 上行高峰: 大部分乘客从大堂出发
+    DownPeak,  // 下行高峰: 大部分乘客前往大堂
+    Lunch,     // 午餐时段: 往返大堂各占一半
+    InterFloor // 层间交通: 任意两层之间均匀分布
+};
+
+// 交通流生成器: 泊松到达 + 起止楼层(OD)矩阵, 相同种子产生相同序列
+class TrafficGenerator : public CallSource
+{
+public:
+    TrafficGenerator(int floor_count, TrafficProfile profile, double passengers_per_minute,
+        TimerService::Time duration_ms, std::uint64_t seed);
+public:
+    bool Next(CallRecord& record) override;
+    bool SaveState(CheckpointWriter& writer) const override;
+    bool LoadState(CheckpointReader& reader) override;
+    void SetOriginDestinationMatrix(const std::vector<double>& weights); // floor_count*floor_count, 行为起点
+    static std::vector<double> ProfileMatrix(int floor_count, TrafficProfile profile);
+    static const char* ProfileName(TrafficProfile profile);
+    static bool ParseProfile(const std::string& name, TrafficProfile& profile);
+private:
+    std::uint64_t NextRandom();
+    double NextUniform(); // [0, 1)
+
+private:
+    int floor_count;
+    double rate_per_ms;
+    TimerService::Time duration;
+    double clock = 0.0;
+    std::uint64_t rng_state;
+    std::vector<double> cumulative; // OD矩阵的累计权重
+};
+
+// 轨迹文件回放: 逐行读取, 格式为 "时间,类型,参数,参数"
+//   1200,P,0,15   乘客从1层(下标0)前往16层
+//   1500,H,7,U    8层上行按钮
+//   1800,C,2,3    2号电梯内按下4层
+// 以#开头的行为注释
+class TraceReader : public CallSource
+{
+public:
+    explicit TraceReader(const std::string& path);
+public:
+    bool IsOpen() const { return file.is_open(); }
+    bool Next(CallRecord& record) override;
+    bool SaveState(CheckpointWriter& writer) const override;
+    bool LoadState(CheckpointReader& reader) override;
+    std::uint64_t GetLineNumber() const { return line_number; }
+    std::uint64_t GetSkippedCount() const { return skipped; } // 格式错误被跳过的行
+    static bool ParseLine(const std::string& line, CallRecord& record);
+private:
+    std::ifstream file;
+    std::vector<char> buffer;
+    std::string line;
+    std::uint64_t line_number = 0;
+    std::uint64_t skipped = 0;
+};
+
+// 把呼梯记录写成TraceReader可读取的格式, 便于复现
+class TraceWriter
+{
+public:
+    explicit TraceWriter(const std::string& path);
+public:
+    bool IsOpen() const { return file.is_open(); }
+    void Write(const CallRecord& record);
+    static std::string FormatLine(const CallRecord& record);
+private:
+    std::ofstream file;
+};
+
+// 把记录按时间戳注入事件调度器, 任意时刻只在内存中保留下一条记录
+class WorkloadDriver
+{
+public:
+    WorkloadDriver(ElevatorGroup& group, EventScheduler& scheduler, CallSource& source);
+public:
+    void Start();
+    void SetRecorder(TraceWriter* writer) { recorder = writer; }
+    std::uint64_t GetInjectedCount() const { return injected; }
+    bool IsFinished() const { return finished; }
+    // 检查点: 已取出但尚未注入的记录和记录来源的位置
+    bool SaveState(CheckpointWriter& writer) const;
+    bool LoadState(CheckpointReader& reader, std::vector<PendingTimer>& pending);
+private:
+    void ScheduleNext();
+    void ScheduleRecord(); // 在next_record的时间注入它
+    void Inject(const CallRecord& record);
+
+private:
+    ElevatorGroup& group;
+    EventScheduler& scheduler;
+    CallSource& source;
+    TraceWriter* recorder = nullptr;
+    std::uint64_t injected = 0;
+    bool finished = false;
+    CallRecord next_record;                                // 下一条待注入的记录
+    TimerService::TimerId next_timer = TimerService::InvalidTimer;
+};
@@ -0,0 +1,80 @@
+﻿#include "Zoning.h"
+#include <algorithm>
+
+namespace {
+    FloorMask FloorRange(int floor_count, int first, int last)
+    {
+        FloorMask mask(floor_count);
+        for (int floor = std::max(first, 0); floor <= last && floor < floor_count; ++floor)
+            mask.Set(floor);
+        return mask;
+    }
+
+    // 把count个对象尽量均分为parts组, 返回第index组的起点(含)
+    int SplitPoint(int count, int parts, int index)
+    {
+        return static_cast<int>(static_cast<long long>(count) * index / parts);
+    }
+}
+
+ZonePlan ZonePlan::Make(ZoningMode mode, int elevator_count, int floor_count, int bank_count)
+{
+    ZonePlan plan;
+    plan.served.assign(elevator_count, FloorRange(floor_count, 0, floor_count - 1));
+    if (mode == ZoningMode::Banks) {
+        // 大堂以上的楼层自下而上均分给各组, 低区电梯数多一些(余数归低区)
+        int banks = std::min(bank_count, elevator_count);
+        int upper_floors = floor_count - 1;
+        if (banks < 2 || upper_floors < banks) return plan;
+        for (int bank = 0; bank < banks; ++bank) {
+            FloorMask mask = FloorRange(floor_count, 1 + SplitPoint(upper_floors, banks, bank),
+                SplitPoint(upper_floors, banks, bank + 1));
+            mask.Set(0);
+            for (int car = SplitPoint(elevator_count, banks, bank); car < SplitPoint(elevator_count, banks, bank + 1); ++car)
+                plan.served[car] = mask;
+        }
+        plan.transfer_floors.push_back(0); // 跨组的乘客回大堂换乘
+    }
+    else if (mode == ZoningMode::SkyLobby) {
+        // 低区本地梯 | 穿梭梯 | 高区本地梯, 穿梭梯约占四分之一
+        if (elevator_count < 3 || floor_count < 5) return plan;
+        int sky = floor_count / 2;
+        int shuttles = std::max(1, elevator_count / 4);
+        int low = (elevator_count - shuttles) / 2;
+        FloorMask shuttle_mask(floor_count);
+        shuttle_mask.Set(0);
+        shuttle_mask.Set(sky);
+        for (int car = 0; car < elevator_count; ++car) {
+            if (car < low)
+                plan.served[car] = FloorRange(floor_count, 0, sky);
+            else if (car < low + shuttles)
+                plan.served[car] = shuttle_mask;
+            else
+                plan.served[car] = FloorRange(floor_count, sky, floor_count - 1);
+        }
+        plan.transfer_floors.push_back(sky);
+    }
+    return plan;
+}
+
+const char* ZonePlan::ModeName(ZoningMode mode)
+{
+    switch (mode) {
+    case ZoningMode::None: return "none";
+    case ZoningMode::Banks: return "banks";
+    case ZoningMode::SkyLobby: return "sky-lobby";
+    }
+    return "unknown";
+}
+
+bool ZonePlan::ParseMode(const std::string& name, ZoningMode& mode)
+{
+    const ZoningMode all[] = { ZoningMode::None, ZoningMode::Banks, ZoningMode::SkyLobby };
+    for (ZoningMode m : all) {
+        if (name == ModeName(m)) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
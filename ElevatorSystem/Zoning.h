@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include "FloorMask.h"
+
+// 分区方式
+enum class ZoningMode {
+    None,    // 所有电梯服务所有楼层
+    Banks,   // 低/中/高区: 电梯分为若干组, 每组服务大堂和一段连续楼层, 大堂与服务区之间直驶不停
+    SkyLobby // 空中大堂: 穿梭梯只停大堂和空中大堂, 上下两段各由一组电梯服务, 跨段的乘客在空中大堂换乘
+};
+
+// 分区方案: 每部电梯的服务楼层和可换乘的楼层
+struct ZonePlan {
+    std::vector<FloorMask> served;    // 每部电梯一个
+    std::vector<int> transfer_floors; // 没有电梯直达时在这些楼层换乘
+
+    // 1层(下标0)为大堂; bank_count只用于Banks, 超过电梯数时按电梯数分组
+    static ZonePlan Make(ZoningMode mode, int elevator_count, int floor_count, int bank_count);
+    static const char* ModeName(ZoningMode mode);
+    static bool ParseMode(const std::string& name, ZoningMode& mode);
+};
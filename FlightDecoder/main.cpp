@@ -0,0 +1,87 @@
+﻿#include "FlightRecorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 飞行记录解码: 把FlightRecorder导出的二进制文件按时间合并为所有电梯的时间线
+//   FlightDecoder <file> [--format text|csv] [--car 2] [--from 0] [--to 60000]
+
+namespace {
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: FlightDecoder <file> [--format text|csv] [--car N] [--from ms] [--to ms]\n");
+    }
+
+    struct TimelineEntry {
+        int elevator_id;
+        FlightEvent event;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        PrintUsage();
+        return 1;
+    }
+    std::string path = argv[1];
+    std::string format = "text";
+    int car = 0;
+    long long from = 0;
+    long long to = -1;
+
+    for (int i = 2; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            PrintUsage();
+            return 1;
+        }
+        if (std::strcmp(arg, "--format") == 0) format = value;
+        else if (std::strcmp(arg, "--car") == 0) car = std::atoi(value);
+        else if (std::strcmp(arg, "--from") == 0) from = std::atoll(value);
+        else if (std::strcmp(arg, "--to") == 0) to = std::atoll(value);
+        else {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+
+    std::vector<FlightTrack> tracks;
+    if (!FlightRecorder::ReadFile(path, tracks)) {
+        std::fprintf(stderr, "cannot read flight record: %s\n", path.c_str());
+        return 1;
+    }
+
+    // 各电梯的记录已按时间排序, 合并后同一时刻按电梯编号、记录顺序排列
+    std::vector<TimelineEntry> timeline;
+    for (const FlightTrack& track : tracks) {
+        if (car != 0 && track.elevator_id != car) continue;
+        for (const FlightEvent& event : track.events) {
+            if (event.time < from || (to >= 0 && event.time > to)) continue;
+            timeline.push_back({ track.elevator_id, event });
+        }
+    }
+    std::stable_sort(timeline.begin(), timeline.end(), [](const TimelineEntry& a, const TimelineEntry& b) {
+        return a.event.time < b.event.time;
+    });
+
+    if (format == "csv") {
+        std::printf("time_ms,car,type,floor,state,direction\n");
+        for (const TimelineEntry& entry : timeline) {
+            std::printf("%lld,%d,%d,%d,%d,%d\n", static_cast<long long>(entry.event.time), entry.elevator_id,
+                static_cast<int>(entry.event.type), entry.event.floor + 1, entry.event.state, entry.event.direction);
+        }
+    }
+    else {
+        for (const TimelineEntry& entry : timeline) {
+            std::printf("%10.3fs  电梯%-3d %s\n", entry.event.time / 1000.0, entry.elevator_id, entry.event.Describe().c_str());
+        }
+    }
+    return 0;
+}